@@ -2,9 +2,12 @@
 
 #include "CombustibleActor.h"
 
+#include "Components/CombustibleInstancesComponent.h"
 #include "Curves/CurveLinearColor.h"
 #include "Net/UnrealNetwork.h"
 #include "Net/Core/PushModel/PushModel.h"
+#include "Subsystems/CombustibleInstancesSubsystem.h"
+#include "Subsystems/CombustibleReplicationSubsystem.h"
 #include "Subsystems/GlobalFireManagerSubsystem.h"
 
 // Sets default values
@@ -29,6 +32,15 @@ void ACombustibleActor::BeginPlay()
 {
 	Super::BeginPlay();
 
+	if (bReplicateInBulk)
+		RegisterForBulkReplication();
+	
+	if (bInstanced)
+	{
+		RegisterAsInstance();
+		return;
+	}
+	
 	if (!ensure(CombustionColorCurve))
 	{
 		SetReplicates(false);
@@ -46,6 +58,26 @@ void ACombustibleActor::BeginPlay()
 		UpdateCombustionState();
 }
 
+void ACombustibleActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (BulkReplicationId != 0)
+	{
+		if (auto ReplicationSubsystem = GetWorld()->GetSubsystem<UCombustibleReplicationSubsystem>())
+			ReplicationSubsystem->UnregisterCombustible(BulkReplicationId);
+	}
+	
+	Super::EndPlay(EndPlayReason);
+}
+
+void ACombustibleActor::ApplyReplicatedCombustion(float NormalizedCombustion)
+{
+	CombustionState = NormalizedCombustion * MaxCombustionLevel;
+	if (CombustibleInstances.IsValid())
+		CombustibleInstances->SetCombustionState(CombustibleInstanceIndex, CombustionState);
+	else
+		UpdateCombustionState();
+}
+
 void ACombustibleActor::AddCombustion(float NewCombustionState)
 {
 	if (HasAuthority())
@@ -53,6 +85,11 @@ void ACombustibleActor::AddCombustion(float NewCombustionState)
 		CombustionState = FMath::Clamp(CombustionState + NewCombustionState, 0.f, MaxCombustionLevel);
 		MARK_PROPERTY_DIRTY_FROM_NAME(ACombustibleActor, CombustionState, this);
 		UpdateCombustionState();
+		if (BulkReplicationId != 0)
+		{
+			if (auto ReplicationSubsystem = GetWorld()->GetSubsystem<UCombustibleReplicationSubsystem>())
+				ReplicationSubsystem->SetCombustion(BulkReplicationId, GetActorLocation(), CombustionState / MaxCombustionLevel);
+		}
 	}
 }
 
@@ -82,6 +119,41 @@ void ACombustibleActor::UpdateCombustionState()
 		DynamicMaterialInstance->SetVectorParameterValue(FName("Color"), CombustionColorCurve->GetLinearColorValue(CombustionState));
 }
 
+void ACombustibleActor::RegisterAsInstance()
+{
+	auto CombustibleInstancesSubsystem = GetWorld()->GetSubsystem<UCombustibleInstancesSubsystem>();
+	if (!ensure(CombustibleInstancesSubsystem))
+		return;
+
+	CombustibleInstances = CombustibleInstancesSubsystem->AddInstance(StaticMeshComponent, InstancedMaterial, MaxCombustionLevel, CombustionRate,
+		BulkReplicationId, CombustibleInstanceIndex);
+	if (!CombustibleInstances.IsValid())
+		return;
+
+	// replicated combustion could have arrived before the instance existed
+	if (CombustionState > 0.f)
+		CombustibleInstances->SetCombustionState(CombustibleInstanceIndex, CombustionState);
+
+	// instance takes over both visuals and collision, so the fire never finds this actor and it never changes
+	StaticMeshComponent->SetVisibility(false);
+	StaticMeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	if (HasAuthority())
+		SetReplicates(false);
+}
+
+void ACombustibleActor::RegisterForBulkReplication()
+{
+	const uint32 Id = UCombustibleReplicationSubsystem::MakeStableId(this);
+	auto ReplicationSubsystem = GetWorld()->GetSubsystem<UCombustibleReplicationSubsystem>();
+	if (Id == 0 || !ReplicationSubsystem || !ReplicationSubsystem->RegisterCombustible(Id, this))
+		return;
+
+	BulkReplicationId = Id;
+	// props are loaded with the level on every machine, so there's nothing left for the actor to replicate
+	if (HasAuthority())
+		SetReplicates(false);
+}
+
 void ACombustibleActor::OnRep_CombustionState(float PrevValue)
 {
 	UpdateCombustionState();
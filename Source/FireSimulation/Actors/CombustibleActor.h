@@ -7,6 +7,8 @@
 #include "Interfaces/Combustible.h"
 #include "CombustibleActor.generated.h"
 
+class UCombustibleInstancesComponent;
+
 UCLASS()
 class FIRESIMULATION_API ACombustibleActor : public AActor, public ICombustible
 {
@@ -17,9 +19,13 @@ public:
 	ACombustibleActor();
 
 	virtual void GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const override;
+
+	// combustion received from UCombustibleReplicationSubsystem, normalized to max combustion level
+	void ApplyReplicatedCombustion(float NormalizedCombustion);
 	
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 	UStaticMeshComponent* StaticMeshComponent;
@@ -34,6 +40,21 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(ClampMin = 0.f, UIMin = 0.f))
 	float CombustionRate = 0.25;
 
+	// register the mesh as an instance in UCombustibleInstancesSubsystem and keep this actor only as a hidden placeholder.
+	// for props scattered in thousands: no draw call and no dynamic material per prop. Fire simulation burns the instance, not the actor
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Instancing")
+	bool bInstanced = false;
+
+	// material of the instance. It is expected to map per-instance custom data 0 (combustion normalized to max combustion level) to color,
+	// i.e. by sampling a curve atlas row of CombustionColorCurve. Mesh material is used if not set
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Instancing", meta=(EditCondition="bInstanced"))
+	UMaterialInterface* InstancedMaterial;
+
+	// combustion is replicated in bulk by UCombustibleReplicationSubsystem and the actor stops replicating itself.
+	// only works for actors loaded with the level (i.e. placed by PCG in editor), spawned actors keep replicating themselves
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Replication")
+	bool bReplicateInBulk = true;
+
 public: // ICombustionInterface
 	virtual void AddCombustion(float NewCombustionState) override;
 	virtual bool IsIgnited() const override;
@@ -46,8 +67,15 @@ private:
 
 	UPROPERTY()
 	UMaterialInstanceDynamic* DynamicMaterialInstance;
+
+	TWeakObjectPtr<UCombustibleInstancesComponent> CombustibleInstances;
+	int32 CombustibleInstanceIndex = INDEX_NONE;
+	// 0 if the actor replicates itself
+	uint32 BulkReplicationId = 0;
 	
 	void UpdateCombustionState();
+	void RegisterAsInstance();
+	void RegisterForBulkReplication();
 
 	UFUNCTION()
 	void OnRep_CombustionState(float PrevValue);
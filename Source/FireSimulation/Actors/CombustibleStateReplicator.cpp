@@ -0,0 +1,36 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombustibleStateReplicator.h"
+
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+ACombustibleStateReplicator::ACombustibleStateReplicator()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	bReplicates = true;
+	SetReplicatingMovement(false);
+	// burning props change slowly, no need to consider the region every frame
+	SetNetUpdateFrequency(10.f);
+	SetMinNetUpdateFrequency(2.f);
+}
+
+void ACombustibleStateReplicator::PostInitProperties()
+{
+	Super::PostInitProperties();
+	// not in constructor, since properties are copied from archetype after it
+	CombustionStates.Owner = this;
+}
+
+void ACombustibleStateReplicator::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	FDoRepLifetimeParams DoRepLifetimeParams { COND_None, REPNOTIFY_OnChanged, true };
+	DOREPLIFETIME_WITH_PARAMS_FAST(ACombustibleStateReplicator, CombustionStates, DoRepLifetimeParams);
+}
+
+void ACombustibleStateReplicator::SetCombustionLevel(uint32 Id, uint8 Level)
+{
+	if (CombustionStates.SetLevel(Id, Level))
+		MARK_PROPERTY_DIRTY_FROM_NAME(ACombustibleStateReplicator, CombustionStates, this);
+}
@@ -0,0 +1,31 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Data/CombustibleStateReplication.h"
+#include "GameFramework/Actor.h"
+#include "CombustibleStateReplicator.generated.h"
+
+/**
+ * Replicates combustion of all combustible props in one region of the world, so that the props themselves don't have to replicate.
+ * Spawned by UCombustibleReplicationSubsystem on server in the center of its region. Regular distance based relevancy applies,
+ * so clients only get regions they are close to, and get the full state of a region once it becomes relevant
+ */
+UCLASS(NotPlaceable, Transient)
+class FIRESIMULATION_API ACombustibleStateReplicator : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ACombustibleStateReplicator();
+	
+	virtual void PostInitProperties() override;
+	virtual void GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const override;
+
+	void SetCombustionLevel(uint32 Id, uint8 Level);
+
+private:
+	UPROPERTY(Replicated)
+	FCombustibleStateArray CombustionStates;
+};
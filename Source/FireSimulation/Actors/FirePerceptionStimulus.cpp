@@ -0,0 +1,35 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "FirePerceptionStimulus.h"
+
+#include "Perception/AIPerceptionStimuliSourceComponent.h"
+
+AFirePerceptionStimulus::AFirePerceptionStimulus()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	SetRootComponent(CreateDefaultSubobject<USceneComponent>(TEXT("Root")));
+	StimuliSource = CreateDefaultSubobject<UAIPerceptionStimuliSourceComponent>(TEXT("StimuliSource"));
+	SetCanBeDamaged(false);
+}
+
+void AFirePerceptionStimulus::SetSenses(const TArray<TSubclassOf<UAISense>>& Senses)
+{
+	for (const TSubclassOf<UAISense>& Sense : Senses)
+		StimuliSource->RegisterForSense(Sense);
+	
+	// component may have registered itself for the senses on spawn, stimulus is inactive until it's placed
+	StimuliSource->UnregisterFromPerceptionSystem();
+	bStimulusActive = false;
+}
+
+void AFirePerceptionStimulus::SetStimulusActive(bool bActive)
+{
+	if (bStimulusActive == bActive)
+		return;
+
+	bStimulusActive = bActive;
+	if (bActive)
+		StimuliSource->RegisterWithPerceptionSystem();
+	else
+		StimuliSource->UnregisterFromPerceptionSystem();
+}
@@ -0,0 +1,33 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "FirePerceptionStimulus.generated.h"
+
+class UAIPerceptionStimuliSourceComponent;
+class UAISense;
+
+/**
+ * Point of fire that NPCs can perceive. Perception registers actors, not components, so every stimulus is a tiny actor.
+ * Pooled by FFirePerceptionStimuli on server, which moves them over the burning area and switches their registration on and off
+ */
+UCLASS(NotPlaceable, Transient)
+class FIRESIMULATION_API AFirePerceptionStimulus : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AFirePerceptionStimulus();
+	
+	void SetSenses(const TArray<TSubclassOf<UAISense>>& Senses);
+	void SetStimulusActive(bool bActive);
+	bool IsStimulusActive() const { return bStimulusActive; }
+
+private:
+	UPROPERTY(VisibleAnywhere)
+	UAIPerceptionStimuliSourceComponent* StimuliSource;
+	
+	bool bStimulusActive = false;
+};
@@ -5,15 +5,29 @@
 
 #include "NiagaraComponent.h"
 #include "NiagaraDataInterfaceArrayFunctionLibrary.h"
+#include "Perception/AISense_Sight.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
 #include "Components/BoxComponent.h"
+#include "Components/CombustibleInstancesComponent.h"
 #include "Components/WindComponent.h"
 #include "Data/CollisionChannels.h"
+#include "Data/FireCellGrid.h"
+#include "Data/FireSimulationParallel.h"
 #include "Data/FireSimulationDataTypes.h"
+#include "Data/FireSimulationStats.h"
+#include "Data/FireTerrainBakeData.h"
 #include "Data/LogChannels.h"
+#include "Data/NavArea_Fire.h"
+#include "AI/NavigationSystemBase.h"
 #include "GameFramework/GameStateBase.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
 #include "Interfaces/Combustible.h"
 #include "Net/UnrealNetwork.h"
 #include "Net/Core/PushModel/PushModel.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "Tasks/Task.h"
 #include "Settings/FireSimulationSettings.h"
 #include "Subsystems/GlobalFireManagerSubsystem.h"
 
@@ -46,41 +60,24 @@ AFireSource::AFireSource()
 	BoxComponent = CreateDefaultSubobject<UBoxComponent>(TEXT("FireAreaVolume"));
 	BoxComponent->SetupAttachment(GetRootComponent());
 	
-	// key - dot product between wind and world forward vector mapped from 0 to 7. pseudocode: round(acos((wind, world x)) / 2pi * 8)
-	// values - group of 3 directions to neighbor cells where this wind direction makes fire spread 
-	WindDirectionToNeighbors =
-	{
-		{ 0, { { 1, 0 }, { 1, 1 }, {1, -1 } } },
-		{ 1, { { 1, 1 }, { 1, 0 }, { 0, 1 } } },
-		{ 2, { {0, 1 }, {-1, 1 }, {1, 1 } } },
-		{ 3, { {-1, 1 }, {0, 1 }, {-1, 0 } } },
-		{ 4, { {-1, 0 }, {-1, -1 }, {-1, 1 } } },
-		{ 5, { {-1, -1 }, {-1, 0 }, {0, -1 } } },
-		{ 6, { {0, -1 }, {1, -1 }, {-1, -1 } } },
-		{ 7, { {1, -1}, {0, -1}, {1, 0 } } },
-		{ 8, { { 1, 0 }, { 1, 1 }, {1, -1 } } }
-	};
+	BurningAreaNavClass = UNavArea_Fire::StaticClass();
+	PerceptionStimuliSenses.Add(UAISense_Sight::StaticClass());
 
-	RadialDirections =
-	{
-		{1, 1},
-		{ -1, -1},
-		{ 1, 0},
-		{0, 1},
-		{1, -1},
-		{-1, 1},
-		{-1, 0},
-		{0, -1}
-	};
+	SpreadCore = FFireSpreadCore(Cells, *this);
+}
+
+void AFireSource::PostInitProperties()
+{
+	Super::PostInitProperties();
+	// not in constructor, since properties are copied from archetype after it
+	ReplicatedCells.Owner = this;
 }
 
 void AFireSource::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-	FDoRepLifetimeParams DoRepLifetimeParamsForAllFireLocations { COND_InitialOnly, REPNOTIFY_OnChanged, true };
-	FDoRepLifetimeParams DoRepLifetimeParamsForNewLocations { COND_None, REPNOTIFY_OnChanged, true };
-	DOREPLIFETIME_WITH_PARAMS_FAST(AFireSource, FireLocations, DoRepLifetimeParamsForAllFireLocations);
-	DOREPLIFETIME_WITH_PARAMS_FAST(AFireSource, NewFireLocations, DoRepLifetimeParamsForNewLocations);
+	FDoRepLifetimeParams DoRepLifetimeParamsForCells { COND_None, REPNOTIFY_OnChanged, true };
+	DOREPLIFETIME_WITH_PARAMS_FAST(AFireSource, ReplicatedCells, DoRepLifetimeParamsForCells);
 }
 
 // Called when the game starts or when spawned
@@ -88,21 +85,36 @@ void AFireSource::BeginPlay()
 {
 	Super::BeginPlay();
 	
+	bLogDebugAtomic.store(bLog_Debug);
+	// clients render replicated cells with the same particle slots
+	ParticleSlots.SetCapacity(MaxParticleSlots);
+	
 	if (!HasAuthority())
 		return;
 	
-	if (auto GlobalFireManager = GetWorld()->GetSubsystem<UGlobalFireManagerSubsystem>())
-	{
-		GlobalFireManager->RegisterFireSource(this);
-		// auto RelevantFireSources = GlobalFireManager->GetRelevantFireSources(this, RelevantDistanceToOtherFireSources);
-		// TODO merge cells of relevant fire sources with this fire source cells
-	}
-
-	bLogDebugAtomic.store(bLog_Debug);
+	SpreadCore.Settings.CellSize = FireCellSize;
+	Cells.SetSlopeCellSize(bWindSlopeCorrection ? FireCellSize : 0.f);
+	BurningArea.SetCellSize(FireCellSize);
+	PerceptionStimuli.Settings.Spacing = PerceptionStimuliSpacing;
+	PerceptionStimuli.Settings.MaxRegistrationsPerUpdate = PerceptionStimuliRegistrationsPerTick;
+	PerceptionStimuli.Settings.Senses = PerceptionStimuliSenses;
+	SpreadCore.Settings.FireDownwardPropagationThreshold = FireDownwardPropagationThreshold;
+	SpreadCore.Settings.SmolderingFuelThreshold = SmolderingFuelThreshold;
+	SpreadCore.Settings.SmolderingSpreadFactor = SmolderingSpreadFactor;
 	
 	auto FireSimSettings = GetDefault<UFireSimulationSettings>();
 	SurfacesCombustionParameters = FireSimSettings->CombustionParameters;
-	IncombustibleSurfaces = FireSimSettings->IncombustibleSurfaces;	
+	IncombustibleSurfaces = FireSimSettings->IncombustibleSurfaces;
+
+	if (TerrainBakeData && TerrainBakeData->Bake.IsCompatible(GetGridOrigin(), FireCellSize, BaseFireStrength * 0.5))
+		TerrainBake = TerrainBakeData->Bake;
+	else if (bBakeTerrainOnBeginPlay)
+		BakeTerrainAsync();
+
+	// after the bake, since a host reads terrain of its feeders
+	if (auto GlobalFireManager = GetWorld()->GetSubsystem<UGlobalFireManagerSubsystem>())
+		GlobalFireManager->RegisterFireSource(this);
+	
 	if (bStartFireAutomatically)
 		StartFire();
 
@@ -112,10 +124,16 @@ void AFireSource::BeginPlay()
 
 void AFireSource::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	if (HasAuthority())
-		if (auto World = GetWorld())
-			if (auto GlobalFireManager = World->GetSubsystem<UGlobalFireManagerSubsystem>())
-				GlobalFireManager->UnregisterFireSource(this);
+	// pipeline tasks reference this actor, bake task - the world
+	SpreadPipelineTask.Wait();
+	TerrainBakeTask.Wait();
+	PerceptionStimuli.Reset();
+	
+	// only the server registers fire sources, but clients publish fire query indices, and unregistering drops those too.
+	// On server hosts keep pointers to terrain bakes of their feeders, so they have to let go of this one
+	if (auto World = GetWorld())
+		if (auto GlobalFireManager = World->GetSubsystem<UGlobalFireManagerSubsystem>())
+			GlobalFireManager->UnregisterFireSource(this);
 	
 	Super::EndPlay(EndPlayReason);
 }
@@ -123,6 +141,7 @@ void AFireSource::EndPlay(const EEndPlayReason::Type EndPlayReason)
 // Called every frame
 void AFireSource::Tick(float DeltaTime)
 {
+	FIRESIM_SCOPE(Tick);
 	Super::Tick(DeltaTime);
 	if (!HasAuthority())
 	{
@@ -131,72 +150,241 @@ void AFireSource::Tick(float DeltaTime)
 	}
 
 	UpdateBurningActors();
+	if (bCreatePerceptionStimuli)
+		PerceptionStimuli.Update(this);
+
+	if (bAsyncUpdateRunning.load() && SpreadPipelineTask.IsCompleted())
+		CompleteSpreadFireAsync();
+
+	if (HasPendingTerrainBakeUpdate() && !GetSimulationHost()->bAsyncUpdateRunning.load())
+		UpdateTerrainBake();
+
+	if (!bAsyncUpdateRunning.load() && !PendingFireOrigins.IsEmpty())
+	{
+		for (const FVector& PendingFireOrigin : PendingFireOrigins)
+			StartFireAtLocation(PendingFireOrigin);
+		
+		PendingFireOrigins.Empty();
+	}
 	
-	if (!bAsyncUpdateRunning.load() && !EdgeCells.IsEmpty())
+	AccumulatedDeltaTime += DeltaTime;
+	if (bDeterministicSimulation)
 	{
-		AccumulatedDeltaTime.store(DeltaTime);
-		SpreadFireAsync();
+		TickFixedSteps();
 	}
-	else
+	else if (!bAsyncUpdateRunning.load() && IsFireActive())
+	{
+		// all time that passed while previous step was running goes into this one
+		SpreadFireAsync(AccumulatedDeltaTime);
+		AccumulatedDeltaTime = 0.f;
+	}
+	
+	// the last cells of a fire burn out without a step after them that would pick up their regions
+	if (!bAsyncUpdateRunning.load() && !IsFireActive() && BurningArea.HasDirtyRegions())
 	{
-		AccumulatedDeltaTime.fetch_add(DeltaTime);
+		BurningAreaRegionsSnapshot = BurningArea.ExtractDirtyRegions();
+		DecomposeBurningArea();
+		ApplyBurningAreaBoxes();
 	}
+	
+	SET_DWORD_STAT(STAT_FireSim_Cells, Cells.Num());
+	SET_DWORD_STAT(STAT_FireSim_EdgeCells, EdgeCells.Num());
+	SET_DWORD_STAT(STAT_FireSim_BurningCells, BurningCells.Num());
+	SET_DWORD_STAT(STAT_FireSim_SteppedEdgeCells, EdgeCellsSnapshot.Num());
+	SET_DWORD_STAT(STAT_FireSim_SleepingEdgeCells, SleepingEdgeCellsCount);
+	SET_DWORD_STAT(STAT_FireSim_PendingActorUpdates, CombustibleUpdates.Num());
 }
 
-void AFireSource::StartFireAtLocation(const FVector& NewFireOrigin)
+void AFireSource::TickFixedSteps()
 {
-	FVector RootToNewOrigin = NewFireOrigin - GetActorLocation();
-	int CellX = FMath::RoundToInt(RootToNewOrigin.X / FireCellSize);
-	int CellY = FMath::RoundToInt(RootToNewOrigin.Y / FireCellSize);
-	StartFireAtCell(FIntVector2(CellX, CellY), NewFireOrigin);
-	StartFire();
+	if (bAsyncUpdateRunning.load())
+		return;
+
+	if (!IsFireActive())
+	{
+		// nothing burns, don't let the idle time turn into a burst of steps once something ignites
+		AccumulatedDeltaTime = 0.f;
+		return;
+	}
+
+	const int32 StepsCount = FMath::Min(FMath::FloorToInt32(AccumulatedDeltaTime / FixedSimulationStep), MaxSimulationStepsPerTick);
+	for (int32 Step = 0; Step < StepsCount && IsFireActive(); Step++)
+	{
+		SpreadFireAsync(FixedSimulationStep);
+		AccumulatedDeltaTime -= FixedSimulationStep;
+		
+		// catching up: every step depends on the previous one, so all but the last step are completed right away
+		if (Step < StepsCount - 1)
+		{
+			SpreadPipelineTask.Wait();
+			CompleteSpreadFireAsync();
+		}
+	}
+
+	AccumulatedDeltaTime = FMath::Min(AccumulatedDeltaTime, FixedSimulationStep * MaxSimulationStepsPerTick);
 }
 
-void AFireSource::UpdateBurningActors()
+void AFireSource::StepSimulation(float StepDeltaTime)
 {
-	if (PendingBurningActorsUpdates.IsEmpty())
+	if (bAsyncUpdateRunning.load())
+	{
+		SpreadPipelineTask.Wait();
+		CompleteSpreadFireAsync();
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	UpdateBurningActors();
+	const double UpdateBurningActorsMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	
+	if (!IsFireActive())
+	{
+		StepReport = FFireSimulationStepReport();
+		StepReport.UpdateBurningActorsMs = UpdateBurningActorsMs;
+		StepReport.PendingActorUpdates = CombustibleUpdates.Num();
 		return;
+	}
 	
-	int Index = LastBurningActorUpdateIndex;
-	int Until = FMath::Min(LastBurningActorUpdateIndex + MaxActorsUpdatesPerTick, PendingBurningActorsUpdates.Num());
+	SpreadFireAsync(StepDeltaTime);
+	SpreadPipelineTask.Wait();
+	CompleteSpreadFireAsync();
+	StepReport.UpdateBurningActorsMs = UpdateBurningActorsMs;
+}
+
+SIZE_T AFireSource::GetSimulationAllocatedSize() const
+{
+	SIZE_T ReplicatedCellsSize = ReplicatedCells.Items.GetAllocatedSize();
+	for (const FFireCellChunkItem& Item : ReplicatedCells.Items)
+		ReplicatedCellsSize += Item.Phases.GetAllocatedSize() + Item.ZOffsets.GetAllocatedSize();
 	
-	while (Index < Until)
+	return Cells.GetAllocatedSize() + Combustibles.GetAllocatedSize() + EdgeCells.GetAllocatedSize() + BurningCells.GetAllocatedSize() + TerrainBake.Cells.GetAllocatedSize()
+		+ CombustibleUpdates.GetAllocatedSize() + ReplicatedCellsSize + BurningArea.GetAllocatedSize() + ParticleSlots.GetAllocatedSize() + SleepingEdgeCells.GetAllocatedSize();
+}
+
+uint32 AFireSource::GetSimulationStateHash() const
+{
+	// tiles are visited in the order they were allocated, so cell hashes are combined in a way that doesn't depend on order
+	uint32 Hash = HashCombineFast(GetTypeHash(Cells.Num()), GetTypeHash(Cells.GetNumAshTiles()));
+	Cells.ForEachCell([&Hash](const FFireCellGrid::FCellRef& Cell)
 	{
-		auto Cell = Cells.Find(PendingBurningActorsUpdates[Index].Key);
-		if (!ensure(Cell))
-			continue;
-		
-		if (Cell->CombustibleActor.IsValid())
-		{
-			Cell->CombustibleInterface->AddCombustion(PendingBurningActorsUpdates[Index].Value);
-			if (Cell->CombustibleInterface->IsIgnited())
-				Cell->bCombustibleActorIgnited = true;
-		}
-		else
-		{
-			Cell->CombustibleActor.Reset();
-			Cell->CombustibleInterface = nullptr;
-			Cell->bHasCombustibleInterface = false;
-		}
+		uint32 CellHash = HashCombineFast(GetTypeHash(Cell.GetKey()), static_cast<uint32>(Cell.GetPhase()));
+		CellHash = HashCombineFast(CellHash, GetTypeHash(Cell.CombustionState().load()));
+		Hash += CellHash;
+	});
+
+	return Hash;
+}
 
-		Index++;
+void AFireSource::StartFireAtLocation(const FVector& NewFireOrigin)
+{
+	AFireSource* Host = GetSimulationHost();
+	if (Host != this)
+	{
+		Host->StartFireAtLocation(NewFireOrigin);
+		return;
+	}
+	
+	if (bAsyncUpdateRunning.load())
+	{
+		PendingFireOrigins.Add(NewFireOrigin);
+		return;
 	}
+	
+	// fire starts in the center of the cell, so that all cells are on the world grid
+	const FIntVector2 CellKey = GetCellKey(NewFireOrigin);
+	StartFireAtCell(CellKey, FVector(CellKey.X * FireCellSize, CellKey.Y * FireCellSize, NewFireOrigin.Z));
+	StartFire();
+}
 
-	LastBurningActorUpdateIndex = Index;
-	if (Index >= PendingBurningActorsUpdates.Num())
+FIntVector2 AFireSource::GetCellKey(const FVector& WorldLocation) const
+{
+	return FIntVector2(FMath::RoundToInt32(WorldLocation.X / FireCellSize), FMath::RoundToInt32(WorldLocation.Y / FireCellSize));
+}
+
+bool AFireSource::CanShareSimulationWith(const AFireSource* Other) const
+{
+	// host simulates everything with its own parameters, so only sources that would simulate the same way are merged
+	return bShareSimulation && Other->bShareSimulation && Other != this
+		&& FMath::IsNearlyEqual(FireCellSize, Other->FireCellSize)
+		&& FMath::IsNearlyEqual(BaseFireStrength, Other->BaseFireStrength)
+		&& FMath::IsNearlyEqual(FireDownwardPropagationThreshold, Other->FireDownwardPropagationThreshold)
+		&& bDeterministicSimulation == Other->bDeterministicSimulation;
+}
+
+void AFireSource::AddFeeder(AFireSource* Feeder)
+{
+	// workers read feeder bakes
+	SpreadPipelineTask.Wait();
+	Feeders.AddUnique(Feeder);
+	Feeder->SimulationHost = this;
+	// host's own bake can be missing or still baking, so the feeder bake is checked against the sweeps it would replace
+	if (Feeder->TerrainBake.IsValid() && FMath::IsNearlyEqual(Feeder->TerrainBake.SweepHalfHeight, BaseFireStrength * 0.5))
+		FeederTerrainBakes.AddUnique(&Feeder->TerrainBake);
+}
+
+void AFireSource::RemoveFeeder(AFireSource* Feeder)
+{
+	SpreadPipelineTask.Wait();
+	Feeders.Remove(Feeder);
+	FeederTerrainBakes.Remove(&Feeder->TerrainBake);
+	Feeder->SimulationHost.Reset();
+	Feeder->UpdateTerrainBake();
+}
+
+TArray<AFireSource*> AFireSource::ReleaseFeeders()
+{
+	SpreadPipelineTask.Wait();
+	TArray<AFireSource*> ReleasedFeeders;
+	for (const TWeakObjectPtr<AFireSource>& Feeder : Feeders)
 	{
-		PendingBurningActorsUpdates.Empty();
-		LastBurningActorUpdateIndex = 0;
+		if (Feeder.IsValid())
+		{
+			Feeder->SimulationHost.Reset();
+			Feeder->UpdateTerrainBake();
+			ReleasedFeeders.Add(Feeder.Get());
+		}
 	}
+	
+	Feeders.Reset();
+	FeederTerrainBakes.Reset();
+	return ReleasedFeeders;
 }
 
-bool AFireSource::GetCell(const FVector& LocationBase, FFireCell& OutCell) const
+void AFireSource::UpdateBurningActors()
+{
+	if (CombustibleUpdates.IsEmpty())
+		return;
+	
+	FIRESIM_SCOPE(UpdateBurningActors);
+	CombustibleUpdates.Settings.BudgetMicroseconds = ActorUpdatesBudgetMicroseconds;
+	CombustibleUpdates.Settings.DistanceFalloff = ActorUpdatesDistanceFalloff;
+	// cells of an actor can be compacted into ash while its update is pending. Ash cells don't have combustibles anymore
+	CombustibleUpdates.Update(GetWorld(),
+		[this](const FIntVector2& CellKey)
+		{
+			const FFireCellGrid::FCellRef Cell = Cells.FindRef(CellKey);
+			if (Cell.IsValid() && !Cells.IsAsh(CellKey))
+				Cell.SetFlag(EFireCellFlags::CombustibleActorIgnited, true);
+		},
+		[this](const FIntVector2& CellKey)
+		{
+			const FFireCellGrid::FCellRef Cell = Cells.FindRef(CellKey);
+			if (Cell.IsValid() && !Cells.IsAsh(CellKey))
+				ReleaseCombustible(Cell);
+		});
+}
+
+bool AFireSource::GetCell(const FIntVector2& CellKey, const FVector& LocationBase, FFireCell& OutCell) const
 {
+	if (TryGetBakedCell(CellKey, LocationBase, OutCell))
+		return !OutCell.bObstacle;
+	
 	// ok. current issue with this function: it gets new cell for a requesting cell. but the same cell can be an obstacle for 1 cell and a valid cell for another cell
 	// for example, if 1 cell if lower than other, it might consider it an obstacle as unreacheable, or if the cell is higher that the other
 	// but at the same time there can be other neighbor cells that are on the same level
 	// so perhaps the fact is a cell is an obstacle shouldn't be decided here, and instead tested individually cell by cell
 	
+	FIRESIM_SCOPE(Sweep);
+	INC_DWORD_STAT(STAT_FireSim_Sweeps);
 	FHitResult Hit;
 	FCollisionShape SweepShape = FCollisionShape::MakeBox(FVector(FireCellSize * .5f, FireCellSize * .5f, BaseFireStrength * 0.5f));
 	FVector SweepStart = LocationBase + FVector::UpVector * BaseFireStrength;
@@ -230,11 +418,7 @@ bool AFireSource::GetCell(const FVector& LocationBase, FFireCell& OutCell) const
 			{
 				const auto* SurfaceCombustionParameters = SurfacesCombustionParameters.Find(Hit.PhysMaterial->SurfaceType);
 				if (SurfaceCombustionParameters)
-				{
-					OutCell.CombustionRate = SurfaceCombustionParameters->IgnitionRate;
-					OutCell.BurnoutRate = SurfaceCombustionParameters->BurnoutRate;
-					OutCell.FireHeight = SurfaceCombustionParameters->BurningStrength;
-				}
+					ApplySurfaceParameters(*SurfaceCombustionParameters, OutCell);
 			}
 		}
 		else
@@ -242,7 +426,15 @@ bool AFireSource::GetCell(const FVector& LocationBase, FFireCell& OutCell) const
 			OutCell.bObstacle = true;
 		}
 
-		OutCell.SetActor(Hit.GetActor());
+		// hit item of instanced static mesh is the instance index
+		FFireCellCombustible Combustible;
+		auto* CombustibleInstances = Cast<UCombustibleInstancesComponent>(Hit.GetComponent());
+		const bool bCombustible = CombustibleInstances
+			? Combustible.SetInstance(CombustibleInstances, Hit.Item, OutCell.CombustionRate)
+			: Combustible.SetActor(Hit.GetActor(), OutCell.CombustionRate);
+		
+		if (bCombustible)
+			OutCell.CombustibleIndex = AddNewCombustible(Combustible);
 		
 		return !OutCell.bObstacle;
 	}
@@ -254,21 +446,248 @@ bool AFireSource::GetCell(const FVector& LocationBase, FFireCell& OutCell) const
 	}
 }
 
+int32 AFireSource::AddNewCombustible(const FFireCellCombustible& Combustible) const
+{
+	FScopeLock Lock(&NewCombustiblesLock);
+	return NewCombustibles.Add(Combustible);
+}
+
+FFireCellGrid::FCellRef AFireSource::AddCell(const FIntVector2& CellKey, FFireCell Cell)
+{
+	const FFireCellGrid::FCellRef ExistingCell = Cells.FindRef(CellKey);
+	if (ExistingCell.IsValid())
+		ReleaseCombustible(ExistingCell);
+	
+	if (Cell.HasCombustible())
+	{
+		FScopeLock Lock(&NewCombustiblesLock);
+		Cell.CombustibleIndex = Combustibles.Add(NewCombustibles[Cell.CombustibleIndex]);
+	}
+	
+	return Cells.Emplace(CellKey, Cell);
+}
+
+FFireCellCombustible* AFireSource::FindCombustible(const FFireCellGrid::FCellRef& Cell)
+{
+	const int32 Index = Cell.GetCombustibleIndex();
+	return Index != INDEX_NONE ? &Combustibles[Index] : nullptr;
+}
+
+void AFireSource::ReleaseCombustible(const FFireCellGrid::FCellRef& Cell)
+{
+	const int32 Index = Cells.RemoveCombustible(Cell);
+	if (Index != INDEX_NONE)
+		Combustibles.RemoveAt(Index);
+}
+
+bool AFireSource::TryGetBakedCell(const FIntVector2& CellKey, const FVector& LocationBase, FFireCell& OutCell) const
+{
+	const FFireTerrainBake* Bake = &TerrainBake;
+	const FFireTerrainBakeCell* BakedCell = TerrainBake.Find(CellKey);
+	for (int32 i = 0; !BakedCell && i < FeederTerrainBakes.Num(); i++)
+	{
+		Bake = FeederTerrainBakes[i];
+		BakedCell = Bake->Find(CellKey);
+	}
+	
+	if (!BakedCell || EnumHasAnyFlags(BakedCell->Flags, EFireTerrainBakeFlags::RequiresSweep | EFireTerrainBakeFlags::Invalidated))
+		return false;
+
+	// runtime sweep goes from BaseFireStrength above LocationBase down to FireDownwardPropagationThreshold below it.
+	// bake only knows the topmost surface of a column, so if it's above that window there can be another surface below it that the sweep would hit
+	const bool bHit = EnumHasAnyFlags(BakedCell->Flags, EFireTerrainBakeFlags::Hit);
+	const double WindowTop = LocationBase.Z + BaseFireStrength + Bake->SweepHalfHeight;
+	const double WindowBottom = LocationBase.Z - FireDownwardPropagationThreshold - Bake->SweepHalfHeight;
+	if (bHit && BakedCell->SurfaceZ > WindowTop)
+		return false;
+	
+	if (!bHit || BakedCell->SurfaceZ < WindowBottom)
+	{
+		OutCell.bObstacle = true;
+		OutCell.Location = LocationBase;
+		return true;
+	}
+
+	OutCell.Location = Bake->GetCellLocation(CellKey, BakedCell->SurfaceZ);
+	if (EnumHasAnyFlags(BakedCell->Flags, EFireTerrainBakeFlags::Obstacle))
+	{
+		OutCell.bObstacle = true;
+	}
+	else
+	{
+		const FFireTerrainBakeSurface& Surface = Bake->Surfaces[BakedCell->SurfaceType];
+		if (Surface.bHasParameters)
+			ApplySurfaceParameters(Surface.Parameters, OutCell);
+	}
+	
+	return true;
+}
+
+void AFireSource::ApplySurfaceParameters(const FPhysicMaterialCombustionParameters& Parameters, FFireCell& OutCell) const
+{
+	OutCell.CombustionRate = Parameters.IgnitionRate;
+	OutCell.BurnoutRate = Parameters.BurnoutRate;
+	OutCell.FireHeight = Parameters.BurningStrength;
+}
+
+bool AFireSource::PrepareTerrainBake(FFireTerrainBake& OutBake, FBox& OutBounds) const
+{
+	OutBake.Reset();
+	OutBounds = BoxComponent->Bounds.GetBox();
+	const FVector Origin = GetGridOrigin();
+	const int64 MinX = FMath::FloorToInt64((OutBounds.Min.X - Origin.X) / FireCellSize);
+	const int64 MinY = FMath::FloorToInt64((OutBounds.Min.Y - Origin.Y) / FireCellSize);
+	const int64 SizeX = FMath::CeilToInt64((OutBounds.Max.X - Origin.X) / FireCellSize) - MinX + 1;
+	const int64 SizeY = FMath::CeilToInt64((OutBounds.Max.Y - Origin.Y) / FireCellSize) - MinY + 1;
+	// doubles are exact far above any volume size, so the product doesn't overflow before the check
+	const double ColumnsCount = static_cast<double>(SizeX) * static_cast<double>(SizeY);
+	if (ColumnsCount > MaxTerrainBakeColumns)
+	{
+		UE_VLOG_UELOG(this, LogFireSimulation, Warning, TEXT("%s: fire volume has %.0f cell columns, more than MaxTerrainBakeColumns %d. Terrain isn't baked, cells are swept at runtime"),
+					  *GetName(), ColumnsCount, MaxTerrainBakeColumns);
+		return false;
+	}
+
+	OutBake.Origin = Origin;
+	OutBake.CellSize = FireCellSize;
+	OutBake.SweepHalfHeight = BaseFireStrength * 0.5;
+	OutBake.MinKey = FIntVector2(static_cast<int32>(MinX), static_cast<int32>(MinY));
+	OutBake.Size = FIntPoint(static_cast<int32>(SizeX), static_cast<int32>(SizeY));
+	OutBake.Cells.SetNum(static_cast<int32>(SizeX * SizeY));
+
+	// settings are read directly and not from SurfacesCombustionParameters because this also runs in editor
+	auto FireSimSettings = GetDefault<UFireSimulationSettings>();
+	OutBake.Surfaces.SetNum(SurfaceType_Max);
+	for (int32 i = 0; i < SurfaceType_Max; i++)
+	{
+		const EPhysicalSurface SurfaceType = static_cast<EPhysicalSurface>(i);
+		OutBake.Surfaces[i].bIncombustible = FireSimSettings->IncombustibleSurfaces.Contains(SurfaceType);
+		if (const auto* Parameters = FireSimSettings->CombustionParameters.Find(SurfaceType))
+		{
+			OutBake.Surfaces[i].Parameters = *Parameters;
+			OutBake.Surfaces[i].bHasParameters = true;
+		}
+	}
+
+	return true;
+}
+
+void AFireSource::SweepTerrainBake(const UWorld* World, FFireTerrainBake& Bake, const FBox& Bounds, const FIntRect& Columns, EParallelForFlags Flags)
+{
+	FIRESIM_SCOPE(BakeTerrain);
+	const FCollisionShape SweepShape = FCollisionShape::MakeBox(FVector(Bake.CellSize * .5f, Bake.CellSize * .5f, Bake.SweepHalfHeight));
+	FCollisionQueryParams Params;
+	Params.bReturnPhysicalMaterial = true;
+	
+	// scene queries are thread safe, runtime sweeps of new cells run on workers as well
+	ParallelFor(Columns.Height(), [&Bake, &Bounds, &Columns, &SweepShape, &Params, World](int32 Row)
+	{
+		const int32 Y = Columns.Min.Y + Row;
+		for (int32 X = Columns.Min.X; X < Columns.Max.X; X++)
+		{
+			FFireTerrainBakeCell& Cell = Bake.Cells[Y * Bake.Size.X + X];
+			Cell = FFireTerrainBakeCell();
+			const FVector ColumnLocation = Bake.GetCellLocation(Bake.MinKey + FIntVector2(X, Y), 0.f);
+			const FVector SweepStart(ColumnLocation.X, ColumnLocation.Y, Bounds.Max.Z + Bake.SweepHalfHeight);
+			const FVector SweepEnd(ColumnLocation.X, ColumnLocation.Y, Bounds.Min.Z - Bake.SweepHalfHeight);
+			
+			FHitResult Hit;
+			if (!World->SweepSingleByChannel(Hit, SweepStart, SweepEnd, FQuat::Identity, COLLISION_COMBUSTIBLE, SweepShape, Params))
+				continue;
+
+			Cell.Flags = EFireTerrainBakeFlags::Hit;
+			Cell.SurfaceZ = Hit.ImpactPoint.Z;
+			if (Hit.PhysMaterial.IsValid())
+			{
+				Cell.SurfaceType = Hit.PhysMaterial->SurfaceType;
+				if (Bake.Surfaces[Cell.SurfaceType].bIncombustible)
+					Cell.Flags |= EFireTerrainBakeFlags::Obstacle;
+			}
+			else
+			{
+				Cell.Flags |= EFireTerrainBakeFlags::Obstacle;
+			}
+
+			// combustible actors can burn out, die or move. only static terrain is trusted
+			const UPrimitiveComponent* HitComponent = Hit.GetComponent();
+			if (Cast<ICombustible>(Hit.GetActor()) || Cast<UCombustibleInstancesComponent>(HitComponent) || (HitComponent && HitComponent->Mobility != EComponentMobility::Static))
+				Cell.Flags |= EFireTerrainBakeFlags::RequiresSweep;
+		}
+	}, Flags);
+}
+
+bool AFireSource::BakeTerrain(FFireTerrainBake& OutBake) const
+{
+	const double StartTime = FPlatformTime::Seconds();
+	FBox Bounds;
+	if (!PrepareTerrainBake(OutBake, Bounds))
+		return false;
+
+	SweepTerrainBake(GetWorld(), OutBake, Bounds, FIntRect(FIntPoint::ZeroValue, OutBake.Size), EParallelForFlags::None);
+	UE_VLOG_UELOG(this, LogFireSimulation, Log, TEXT("Baked fire terrain %dx%d in %.2f ms"), OutBake.Size.X, OutBake.Size.Y, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	return true;
+}
+
+void AFireSource::BakeTerrainAsync()
+{
+	TSharedPtr<FFireTerrainBake, ESPMode::ThreadSafe> Bake = MakeShared<FFireTerrainBake, ESPMode::ThreadSafe>();
+	FBox Bounds;
+	if (!PrepareTerrainBake(*Bake, Bounds))
+		return;
+
+	// TerrainBake stays empty meanwhile, so new cells are swept at runtime
+	PendingTerrainBake = Bake;
+	TerrainBakeTask = UE::Tasks::Launch(TEXT("FireSim.BakeTerrain"), [Bake, Bounds, World = GetWorld(), Name = GetName()]()
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		SweepTerrainBake(World, *Bake, Bounds, FIntRect(FIntPoint::ZeroValue, Bake->Size), EParallelForFlags::BackgroundPriority);
+		UE_LOG(LogFireSimulation, Log, TEXT("%s: baked fire terrain %dx%d in background in %.2f ms"), *Name, Bake->Size.X, Bake->Size.Y, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	}, UE::Tasks::ETaskPriority::BackgroundNormal);
+}
+
+#if WITH_EDITOR
+void AFireSource::BakeTerrainToAsset()
+{
+	if (!TerrainBakeData)
+	{
+		UE_LOG(LogFireSimulation, Warning, TEXT("%s: assign TerrainBakeData asset to bake terrain into"), *GetName());
+		return;
+	}
+
+	TerrainBakeData->Modify();
+	if (!BakeTerrain(TerrainBakeData->Bake))
+		UE_LOG(LogFireSimulation, Warning, TEXT("%s: volume is too large, asset bake is cleared. Raise MaxTerrainBakeColumns to bake it"), *GetName());
+
+	TerrainBakeData->MarkPackageDirty();
+}
+#endif
+
 void AFireSource::PrepareImmediateInitialCells(const FIntVector2& InitialCellKey, const FVector& BaseLocation)
 {
-	for (const FIntVector2& RadialDirection : RadialDirections)
+	for (const FIntVector2& RadialDirection : SpreadCore.GetRadialDirections())
 	{
+		// don't overwrite cells that are already burning or burnt out
+		if (Cells.Contains(InitialCellKey + RadialDirection))
+			continue;
+		
 		FFireCell FireCell;
 		FVector NewLocation = BaseLocation + FVector(RadialDirection.X, RadialDirection.Y, 0) * FireCellSize;
-		GetCell(NewLocation, FireCell);
-		Cells.Emplace(InitialCellKey + RadialDirection, FireCell);
+		GetCell(InitialCellKey + RadialDirection, NewLocation, FireCell);
+		AddCell(InitialCellKey + RadialDirection, FireCell);
 	}
 }
 
 bool AFireSource::StartFireAtCell(const FIntVector2& InitialCellKey, const FVector& OriginLocation)
 {
+	const FFireCellGrid::FCellRef ExistingCell = Cells.FindRef(InitialCellKey);
+	if (ExistingCell.IsValid() && ExistingCell.GetPhase() >= EFireCellPhase::Burning)
+	{
+		UE_VLOG_UELOG(this, LogFireSimulation, Log, TEXT("Can't start fire at %s, it's already burning or burnt out"), *OriginLocation.ToString())
+		return false;
+	}
+	
 	FFireCell InitialCell;
-	bool bInitialCellCreated = GetCell(OriginLocation, InitialCell);
+	bool bInitialCellCreated = GetCell(InitialCellKey, OriginLocation, InitialCell);
 	if (!bInitialCellCreated)
 	{
 		UE_VLOG_UELOG(this, LogFireSimulation, Warning, TEXT("Can't start fire at %s"), *OriginLocation.ToString())
@@ -276,15 +695,20 @@ bool AFireSource::StartFireAtCell(const FIntVector2& InitialCellKey, const FVect
 		return false;
 	}
 
-	Cells.Emplace(InitialCellKey, InitialCell);
-	Cells[InitialCellKey].CombustionState = 0.f;
+	InitialCell.CombustionState = 1.f;
+	const FFireCellGrid::FCellRef InitialCellRef = AddCell(InitialCellKey, InitialCell);
+	InitialCellRef.SetFlag(EFireCellFlags::EdgeCell, true);
+	InitialCellRef.SetPhase(EFireCellPhase::Burning);
+	InitialCellRef.SetIgnitionTime(SimulationTime);
+	InitialCellRef.TryClaim(EFireCellClaims::Ignition);
 	EdgeCells.Emplace(InitialCellKey);
+	BurningCells.Emplace(InitialCellKey);
+	Cells.EnsureTilesAround(InitialCellKey, 2);
 
-	FireLocations.Emplace(OriginLocation);
-	NewFireLocations.Emplace(OriginLocation);
-	MARK_PROPERTY_DIRTY_FROM_NAME(AFireSource, FireLocations, this);
-	MARK_PROPERTY_DIRTY_FROM_NAME(AFireSource, NewFireLocations, this);
+	AddFireLocation(InitialCellRef, OriginLocation);
+	MARK_PROPERTY_DIRTY_FROM_NAME(AFireSource, ReplicatedCells, this);
 	UpdateFireLocations();
+	UpdateFireQueryIndex();
 	
 	PrepareImmediateInitialCells(InitialCellKey, OriginLocation);
 	
@@ -293,8 +717,15 @@ bool AFireSource::StartFireAtCell(const FIntVector2& InitialCellKey, const FVect
 
 void AFireSource::StartFire()
 {
-	auto WindComponent = GetWorld()->GetGameState()->FindComponentByClass<UWindComponent>();
-	if (ensure(WindComponent))
+	AFireSource* Host = GetSimulationHost();
+	if (Host != this)
+	{
+		Host->StartFireAtLocation(GetActorLocation());
+		return;
+	}
+	
+	WindComponent = GetWorld()->GetGameState()->FindComponentByClass<UWindComponent>();
+	if (ensure(WindComponent.IsValid()))
 	{
 		OnWindChanged(WindComponent->GetWindDirection(), WindComponent->GetWindStrength());
 		WindComponent->WindChangedEvent.AddUObject(this, &AFireSource::OnWindChanged);
@@ -306,10 +737,10 @@ void AFireSource::StartFire()
 	if (!Cells.IsEmpty())
 		return;
 	
-	Cells.Reserve(FireSpreadLimit * FireSpreadLimit);
 	EdgeCells.Reserve(FireSpreadLimit * 2);
-	FIntVector2 InitialCellKey = { 0, 0 };
-	FVector OriginLocation = GetActorLocation(); 
+	const FVector ActorLocation = GetActorLocation();
+	const FIntVector2 InitialCellKey = GetCellKey(ActorLocation);
+	FVector OriginLocation(InitialCellKey.X * FireCellSize, InitialCellKey.Y * FireCellSize, ActorLocation.Z); 
 	
 	StartFireAtCell(InitialCellKey, OriginLocation);
 }
@@ -319,7 +750,7 @@ void AFireSource::SetFirePaused(bool bPaused)
 	SetActorTickEnabled(!bPaused);
 }
 
-void AFireSource::SpreadFireAsync()
+void AFireSource::SpreadFireAsync(float StepDeltaTime)
 {
 	bAsyncUpdateRunning.store(true);
 	// what happens asynchronously:
@@ -329,169 +760,379 @@ void AFireSource::SpreadFireAsync()
 	//	   2.2 mark actors that have combustible interface 
 	//	   2.3 mark for removal those who have no more pending neighbor cells
 	// 3. updating contiguous box collisions for damage and nav mesh
+	// spreading runs first, then edge pruning and new cells creation run in parallel since both only read the grid
 	UE_VLOG(this, LogFireSimulation, Log, TEXT("SpreadFireAsync::Start"));
-	Async(EAsyncExecution::ThreadPool, [this]()
+
+	SimulationTime += StepDeltaTime;
+	if (WindComponent.IsValid() && (bWindChanged || WindComponent->HasGusts()))
 	{
-		int ThreadsCount = FPlatformMisc::NumberOfCoresIncludingHyperthreads();
+		// cells that slept under the old wind direction can have somewhere to spread now
+		if (bWindChanged)
+			WakeAllSleepingEdgeCells();
 		
-		TArray<TFuture<FAsyncFireSpreadResult>> ThreadResults;
-		TArray<FIntVector2> EdgeCellsArray = EdgeCells.Array();
-		int EdgeCellsCount = EdgeCells.Num();
-		int BaseBatchSize = EdgeCellsCount < ThreadsCount ? EdgeCellsCount : EdgeCellsCount / ThreadsCount;
-		int BatchStartIndex = 0;
-		int CurrentBatchSize = BaseBatchSize;
-		while (BatchStartIndex < EdgeCellsCount)
-		{
-			CurrentBatchSize = FMath::Min(EdgeCellsCount - BatchStartIndex, BaseBatchSize);
-			TFuture<FAsyncFireSpreadResult> Future = Async(EAsyncExecution::Thread, [this, &EdgeCellsArray, BatchStartIndex, CurrentBatchSize]()
+		WindComponent->EvaluateWindField(SimulationTime, Wind);
+		bWindChanged = false;
+		// gusts only change strength, but weak enough wind spreads fire all around
+		bWindDirectional = Wind.GetMinStrength() > SpreadCore.Settings.WindEffectActivationThreshold;
+	}
+	
+	if (!bWindDirectional || !bSleepStalledEdgeCells)
+		WakeAllSleepingEdgeCells();
+	
+	for (const FBox& WakeBox : PendingEdgeCellsWakeBoxes)
+		WakeSleepingEdgeCells(WakeBox);
+	
+	PendingEdgeCellsWakeBoxes.Reset();
+	
+	FFireSpreadStepParams StepParams;
+	StepParams.DeltaTime = StepDeltaTime;
+	StepParams.SimulationTime = SimulationTime;
+	StepParams.Wind = Wind;
+	StepParams.bDeterministic = bDeterministicSimulation;
+	StepParams.bEdgeCellsCanSleep = bSleepStalledEdgeCells && bWindDirectional;
+	SpreadCore.BeginStep(StepParams);
+	
+	UpdateSimulationLod(StepDeltaTime);
+	if (IsSimulationLodEnabled())
+	{
+		// edge cells of skipped regions don't spread this step, burning cells of skipped regions are skipped by burnout itself
+		EdgeCellsSnapshot.Reset(EdgeCells.Num());
+		for (const FIntVector2& EdgeCell : EdgeCells)
+		{
+			if (Cells.FindRef(EdgeCell).Tile->StepDeltaTime > 0.f)
+				EdgeCellsSnapshot.Emplace(EdgeCell);
+		}
+	}
+	else
+	{
+		EdgeCellsSnapshot = EdgeCells.Array();
+	}
+	
+	SpreadResult = FAsyncFireSpreadResult();
+	StepReport = FFireSimulationStepReport();
+	StepReport.EdgeCells = EdgeCellsSnapshot.Num();
+	StepReport.BurningCells = BurningCells.Num();
+	const int32 WorkersCount = GetSimulationWorkersCount();
+	
+	UE::Tasks::FTask SpreadTask = UE::Tasks::Launch(TEXT("FireSim.Spread"), [this, WorkersCount]()
+	{
+		// 1. spreading fire by edge cells
+		FIRESIM_SCOPE(Spread);
+		const double StageStartTime = FPlatformTime::Seconds();
+		TArray<FFireSpreadWorkerResult> WorkerResults;
+		WorkerResults.SetNum(WorkersCount);
+		if (SpreadCore.GetStepParams().bDeterministic)
+		{
+			SpreadFireDeterministic(WorkersCount, WorkerResults);
+		}
+		else
+		{
+			RunSimulationStage(SpreadStageStats, EdgeCellsSnapshot.Num(), WorkersCount, [this, &WorkerResults](int32 WorkerIndex, int32 Start, int32 End)
 			{
-				// FIRESIM_LOG_ASYNC_RAW(TEXT("Spread fire in thread"), Verbose);
-				FAsyncFireSpreadResult BatchResult;
-				SpreadFireBatch(EdgeCellsArray, BatchStartIndex, BatchStartIndex + CurrentBatchSize, BatchResult);
-				return BatchResult;
+				SpreadCore.SpreadFireBatch(EdgeCellsSnapshot, Start, End, WorkerResults[WorkerIndex]);
 			});
+		}
 
-			BatchStartIndex += CurrentBatchSize;
-			ThreadResults.Add(MoveTemp(Future));
+		// cells are claimed by the first worker that reports them, so worker results are disjoint and can be just concatenated
+		FireSimulation::ConcatenateParallel(WorkerResults, &FFireSpreadWorkerResult::IgnitedCells, SpreadResult.IgnitedCells);
+		FireSimulation::ConcatenateParallel(WorkerResults, &FFireSpreadWorkerResult::StalledEdgeCells, SpreadResult.StalledEdgeCells);
+		TArray<FIntVector2> CombustionActorCells;
+		FireSimulation::ConcatenateParallel(WorkerResults, &FFireSpreadWorkerResult::CombustionActorCells, CombustionActorCells);
+		if (SpreadCore.GetStepParams().bDeterministic)
+		{
+			// order of concatenated results depends on how batches were distributed between workers
+			SpreadResult.IgnitedCells.Sort(FireSimulation::FCellKeyLess());
+			SpreadResult.StalledEdgeCells.Sort(FireSimulation::FCellKeyLess());
+			CombustionActorCells.Sort(FireSimulation::FCellKeyLess());
 		}
 		
-		FAsyncFireSpreadResult AggregatedResult;
-		for (int i = 0; i < ThreadResults.Num(); i++)
+		IgnitedCellsSnapshot = SpreadResult.IgnitedCells;
+		SpreadResult.CombustionActorUpdates.Reserve(CombustionActorCells.Num());
+		for (const FIntVector2& CombustionActorCellIndex : CombustionActorCells)
 		{
-			auto ThreadFireSpreadResult = MoveTemp(ThreadResults[i].GetMutable());
-			AggregatedResult.Aggregate(ThreadFireSpreadResult);
+			const FFireCellGrid::FCellRef CombustionActorCell = Cells.FindRef(CombustionActorCellIndex);
+			const float AggregatedIncrease = CombustionActorCell.Tile->PendingActorCombustion[CombustionActorCell.LocalIndex].exchange(0.f);
+			CombustionActorCell.ReleaseClaim(EFireCellClaims::ActorUpdate);
+			SpreadResult.CombustionActorUpdates.Emplace(CombustionActorCellIndex, AggregatedIncrease);
 		}
-
-		// Make new cells for ignited cells
-		CreateNewFireCells(AggregatedResult);
 		
-		// 3. updating contiguous box collisions for damage and nav mesh
-		// TODO
-		
-		AsyncTask(ENamedThreads::Type::GameThread, [this, AggregatedResult = MoveTemp(AggregatedResult)] () mutable
-		{
-			UE_VLOG(this, LogFireSimulation, Log, TEXT("SpreadFireAsync::End\nCombustion actor updates: %d\nIgnited cells: %d\nNot edge cells anymore: %d\nNew cells: %d"),
-				AggregatedResult.CombustionActorUpdates.Num(), AggregatedResult.IgnitedCells.Num(), AggregatedResult.NotEdgeCellAnymore.Num(), AggregatedResult.NewCells.Num());
-
-#if WITH_EDITOR
-			if (bLog_Debug)
-			{
-				for (const auto& CombustionActor : AggregatedResult.CombustionActorUpdates)
-				{
-					auto Index = FIntVector2(CombustionActor.Key.X, CombustionActor.Key.Y);
-					UE_VLOG_LOCATION(this, LogFireSimulation_Actors, VeryVerbose, Cells[Index].Location, 25, FColor::Yellow, TEXT("Combustible actor update"));
-				}
-
-				for (const auto& IgnitedCell : AggregatedResult.IgnitedCells)
-				{
-					auto Index = FIntVector2(IgnitedCell.X, IgnitedCell.Y);
-					UE_VLOG_LOCATION(this, LogFireSimulation, VeryVerbose, Cells[Index].Location, 25, FColor::Orange, TEXT("Ignited cell"));
-				}
-
-				for (const auto& NotEdgeCellAnymore : AggregatedResult.NotEdgeCellAnymore)
-				{
-					auto Index = FIntVector2(NotEdgeCellAnymore.X, NotEdgeCellAnymore.Y);
-					UE_VLOG_LOCATION(this, LogFireSimulation_EdgeCells, Verbose, Cells[Index].Location, 25, FColor::Black, TEXT("Not edge cell anymore"));
-				}
-
-				for (const auto& NewCell : AggregatedResult.NewCells)
-				{
-					UE_VLOG_LOCATION(this, LogFireSimulation, VeryVerbose, NewCell.Value.Location, 25, FColor::White, TEXT("New cell"));
-				}
-			}
-#endif			
-			ProcessFireSpreadResult(AggregatedResult);
-			bAsyncUpdateRunning.store( false);
-		});
+		StepReport.SpreadMs = (FPlatformTime::Seconds() - StageStartTime) * 1000.0;
 	});
-}
 
-void AFireSource::CreateNewFireCells(FAsyncFireSpreadResult& AggregatedResult)
-{
-	if (AggregatedResult.IgnitedCells.IsEmpty())
-		return;
-
-	const int ThreadsCount = FPlatformMisc::NumberOfCoresIncludingHyperthreads();
-
-	const int IgnitedCellsNum = AggregatedResult.IgnitedCells.Num();
-	int BaseBatchSize = IgnitedCellsNum < ThreadsCount ? IgnitedCellsNum : IgnitedCellsNum / ThreadsCount;
-	int BatchStartIndex = 0;
-	int CurrentBatchSize = BaseBatchSize;
-	TArray<TFuture<TMap<FIntVector2, FFireCell>>> AllNewCellsFutures;
-	const auto IgnitedCellsArray = AggregatedResult.IgnitedCells.Array();
-
-	while (BatchStartIndex < IgnitedCellsNum)
+	UE::Tasks::FTask PruneEdgeCellsTask = UE::Tasks::Launch(TEXT("FireSim.PruneEdgeCells"), [this, WorkersCount]()
 	{
-		CurrentBatchSize = FMath::Min(IgnitedCellsNum - BatchStartIndex, BaseBatchSize);
-		TFuture<TMap<FIntVector2, FFireCell>> Future = Async(EAsyncExecution::ThreadPool, [this, &IgnitedCellsArray, BatchStartIndex, CurrentBatchSize]()
+		//	2.3 mark for removal those who have no more pending neighbor cells
+		FIRESIM_SCOPE(PruneEdgeCells);
+		const double StageStartTime = FPlatformTime::Seconds();
+		TArray<FFireSpreadWorkerResult> WorkerResults;
+		WorkerResults.SetNum(WorkersCount);
+		RunSimulationStage(PruneEdgeCellsStageStats, EdgeCellsSnapshot.Num(), WorkersCount, [this, &WorkerResults](int32 WorkerIndex, int32 Start, int32 End)
 		{
-			TMap<FIntVector2, FFireCell> BatchResult;
-			BatchResult.Reserve(CurrentBatchSize * 4); // in general, a cell has 3 pending neighbors, but corner cells can have 5 
-			int End = BatchStartIndex + CurrentBatchSize;
-			for (int i = BatchStartIndex; i < End; i++)
-			{
-				auto IgnitedCellIndex = IgnitedCellsArray[i];
-				for (const auto& RadialDirection : RadialDirections)
-				{
-					auto TestCellIndex = IgnitedCellIndex + RadialDirection;
-					if (!Cells.Contains(TestCellIndex))
-					{
-						FFireCell NewCell;
-						FVector IgnitorLocation = Cells[IgnitedCellIndex].Location;
-						// if (Cells[IgnitedCellIndex].CombustibleActor.IsValid())
-						// 	IgnitorLocation -= FVector::UpVector * Cells[IgnitedCellIndex].GetCombustibleActorHeight();
-						
-						FVector NeighborLocation = IgnitorLocation + FVector(RadialDirection.X, RadialDirection.Y, 0) * FireCellSize;
-						GetCell(NeighborLocation, NewCell);
-						BatchResult.Emplace(TestCellIndex, NewCell);
-					}
-				}
-			}
-					
-			return BatchResult;
+			SpreadCore.MarkEdgeCellsForRemoval(EdgeCellsSnapshot, Start, End, WorkerResults[WorkerIndex]);
 		});
 
-		BatchStartIndex += CurrentBatchSize;
-		AllNewCellsFutures.Add(MoveTemp(Future));
-	}
+		FireSimulation::ConcatenateParallel(WorkerResults, &FFireSpreadWorkerResult::NotEdgeCellAnymore, SpreadResult.NotEdgeCellAnymore);
+		StepReport.PruneEdgeCellsMs = (FPlatformTime::Seconds() - StageStartTime) * 1000.0;
+	}, UE::Tasks::Prerequisites(SpreadTask));
+
+	UE::Tasks::FTask CreateNewCellsTask = UE::Tasks::Launch(TEXT("FireSim.CreateNewCells"), [this, WorkersCount]()
+	{
+		// Make new cells for ignited cells
+		FIRESIM_SCOPE(CreateNewCells);
+		const double StageStartTime = FPlatformTime::Seconds();
+		TArray<FFireSpreadWorkerResult> WorkerResults;
+		WorkerResults.SetNum(WorkersCount);
+		RunSimulationStage(CreateNewCellsStageStats, IgnitedCellsSnapshot.Num(), WorkersCount, [this, &WorkerResults](int32 WorkerIndex, int32 Start, int32 End)
+		{
+			SpreadCore.CreateNewFireCells(IgnitedCellsSnapshot, Start, End, WorkerResults[WorkerIndex]);
+		});
+		
+		FireSimulation::ConcatenateParallel(WorkerResults, &FFireSpreadWorkerResult::NewCells, SpreadResult.NewCells);
+		if (SpreadCore.GetStepParams().bDeterministic)
+		{
+			SpreadResult.NewCells.Sort([](const TPair<FIntVector2, FFireCell>& A, const TPair<FIntVector2, FFireCell>& B)
+			{
+				return FireSimulation::FCellKeyLess()(A.Key, B.Key);
+			});
+		}
 		
-	for (int i = 0; i < AllNewCellsFutures.Num(); i++)
+		StepReport.CreateNewCellsMs = (FPlatformTime::Seconds() - StageStartTime) * 1000.0;
+	}, UE::Tasks::Prerequisites(SpreadTask));
+		
+	// 3. updating contiguous box collisions for damage and nav mesh. Decomposes regions changed by the previous step, doesn't touch the grid
+	BurningAreaRegionsSnapshot = BurningArea.ExtractDirtyRegions();
+	UE::Tasks::FTask BurningAreaTask = UE::Tasks::Launch(TEXT("FireSim.DecomposeBurningArea"), [this]()
 	{
-		auto ThreadFireSpreadResult = MoveTemp(AllNewCellsFutures[i].GetMutable());
-		AggregatedResult.NewCells.Append(MoveTemp(ThreadFireSpreadResult));
-	}
+		DecomposeBurningArea();
+	});
+
+	UE::Tasks::FTask BurnoutTask = UE::Tasks::Launch(TEXT("FireSim.Burnout"), [this, WorkersCount]()
+	{
+		// burn fuel of burning cells. Only touches fuel and phase of already ignited cells, so it can run alongside other stages
+		FIRESIM_SCOPE(Burnout);
+		const double StageStartTime = FPlatformTime::Seconds();
+		TArray<FFireSpreadWorkerResult> WorkerResults;
+		WorkerResults.SetNum(WorkersCount);
+		RunSimulationStage(BurnoutStageStats, BurningCells.Num(), WorkersCount, [this, &WorkerResults](int32 WorkerIndex, int32 Start, int32 End)
+		{
+			SpreadCore.BurnOutCells(BurningCells, Start, End, WorkerResults[WorkerIndex]);
+		});
+
+		FireSimulation::ConcatenateParallel(WorkerResults, &FFireSpreadWorkerResult::BurntOutCells, SpreadResult.BurntOutCells);
+		FireSimulation::ConcatenateParallel(WorkerResults, &FFireSpreadWorkerResult::SmolderingCells, SpreadResult.SmolderingCells);
+		if (SpreadCore.GetStepParams().bDeterministic)
+		{
+			SpreadResult.BurntOutCells.Sort(FireSimulation::FCellKeyLess());
+			SpreadResult.SmolderingCells.Sort(FireSimulation::FCellKeyLess());
+		}
+		
+		StepReport.BurnoutMs = (FPlatformTime::Seconds() - StageStartTime) * 1000.0;
+	}, UE::Tasks::Prerequisites(SpreadTask));
+
+	// result is picked up on game thread in Tick once the pipeline is completed
+	SpreadPipelineTask = UE::Tasks::Launch(TEXT("FireSim.Join"), []() {}, UE::Tasks::Prerequisites(PruneEdgeCellsTask, CreateNewCellsTask, BurnoutTask, BurningAreaTask));
+}
+
+void AFireSource::UpdateSimulationLod(float StepDeltaTime)
+{
+	FIRESIM_SCOPE(UpdateSimulationLod);
+	TArray<FVector, TInlineAllocator<8>> ViewLocations;
+	if (IsSimulationLodEnabled())
+		GatherViewLocations(false, ViewLocations);
+	
+	// nobody to pick the distance from (idle server, tests) - full rate everywhere
+	const int32 LodsCount = ViewLocations.IsEmpty() ? 0 : FMath::Min(SimulationLodDistances.Num(), 3);
+	const double TileWorldSize = FFireCellGrid::TileSize * FireCellSize;
+	Cells.ForEachTile([&](FFireCellGrid::FTile& Tile)
+	{
+		Tile.PendingDeltaTime += StepDeltaTime;
+		uint8 Lod = 0;
+		if (LodsCount > 0)
+		{
+			// cell keys are world-aligned, cell (X, Y) is centered at (X, Y) * FireCellSize
+			const FVector2D TileMin((Tile.Coord.X * FFireCellGrid::TileSize - 0.5) * FireCellSize, (Tile.Coord.Y * FFireCellGrid::TileSize - 0.5) * FireCellSize);
+			const FBox2D TileBounds(TileMin, TileMin + FVector2D(TileWorldSize, TileWorldSize));
+			double DistanceSquared = DBL_MAX;
+			for (const FVector& ViewLocation : ViewLocations)
+				DistanceSquared = FMath::Min(DistanceSquared, TileBounds.ComputeSquaredDistanceToPoint(FVector2D(ViewLocation)));
+			
+			while (Lod < LodsCount && DistanceSquared > FMath::Square(SimulationLodDistances[Lod]))
+				Lod++;
+		}
+		
+		// regions of the same LOD are spread over the steps of their interval instead of all being stepped at once
+		const uint32 StepInterval = 1u << Lod;
+		const bool bStep = Lod < Tile.SimulationLod || ((SimulationStepIndex + static_cast<uint32>(Tile.Coord.X + Tile.Coord.Y)) & (StepInterval - 1)) == 0;
+		Tile.SimulationLod = Lod;
+		Tile.StepDeltaTime = bStep ? Tile.PendingDeltaTime : 0.f;
+		if (bStep)
+			Tile.PendingDeltaTime = 0.f;
+	});
+	
+	SimulationStepIndex++;
 }
 
-void AFireSource::MarkEdgeCellForRemoval(const FIntVector2& EdgeCellIndex, FAsyncFireSpreadResult& Result)
+void AFireSource::CompleteSpreadFireAsync()
 {
-	bool bMustRemoveEdgeCell = true;
-	//	2.3 mark for removal those who have no more pending neighbor cells
-	for (const auto& Direction : RadialDirections)
+	UE_VLOG(this, LogFireSimulation, Log, TEXT("SpreadFireAsync::End\nCombustion actor updates: %d\nIgnited cells: %d\nNot edge cells anymore: %d\nNew cells: %d\nBurnt out cells: %d"),
+		SpreadResult.CombustionActorUpdates.Num(), SpreadResult.IgnitedCells.Num(), SpreadResult.NotEdgeCellAnymore.Num(), SpreadResult.NewCells.Num(),
+		SpreadResult.BurntOutCells.Num());
+
+#if WITH_EDITOR
+	if (bLog_Debug)
 	{
-		FIntVector2 TestCellIndex = EdgeCellIndex + Direction;
-		if (IsCombustible(Cells[TestCellIndex], Cells[EdgeCellIndex]))
+		for (const auto& CombustionActor : SpreadResult.CombustionActorUpdates)
 		{
-			bMustRemoveEdgeCell = false;
-			break;
+			auto Index = FIntVector2(CombustionActor.Key.X, CombustionActor.Key.Y);
+			UE_VLOG_LOCATION(this, LogFireSimulation_Actors, VeryVerbose, Cells.FindRef(Index).GetLocation(), 25, FColor::Yellow, TEXT("Combustible actor update"));
 		}
+
+		for (const auto& IgnitedCell : SpreadResult.IgnitedCells)
+		{
+			auto Index = FIntVector2(IgnitedCell.X, IgnitedCell.Y);
+			UE_VLOG_LOCATION(this, LogFireSimulation, VeryVerbose, Cells.FindRef(Index).GetLocation(), 25, FColor::Orange, TEXT("Ignited cell"));
+		}
+
+		for (const auto& NotEdgeCellAnymore : SpreadResult.NotEdgeCellAnymore)
+		{
+			auto Index = FIntVector2(NotEdgeCellAnymore.X, NotEdgeCellAnymore.Y);
+			UE_VLOG_LOCATION(this, LogFireSimulation_EdgeCells, Verbose, Cells.FindRef(Index).GetLocation(), 25, FColor::Black, TEXT("Not edge cell anymore"));
+		}
+
+		for (const auto& NewCell : SpreadResult.NewCells)
+		{
+			UE_VLOG_LOCATION(this, LogFireSimulation, VeryVerbose, NewCell.Value.Location, 25, FColor::White, TEXT("New cell"));
+		}
+	}
+#endif
+	
+	StepReport.IgnitedCells = SpreadResult.IgnitedCells.Num();
+	StepReport.NewCells = SpreadResult.NewCells.Num();
+	StepReport.BurntOutCells = SpreadResult.BurntOutCells.Num();
+	
+	const double ProcessResultStartTime = FPlatformTime::Seconds();
+	ProcessFireSpreadResult(SpreadResult);
+	ApplyBurningAreaBoxes();
+	StepReport.ProcessResultMs = (FPlatformTime::Seconds() - ProcessResultStartTime) * 1000.0;
+	StepReport.PendingActorUpdates = CombustibleUpdates.Num();
+	SET_DWORD_STAT(STAT_FireSim_IgnitionsPerStep, StepReport.IgnitedCells);
+	SET_DWORD_STAT(STAT_FireSim_NewCellsPerStep, StepReport.NewCells);
+	SpreadResult = FAsyncFireSpreadResult();
+	bAsyncUpdateRunning.store(false);
+	
+	UpdateTerrainBake();
+	for (const TWeakObjectPtr<AFireSource>& Feeder : Feeders)
+		if (Feeder.IsValid())
+			Feeder->UpdateTerrainBake();
+}
+
+void AFireSource::InvalidateTerrainBake(const FBox& WorldBox)
+{
+	// workers of the host read this bake when they create new cells. Background bake could have swept the column before the change
+	if (PendingTerrainBake.IsValid() || GetSimulationHost()->bAsyncUpdateRunning.load())
+		PendingTerrainBakeInvalidations.Add(WorldBox);
+	else
+		TerrainBake.Invalidate(WorldBox);
+}
+
+void AFireSource::UpdateTerrainBake()
+{
+	if (PendingTerrainBake.IsValid())
+	{
+		if (!TerrainBakeTask.IsCompleted())
+			return;
+
+		TerrainBake = MoveTemp(*PendingTerrainBake);
+		PendingTerrainBake.Reset();
+		// AddFeeder skipped the bake while it wasn't ready
+		AFireSource* Host = GetSimulationHost();
+		if (Host != this && FMath::IsNearlyEqual(TerrainBake.SweepHalfHeight, Host->BaseFireStrength * 0.5))
+			Host->FeederTerrainBakes.AddUnique(&TerrainBake);
 	}
-					
-	if (bMustRemoveEdgeCell)
-		Result.NotEdgeCellAnymore.Emplace(EdgeCellIndex);
+	
+	for (const FBox& WorldBox : PendingTerrainBakeInvalidations)
+		TerrainBake.Invalidate(WorldBox);
+
+	PendingTerrainBakeInvalidations.Reset();
+
+	// rebaked columns drop the Invalidated flag. Whatever is still there and isn't static is hit again and keeps them swept at runtime
+	const FBox Bounds = BoxComponent->Bounds.GetBox();
+	for (const FBox& WorldBox : PendingTerrainBakeRebakes)
+	{
+		const FIntRect Columns = TerrainBake.GetColumns(WorldBox);
+		if (Columns.Area() > 0)
+			SweepTerrainBake(GetWorld(), TerrainBake, Bounds, Columns, EParallelForFlags::None);
+	}
+
+	PendingTerrainBakeRebakes.Reset();
+}
+
+bool AFireSource::AffectsTerrainBake(const AActor* OtherActor, const UPrimitiveComponent* OtherComp) const
+{
+	return OtherActor != this && OtherComp && !Cast<APawn>(OtherActor) && OtherComp->GetCollisionResponseToChannel(COLLISION_COMBUSTIBLE) == ECR_Block;
+}
+
+int32 AFireSource::GetSimulationWorkersCount() const
+{
+	const int32 AvailableWorkers = FMath::Max(1, FTaskGraphInterface::Get().GetNumWorkerThreads());
+	return SimulationThreadsCount > 0 ? FMath::Min(SimulationThreadsCount, AvailableWorkers) : AvailableWorkers;
+}
+
+template<typename TBody>
+void AFireSource::RunSimulationStage(FFireSimulationStageStats& StageStats, int32 ItemsCount, int32 WorkersCount, TBody&& Body) const
+{
+	if (ItemsCount <= 0)
+		return;
+	
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 BatchSize = StageStats.GetBatchSize(TargetBatchMicroseconds);
+	const int32 TasksCount = FMath::Clamp(FMath::DivideAndRoundUp(ItemsCount, BatchSize), 1, WorkersCount);
+	
+	// workers pull batches from a shared cursor, so whoever is done early takes over the rest of the work
+	std::atomic<int32> Cursor = 0;
+	auto Worker = [&Cursor, &Body, ItemsCount, BatchSize](int32 WorkerIndex)
+	{
+		FIRESIM_SCOPE(StageWorker);
+		for (int32 Start = Cursor.fetch_add(BatchSize); Start < ItemsCount; Start = Cursor.fetch_add(BatchSize))
+			Body(WorkerIndex, Start, FMath::Min(Start + BatchSize, ItemsCount));
+	};
+
+	TArray<UE::Tasks::FTask> WorkerTasks;
+	WorkerTasks.Reserve(TasksCount - 1);
+	for (int32 WorkerIndex = 1; WorkerIndex < TasksCount; WorkerIndex++)
+		WorkerTasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [&Worker, WorkerIndex]() { Worker(WorkerIndex); }));
+
+	// stage task is a worker too
+	Worker(0);
+	UE::Tasks::Wait(WorkerTasks);
+	
+	StageStats.Update(ItemsCount, TasksCount, FPlatformTime::Seconds() - StartTime);
 }
 
 void AFireSource::ProcessFireSpreadResult(FAsyncFireSpreadResult& AggregatedResult)
 {
+	FIRESIM_SCOPE(ProcessFireSpreadResult);
 	// after async update is completed, on game thread
 	// 5. Remove pending edge cells that are no more edge cells
 	// 6. Append new cells
 	// 7. Update FVector array of fire locations for niagara (and replicate)
 	// 8. Add ignited cells to edge cells if there are combustible cells around it
 	// 9. Update all ICombustible actors (or add them to a time-sliced queue on game thread)
+	// 10. Remove burnt out cells from fire and compact tiles that burnt out completely
 	
 	// 5. Remove pending edge cells that are no more edge cells
 	for (const auto& NotEdgeCellAnymore : AggregatedResult.NotEdgeCellAnymore)
+	{
 		EdgeCells.Remove(NotEdgeCellAnymore);
+		Cells.FindRef(NotEdgeCellAnymore).SetFlag(EFireCellFlags::EdgeCell, false);
+	}
+	
+	// 5.1 Put edge cells that have nothing to spread to under current wind to sleep. Pruned ones are already gone
+	for (const FIntVector2& StalledEdgeCell : AggregatedResult.StalledEdgeCells)
+	{
+		if (EdgeCells.Remove(StalledEdgeCell) > 0)
+			SleepEdgeCell(Cells.FindRef(StalledEdgeCell));
+	}
 
 #if WITH_EDITOR
 	if (bLog_Debug)
@@ -504,42 +1145,84 @@ void AFireSource::ProcessFireSpreadResult(FAsyncFireSpreadResult& AggregatedResu
 	}
 #endif
 	
-	// 6. Append new cells
-	if (!AggregatedResult.NewCells.IsEmpty())
-		Cells.Append(MoveTemp(AggregatedResult.NewCells));
+	// 6. Append new cells. Workers are done, so combustibles they found can be dropped once the cells took theirs
+	for (const auto& NewCell : AggregatedResult.NewCells)
+		AddCell(NewCell.Key, NewCell.Value);
+	
+	NewCombustibles.Reset();
 	
 	// 7. Update FVector array of fire locations for niagara (and replicate)
 	if (AggregatedResult.IgnitedCells.Num() > 0)
 	{
 		for (const auto& IgnitedCellIndex : AggregatedResult.IgnitedCells)
 		{
-			const auto& IgnitedCell = Cells[IgnitedCellIndex];
-			FireLocations.Emplace(IgnitedCell.Location);
-			NewFireLocations.Emplace(IgnitedCell.Location);
-			bool bIgnitedCellIsEdgeCell = false;
-			
-			for (const auto& Direction : RadialDirections)
-			{
-				FIntVector2 NeighborCellIndex = IgnitedCellIndex + Direction;
-				if (ensure(Cells.Contains(NeighborCellIndex)) && IsCombustible(Cells[NeighborCellIndex], IgnitedCell))
-				{
-					bIgnitedCellIsEdgeCell = true;
-					break;
-				}
-			}
+			const FFireCellGrid::FCellRef IgnitedCell = Cells.FindRef(IgnitedCellIndex);
+			IgnitedCell.SetPhase(EFireCellPhase::Burning);
+			IgnitedCell.SetIgnitionTime(SimulationTime);
+			BurningCells.Emplace(IgnitedCellIndex);
+			AddFireLocation(IgnitedCell, IgnitedCell.GetLocation());
+			if (SleepingEdgeCellsCount > 0)
+				WakeSleepingNeighbors(IgnitedCell);
 			
 			// 8. Add ignited cells to edge cells if there are combustible cells around it
-			if (bIgnitedCellIsEdgeCell)
+			if (SpreadCore.HasCombustibleNeighbors(IgnitedCell))
+			{
 				EdgeCells.Emplace(IgnitedCellIndex);
+				IgnitedCell.SetFlag(EFireCellFlags::EdgeCell, true);
+				Cells.EnsureTilesAround(IgnitedCellIndex, 2);
+			}
 		}
 
-		MARK_PROPERTY_DIRTY_FROM_NAME(AFireSource, FireLocations, this);
-		MARK_PROPERTY_DIRTY_FROM_NAME(AFireSource, NewFireLocations, this);
+		MARK_PROPERTY_DIRTY_FROM_NAME(AFireSource, ReplicatedCells, this);
 		UpdateFireLocations();
 	}
 	
-	// 9. add actor updates to a time-sliced queue on game thread)
-	PendingBurningActorsUpdates.Append(AggregatedResult.CombustionActorUpdates.Array());
+	// 9. add actor updates to a time-sliced queue on game thread). Updates of an actor from all its cells are merged into one.
+	// instanced props are cheap to update, so they are updated right away
+	for (const TPair<FIntVector2, float>& CombustionActorUpdate : AggregatedResult.CombustionActorUpdates)
+	{
+		const FFireCellGrid::FCellRef Cell = Cells.FindRef(CombustionActorUpdate.Key);
+		if (!Cell.IsValid())
+			continue;
+		
+		FFireCellCombustible* Combustible = FindCombustible(Cell);
+		if (Combustible && Combustible->Instances.IsValid())
+		{
+			if (Combustible->Instances->AddCombustion(Combustible->InstanceIndex, CombustionActorUpdate.Value))
+				Cell.SetFlag(EFireCellFlags::CombustibleActorIgnited, true);
+		}
+		else if (Combustible && Combustible->Actor.IsValid())
+		{
+			CombustibleUpdates.Enqueue(*Combustible, CombustionActorUpdate.Key, CombustionActorUpdate.Value);
+		}
+		else
+		{
+			ReleaseCombustible(Cell);
+		}
+	}
+
+	// 10. Remove burnt out cells from fire and compact tiles that burnt out completely
+	for (const FIntVector2& SmolderingCell : AggregatedResult.SmolderingCells)
+	{
+		ReplicatedCells.SetCellPhase(SmolderingCell, EFireCellPhase::Smoldering);
+		SetFireParticlePhase(SmolderingCell, EFireCellPhase::Smoldering);
+	}
+	
+	if (AggregatedResult.BurntOutCells.Num() > 0)
+	{
+		ProcessBurntOutCells(AggregatedResult.BurntOutCells);
+		UpdateBurntOutFireLocations();
+	}
+
+	if (AggregatedResult.SmolderingCells.Num() > 0 || AggregatedResult.BurntOutCells.Num() > 0)
+		MARK_PROPERTY_DIRTY_FROM_NAME(AFireSource, ReplicatedCells, this);
+	
+	if (bUseParticleSlots)
+		UploadParticleSlots();
+
+	// only chunks that changed in this step are indexed again
+	if (!BurningCells.IsEmpty() || AggregatedResult.BurntOutCells.Num() > 0)
+		UpdateFireQueryIndex();
 
 #if WITH_EDITOR
 	if (bLog_Debug)
@@ -549,83 +1232,447 @@ void AFireSource::ProcessFireSpreadResult(FAsyncFireSpreadResult& AggregatedResu
 #endif
 }	
 
-bool AFireSource::IsCombustible(const FFireCell& TargetCell, const FFireCell& ByCell) const
+void AFireSource::SpreadFireDeterministic(int32 WorkersCount, TArray<FFireSpreadWorkerResult>& WorkerResults)
+{
+	// 1. collect cells that are burned by edge cells this step
+	{
+		FIRESIM_SCOPE(CollectCombustionTargets);
+		RunSimulationStage(CollectCombustionTargetsStageStats, EdgeCellsSnapshot.Num(), WorkersCount, [this, &WorkerResults](int32 WorkerIndex, int32 Start, int32 End)
+		{
+			SpreadCore.CollectCombustionTargets(EdgeCellsSnapshot, Start, End, WorkerResults[WorkerIndex]);
+		});
+	}
+
+	TArray<FIntVector2> CombustionTargets;
+	FireSimulation::ConcatenateParallel(WorkerResults, &FFireSpreadWorkerResult::CombustionTargets, CombustionTargets);
+	CombustionTargets.Sort(FireSimulation::FCellKeyLess());
+
+	// 2. gather combustion from the previous step state
+	RunSimulationStage(SpreadStageStats, CombustionTargets.Num(), WorkersCount, [this, &CombustionTargets](int32 WorkerIndex, int32 Start, int32 End)
+	{
+		SpreadCore.GatherCombustion(CombustionTargets, Start, End);
+	});
+
+	// 3. commit back buffer
+	FIRESIM_SCOPE(CommitCombustion);
+	RunSimulationStage(CommitCombustionStageStats, CombustionTargets.Num(), WorkersCount, [this, &CombustionTargets, &WorkerResults](int32 WorkerIndex, int32 Start, int32 End)
+	{
+		SpreadCore.CommitCombustion(CombustionTargets, Start, End, WorkerResults[WorkerIndex]);
+	});
+}
+
+void AFireSource::ProcessBurntOutCells(const TArray<FIntVector2>& BurntOutCells)
+{
+	TArray<FFireCellGrid::FTile*, TInlineAllocator<8>> SettledTiles;
+	for (const FIntVector2& BurntOutCellIndex : BurntOutCells)
+	{
+		const FFireCellGrid::FCellRef BurntOutCell = Cells.FindRef(BurntOutCellIndex);
+		RemoveFireLocation(BurntOutCell);
+		
+		// nothing to spread fire with anymore
+		if (EdgeCells.Remove(BurntOutCellIndex) > 0 || RemoveSleepingEdgeCell(BurntOutCell))
+			BurntOutCell.SetFlag(EFireCellFlags::EdgeCell, false);
+		
+		if (Cells.SetBurntOut(BurntOutCell))
+			SettledTiles.Emplace(BurntOutCell.Tile);
+	}
+
+	BurningCells.RemoveAllSwap([this](const FIntVector2& BurningCellIndex)
+	{
+		return Cells.FindRef(BurningCellIndex).GetPhase() == EFireCellPhase::BurntOut;
+	});
+
+	for (FFireCellGrid::FTile* SettledTile : SettledTiles)
+		Cells.CompactTile(SettledTile, [this](int32 CombustibleIndex) { Combustibles.RemoveAt(CombustibleIndex); });
+}
+
+void AFireSource::AddFireLocation(const FFireCellGrid::FCellRef& Cell, const FVector& Location)
 {
-	if (TargetCell.IsObstacle() || TargetCell.IsIgnited())
+	AddFireParticle(Cell.GetKey(), Location);
+	if (bCreateBurningAreaVolumes)
+		BurningArea.AddBurningCell(Cell.GetKey(), Location.Z - FireCellSize * 0.5, Location.Z + Cell.GetFireHeight());
+	
+	if (bCreatePerceptionStimuli)
+		PerceptionStimuli.AddBurningCell(Cell.GetLocation());
+	
+	ReplicatedCells.SetCell(Cell.GetKey(), Location.Z - GetGridOrigin().Z, EFireCellPhase::Burning);
+}
+
+void AFireSource::RemoveFireLocation(const FFireCellGrid::FCellRef& Cell)
+{
+	RemoveFireParticle(Cell.GetKey(), Cell.GetLocation());
+	if (bCreateBurningAreaVolumes)
+		BurningArea.RemoveBurningCell(Cell.GetKey());
+	
+	if (bCreatePerceptionStimuli)
+		PerceptionStimuli.RemoveBurningCell(Cell.GetLocation());
+	
+	ReplicatedCells.RemoveCell(Cell.GetKey());
+}
+
+void AFireSource::SleepEdgeCell(const FFireCellGrid::FCellRef& Cell)
+{
+	Cell.SetFlag(EFireCellFlags::SleepingEdgeCell, true);
+	FSleepingEdgeCellsRegion& Region = SleepingEdgeCells.FindOrAdd(Cell.Tile->Coord);
+	Region.Cells.Emplace(Cell.GetKey());
+	Region.SleepingCount++;
+	SleepingEdgeCellsCount++;
+}
+
+bool AFireSource::RemoveSleepingEdgeCell(const FFireCellGrid::FCellRef& Cell)
+{
+	if (!Cell.HasFlag(EFireCellFlags::SleepingEdgeCell))
 		return false;
+	
+	Cell.SetFlag(EFireCellFlags::SleepingEdgeCell, false);
+	SleepingEdgeCellsCount--;
+	FSleepingEdgeCellsRegion* Region = SleepingEdgeCells.Find(Cell.Tile->Coord);
+	if (ensure(Region) && --Region->SleepingCount == 0)
+		SleepingEdgeCells.Remove(Cell.Tile->Coord);
+	
+	return true;
+}
 
-	return TargetCell.Location.Z < ByCell.Location.Z + ByCell.FireHeight && TargetCell.Location.Z > ByCell.Location.Z - FireDownwardPropagationThreshold;
+void AFireSource::WakeSleepingNeighbors(const FFireCellGrid::FCellRef& Cell)
+{
+	for (const FIntVector2& Direction : SpreadCore.GetRadialDirections())
+	{
+		const FFireCellGrid::FCellRef NeighborCell = FFireCellGrid::GetNeighbor(Cell, Direction);
+		if (NeighborCell.IsValid() && RemoveSleepingEdgeCell(NeighborCell))
+			EdgeCells.Emplace(NeighborCell.GetKey());
+	}
 }
 
-void AFireSource::SpreadFireBatch(const TArray<FIntVector2>& EdgeCellsBatch, int Start, int End, FAsyncFireSpreadResult& BatchResult)
+void AFireSource::WakeSleepingEdgeCells(const FBox& Box)
 {
-	for (int i = Start; i < End; i++)
+	const FIntVector2 MinTile = FFireCellGrid::GetTileCoord(GetCellKey(Box.Min));
+	const FIntVector2 MaxTile = FFireCellGrid::GetTileCoord(GetCellKey(Box.Max));
+	for (auto It = SleepingEdgeCells.CreateIterator(); It; ++It)
 	{
-		const auto& EdgeCellIndex = EdgeCellsBatch[i];
-		const TArray<FIntVector2>* Directions = WindStrength < WindEffectActivationThreshold
-			? &RadialDirections
-			: &WindDirectionToNeighbors[WindDirectionQuantized];
+		const FIntVector2& TileCoord = It.Key();
+		if (TileCoord.X >= MinTile.X && TileCoord.X <= MaxTile.X && TileCoord.Y >= MinTile.Y && TileCoord.Y <= MaxTile.Y)
+		{
+			WakeSleepingEdgeCells(It.Value());
+			It.RemoveCurrent();
+		}
+	}
+}
 
-		for (const auto& Direction : *Directions)
+void AFireSource::WakeSleepingEdgeCells(const FSleepingEdgeCellsRegion& Region)
+{
+	for (const FIntVector2& CellKey : Region.Cells)
+	{
+		const FFireCellGrid::FCellRef Cell = Cells.FindRef(CellKey);
+		if (Cell.IsValid() && Cell.HasFlag(EFireCellFlags::SleepingEdgeCell))
 		{
-			FIntVector2 TestCellIndex = EdgeCellIndex + Direction;
-			if (!ensure(Cells.Contains(TestCellIndex)))
-				continue;
+			Cell.SetFlag(EFireCellFlags::SleepingEdgeCell, false);
+			EdgeCells.Emplace(CellKey);
+		}
+	}
+	
+	SleepingEdgeCellsCount -= Region.SleepingCount;
+}
+
+void AFireSource::WakeAllSleepingEdgeCells()
+{
+	if (SleepingEdgeCellsCount == 0)
+		return;
+	
+	for (const TPair<FIntVector2, FSleepingEdgeCellsRegion>& Region : SleepingEdgeCells)
+		WakeSleepingEdgeCells(Region.Value);
+	
+	SleepingEdgeCells.Reset();
+	ensure(SleepingEdgeCellsCount == 0);
+}
+
+void AFireSource::DecomposeBurningArea()
+{
+	FIRESIM_SCOPE(DecomposeBurningArea);
+	BurningAreaBoxes.SetNum(BurningAreaRegionsSnapshot.Num());
+	ParallelFor(BurningAreaRegionsSnapshot.Num(), [this](int32 RegionIndex)
+	{
+		BurningArea.Decompose(BurningAreaRegionsSnapshot[RegionIndex], BurningAreaBoxes[RegionIndex]);
+	});
+}
+
+void AFireSource::ApplyBurningAreaBoxes()
+{
+	FIRESIM_SCOPE(UpdateBurningAreaVolumes);
+	for (const FFireAreaCoverage::FRegionBoxes& RegionBoxes : BurningAreaBoxes)
+	{
+		TArray<UBoxComponent*>& RegionVolumes = BurningAreaRegionVolumes.FindOrAdd(RegionBoxes.Coord);
+		while (RegionVolumes.Num() > RegionBoxes.Boxes.Num())
+			ReleaseBurningAreaVolume(RegionVolumes.Pop(EAllowShrinking::No));
 
-			bool bCombustible = IsCombustible(Cells[TestCellIndex], Cells[EdgeCellIndex]);
-			if (!bCombustible)
+		for (int32 i = 0; i < RegionBoxes.Boxes.Num(); i++)
+		{
+			UBoxComponent* Volume = i < RegionVolumes.Num() ? RegionVolumes[i] : RegionVolumes.Add_GetRef(AcquireBurningAreaVolume());
+			const FVector Center = RegionBoxes.Boxes[i].GetCenter();
+			const FVector Extent = RegionBoxes.Boxes[i].GetExtent();
+			const bool bPlaced = Volume->CanEverAffectNavigation();
+			// unchanged boxes keep their nav tiles intact
+			if (bPlaced && Volume->GetComponentLocation().Equals(Center, 1.0) && Volume->GetUnscaledBoxExtent().Equals(Extent, 1.0))
 				continue;
 			
-			constexpr float MinWindEffect = 0.1f;
-			// it can be that cell dot product between burner->burnee and wind can be negative, so clamp by some small value to reduce the effect of burning against wind
-			const float WindEffect = WindStrength > WindEffectActivationThreshold
-				? FMath::Max(MinWindEffect, WindStrength * (Cells[TestCellIndex].Location - Cells[EdgeCellIndex].Location).GetSafeNormal() | WindDirection)
-				: MinWindEffect;
-			
-			// 1. spreading fire by edge cells
-			float DeltaTime = AccumulatedDeltaTime.load(); // i'm not sure if this is a good idea
-			float CombustIncrease = Combust(Cells[TestCellIndex], DeltaTime, WindEffect);
+			Volume->SetBoxExtent(Extent, false);
+			Volume->SetWorldLocation(Center);
+			Volume->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+			if (bPlaced)
+				FNavigationSystem::UpdateComponentData(*Volume);
+			else
+				Volume->SetCanEverAffectNavigation(true);
+		}
 
-			// 2.1 mark for add newly ignited cells to edge cells
-			if (Cells[TestCellIndex].IsIgnited())
-				BatchResult.IgnitedCells.Emplace(TestCellIndex);
+		if (RegionVolumes.IsEmpty())
+			BurningAreaRegionVolumes.Remove(RegionBoxes.Coord);
+	}
 
-			// 2.2 aggregate combustion increase for actors that have combustible interface.
-			// actor's individual combustion state != individual cell combustion state
-			if (Cells[TestCellIndex].bHasCombustibleInterface && !BatchResult.CombustionActorUpdates.Contains(TestCellIndex))
-			{
-				float& AggregatedIncrease = BatchResult.CombustionActorUpdates.FindOrAdd(TestCellIndex);
-				AggregatedIncrease += CombustIncrease;
-			}
+	BurningAreaRegionsSnapshot.Reset();
+	BurningAreaBoxes.Reset();
+}
+
+UBoxComponent* AFireSource::AcquireBurningAreaVolume()
+{
+	if (!FreeBurningAreaVolumes.IsEmpty())
+		return FreeBurningAreaVolumes.Pop(EAllowShrinking::No);
+
+	// world aligned boxes that modify nav mesh on their own, so a change of one box dirties only tiles under it
+	UBoxComponent* Volume = NewObject<UBoxComponent>(this, NAME_None, RF_Transient);
+	Volume->SetUsingAbsoluteLocation(true);
+	Volume->SetUsingAbsoluteRotation(true);
+	Volume->SetUsingAbsoluteScale(true);
+	Volume->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Volume->SetCollisionResponseToAllChannels(ECR_Ignore);
+	Volume->SetCollisionResponseToChannel(ECC_Pawn, ECR_Overlap);
+	Volume->SetGenerateOverlapEvents(false);
+	Volume->SetCanEverAffectNavigation(false);
+	Volume->bDynamicObstacle = true;
+	Volume->SetAreaClassOverride(BurningAreaNavClass);
+	Volume->SetupAttachment(GetRootComponent());
+	Volume->RegisterComponent();
+	DiscreteVolumes.Add(Volume);
+	return Volume;
+}
+
+void AFireSource::ReleaseBurningAreaVolume(UBoxComponent* Volume)
+{
+	// removes it from nav octree
+	Volume->SetCanEverAffectNavigation(false);
+	Volume->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	FreeBurningAreaVolumes.Add(Volume);
+}
+
+void AFireSource::OnWindChanged(const FVector& NewWindVector, float NewWindStrength)
+{
+	// field is evaluated on the next step, it's a waste to do it for every change in between
+	bWindChanged = true;
+}
+
+void AFireSource::OnReplicatedCellsReceived()
+{
+	if (bUseParticleSlots)
+		UploadParticleSlots();
+	else if (!NewFireLocations.IsEmpty())
+		UpdateFireLocations();
+
+	if (!BurntOutFireLocations.IsEmpty())
+		UpdateBurntOutFireLocations();
+
+	UpdateFireQueryIndex();
+}
+
+void AFireSource::UpdateFireQueryIndex()
+{
+	auto GlobalFireManager = GetWorld()->GetSubsystem<UGlobalFireManagerSubsystem>();
+	if (!GlobalFireManager)
+		return;
+	
+	FIRESIM_SCOPE(BuildFireQueryIndex);
+	// replicated cells are indexed, so that clients answer the same queries. Server also has the exact cells to take combustion from.
+	// Combustion of a cell doesn't change once it ignites, so chunks that weren't replicated again are still exact and keep their buckets
+	TSharedPtr<FFireQueryIndex, ESPMode::ThreadSafe> Index;
+	const double OriginZ = GetGridOrigin().Z;
+	for (const FFireCellChunkItem& Chunk : ReplicatedCells.Items)
+	{
+		const TPair<int32, int32> ChunkKey(Chunk.ReplicationID, Chunk.ReplicationKey);
+		const TPair<int32, int32>* IndexedKey = FireQueryChunkKeys.Find(Chunk.GetChunkCoord());
+		if (IndexedKey && *IndexedKey == ChunkKey)
+			continue;
+
+		if (!Index.IsValid())
+			Index = FireQueryIndex.IsValid() ? MakeShared<FFireQueryIndex, ESPMode::ThreadSafe>(*FireQueryIndex) : MakeShared<FFireQueryIndex, ESPMode::ThreadSafe>(FireCellSize);
+
+		FireQueryChunkKeys.Add(Chunk.GetChunkCoord(), ChunkKey);
+		Index->AddBucket(Chunk.GetChunkCoord(), Chunk.CellsMask);
+		int32 DataIndex = 0;
+		for (uint64 Mask = Chunk.CellsMask; Mask != 0; Mask &= Mask - 1, DataIndex++)
+		{
+			const FIntVector2 CellKey = Chunk.GetCellKey(Mask & (~Mask + 1));
+			const bool bSmoldering = Chunk.Phases[DataIndex] == static_cast<uint8>(EFireCellPhase::Smoldering);
+			const FFireCellGrid::FCellRef Cell = Cells.FindRef(CellKey);
+			if (Cell.IsValid())
+				Index->AddCell(CellKey, Cell.GetLocation().Z, Cell.CombustionState().load(std::memory_order_relaxed), Cell.GetFireHeight(), bSmoldering);
+			else
+				Index->AddCell(CellKey, OriginZ + Chunk.ZOffsets[DataIndex] * FFireCellChunkItem::ZQuantization, bSmoldering ? 0.5f : 1.f, BaseFireStrength, bSmoldering);
 		}
+	}
 
-		MarkEdgeCellForRemoval(EdgeCellIndex, BatchResult);
+	// chunks of cells that all burnt out are gone from the array
+	if (FireQueryChunkKeys.Num() > ReplicatedCells.Items.Num())
+	{
+		TSet<FIntVector2> ReplicatedChunks;
+		ReplicatedChunks.Reserve(ReplicatedCells.Items.Num());
+		for (const FFireCellChunkItem& Chunk : ReplicatedCells.Items)
+			ReplicatedChunks.Add(Chunk.GetChunkCoord());
+
+		for (auto It = FireQueryChunkKeys.CreateIterator(); It; ++It)
+		{
+			if (ReplicatedChunks.Contains(It.Key()))
+				continue;
+
+			if (!Index.IsValid())
+				Index = MakeShared<FFireQueryIndex, ESPMode::ThreadSafe>(*FireQueryIndex);
+
+			Index->RemoveBucket(It.Key());
+			It.RemoveCurrent();
+		}
+	}
+
+	if (!Index.IsValid())
+		return;
+
+	Index->UpdateBounds();
+	FireQueryIndex = Index;
+	GlobalFireManager->SetFireQueryIndex(this, FireQueryIndex);
+}
+
+void AFireSource::GatherViewLocations(bool bLocalPlayersOnly, TArray<FVector, TInlineAllocator<8>>& OutViewLocations) const
+{
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+		if (!PlayerController || (bLocalPlayersOnly && !PlayerController->IsLocalController()))
+			continue;
+		
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		OutViewLocations.Add(ViewLocation);
 	}
 }
 
-void AFireSource::OnWindChanged(const FVector& NewWindVector, float NewWindStrength)
+void AFireSource::AddFireParticle(const FIntVector2& CellKey, const FVector& Location)
+{
+	if (ParticleAggregationDistance > 0.f)
+	{
+		if (LocalViewLocationsFrame != GFrameCounter)
+		{
+			LocalViewLocations.Reset();
+			GatherViewLocations(true, LocalViewLocations);
+			LocalViewLocationsFrame = GFrameCounter;
+		}
+
+		// without local players there's nobody to pick the distance from, i.e. dedicated server
+		bool bDistant = !LocalViewLocations.IsEmpty();
+		for (const FVector& ViewLocation : LocalViewLocations)
+			bDistant &= FVector::DistSquared(ViewLocation, Location) > FMath::Square(ParticleAggregationDistance);
+
+		if (bDistant)
+		{
+			AggregatedParticleCells.Add(CellKey);
+			const int32 BlockSizeLog2 = static_cast<int32>(ParticleAggregationSize);
+			FFireParticleAggregate& Aggregate = ParticleAggregates.FindOrAdd(FIntVector2(CellKey.X >> BlockSizeLog2, CellKey.Y >> BlockSizeLog2));
+			if (Aggregate.CellsCount++ > 0)
+				return;
+			
+			Aggregate.ParticleKey = CellKey;
+			Aggregate.Location = Location;
+		}
+	}
+	
+	if (bUseParticleSlots)
+		ParticleSlots.Add(CellKey, Location, 1.f);
+	else
+		NewFireLocations.Emplace(Location);
+}
+
+void AFireSource::RemoveFireParticle(const FIntVector2& CellKey, const FVector& Location)
 {
-	WindDirection = NewWindVector;
-	WindStrength = NewWindStrength;
-	float acos = FMath::Acos(WindDirection | FVector::ForwardVector);
-	if ((WindDirection | FVector::RightVector) < 0.f)
-		acos = UE_TWO_PI - acos;
+	FIntVector2 ParticleKey = CellKey;
+	FVector ParticleLocation = Location;
+	if (AggregatedParticleCells.Remove(CellKey) > 0)
+	{
+		// aggregate particle stays until the last cell of its block burns out
+		const int32 BlockSizeLog2 = static_cast<int32>(ParticleAggregationSize);
+		const FIntVector2 BlockKey(CellKey.X >> BlockSizeLog2, CellKey.Y >> BlockSizeLog2);
+		FFireParticleAggregate* Aggregate = ParticleAggregates.Find(BlockKey);
+		if (!ensure(Aggregate) || --Aggregate->CellsCount > 0)
+			return;
+		
+		ParticleKey = Aggregate->ParticleKey;
+		ParticleLocation = Aggregate->Location;
+		ParticleAggregates.Remove(BlockKey);
+	}
 	
-	WindDirectionQuantized = FMath::RoundToInt32(acos / UE_TWO_PI * 8.f);
+	if (bUseParticleSlots)
+		ParticleSlots.Remove(ParticleKey);
+	else
+		BurntOutFireLocations.Emplace(ParticleLocation);
+}
+
+void AFireSource::SetFireParticlePhase(const FIntVector2& CellKey, EFireCellPhase Phase)
+{
+	// aggregate particle burns while any cell of its block does
+	if (bUseParticleSlots && !AggregatedParticleCells.Contains(CellKey))
+		ParticleSlots.SetIntensity(CellKey, Phase == EFireCellPhase::Smoldering ? 0.5f : 1.f);
 }
 
-void AFireSource::OnRep_FireLocations()
+void AFireSource::UploadParticleSlots()
 {
 #if WITH_EDITOR
 	if (bDebug_DontUpdateVFX)
 		return;
-#endif	
-	UNiagaraDataInterfaceArrayFunctionLibrary::SetNiagaraArrayVector(NiagaraComponent, NiagaraCellLocationsParameterName, FireLocations);
+#endif
+	if (!ParticleSlots.IsDirty())
+		return;
+	
+	FIRESIM_SCOPE(NiagaraUpload);
+	const TArray<FVector>& Positions = ParticleSlots.GetPositions();
+	const TArray<float>& Intensities = ParticleSlots.GetIntensities();
+	const TArray<int32>& DirtySlots = ParticleSlots.GetDirtySlots();
+	// every per slot setter looks the array up and marks it dirty on its own, past some share of changed slots one whole upload is cheaper
+	if (ParticleSlots.IsResized() || DirtySlots.Num() * 16 > Positions.Num())
+	{
+		UNiagaraDataInterfaceArrayFunctionLibrary::SetNiagaraArrayVector(NiagaraComponent, NiagaraParticlePositionsParameterName, Positions);
+		UNiagaraDataInterfaceArrayFunctionLibrary::SetNiagaraArrayFloat(NiagaraComponent, NiagaraParticleIntensitiesParameterName, Intensities);
+	}
+	else
+	{
+		for (const int32 Slot : DirtySlots)
+		{
+			UNiagaraDataInterfaceArrayFunctionLibrary::SetNiagaraArrayVectorValue(NiagaraComponent, NiagaraParticlePositionsParameterName, Slot, Positions[Slot], false);
+			UNiagaraDataInterfaceArrayFunctionLibrary::SetNiagaraArrayFloatValue(NiagaraComponent, NiagaraParticleIntensitiesParameterName, Slot, Intensities[Slot], false);
+		}
+	}
+	
+	ParticleSlots.ClearDirty();
 }
 
-void AFireSource::OnRep_NewFireLocations()
+void AFireSource::UpdateBurntOutFireLocations()
 {
-	UpdateFireLocations();
+#if WITH_EDITOR
+	if (bDebug_DontUpdateVFX)
+		return;
+#endif
+	if (bUseParticleSlots)
+	{
+		UploadParticleSlots();
+		return;
+	}
+	
+	FIRESIM_SCOPE(NiagaraUpload);
+	UNiagaraDataInterfaceArrayFunctionLibrary::SetNiagaraArrayVector(NiagaraComponent, NiagaraBurntOutLocationsParameterName, BurntOutFireLocations);
+	BurntOutFireLocations.Empty();
 }
 
 void AFireSource::UpdateFireLocations()
@@ -633,7 +1680,14 @@ void AFireSource::UpdateFireLocations()
 #if WITH_EDITOR
 	if (bDebug_DontUpdateVFX)
 		return;
-#endif	
+#endif
+	if (bUseParticleSlots)
+	{
+		UploadParticleSlots();
+		return;
+	}
+	
+	FIRESIM_SCOPE(NiagaraUpload);
 	UNiagaraDataInterfaceArrayFunctionLibrary::SetNiagaraArrayVector(NiagaraComponent, NiagaraCellLocationsParameterName, NewFireLocations);
 	NewFireLocations.Empty();
 }
@@ -646,69 +1700,75 @@ void AFireSource::DebugLog()
 		auto Index = FIntVector2(EdgeCell.X, EdgeCell.Y);
 		if (bLog_Debug_VisLog_ShowCellIndex)
 		{
-			UE_VLOG_LOCATION(this, LogFireSimulation_EdgeCells, VeryVerbose, Cells[Index].Location, 25, FColor::Blue, TEXT("Edge cell [%d, %d]"), EdgeCell.X, EdgeCell.Y);
+			UE_VLOG_LOCATION(this, LogFireSimulation_EdgeCells, VeryVerbose, Cells.FindRef(Index).GetLocation(), 25, FColor::Blue, TEXT("Edge cell [%d, %d]"), EdgeCell.X, EdgeCell.Y);
 		}
 		else
 		{
-			UE_VLOG_LOCATION(this, LogFireSimulation_EdgeCells, VeryVerbose, Cells[Index].Location, 25, FColor::Blue, TEXT(""));
+			UE_VLOG_LOCATION(this, LogFireSimulation_EdgeCells, VeryVerbose, Cells.FindRef(Index).GetLocation(), 25, FColor::Blue, TEXT(""));
 		}
 	}
 
-	for (const auto& Cell : Cells)
+	UE_VLOG(this, LogFireSimulation_Combustions, Log, TEXT("Cells count: %d, tiles count: %d, ash tiles count: %d, burning cells count: %d, memory: %.2f MB"),
+		Cells.Num(), Cells.NumTiles(), Cells.GetNumAshTiles(), BurningCells.Num(), Cells.GetAllocatedSize() / (1024.f * 1024.f));
+	
+	Cells.ForEachCell([this](const FFireCellGrid::FCellRef& Cell)
 	{
+		const FIntVector2 Key = Cell.GetKey();
 		if (bLog_Debug_VisLog_ShowCellIndex)
 		{
-			UE_VLOG_LOCATION(this, LogFireSimulation_Combustions, VeryVerbose, Cell.Value.Location, 25, FColor::Purple,
-							 TEXT("Cell [%d, %d] = %.2f"), Cell.Key.X, Cell.Key.Y, Cell.Value.CombustionState.load());
+			UE_VLOG_LOCATION(this, LogFireSimulation_Combustions, VeryVerbose, Cell.GetLocation(), 25, FColor::Purple,
+							 TEXT("Cell [%d, %d] = %.2f"), Key.X, Key.Y, Cell.CombustionState().load());
 		}
 		else
 		{
-			UE_VLOG_LOCATION(this, LogFireSimulation_Combustions, VeryVerbose, Cell.Value.Location, 25, FColor::Purple,
+			UE_VLOG_LOCATION(this, LogFireSimulation_Combustions, VeryVerbose, Cell.GetLocation(), 25, FColor::Purple,
 							 TEXT(""));
 		}
 			
-		if (Cell.Value.bHasCombustibleInterface)
+		if (Cell.HasCombustibleInterface())
 		{
 			if (bLog_Debug_VisLog_ShowCellIndex)
 			{
-				UE_VLOG_LOCATION(this, LogFireSimulation_Actors, VeryVerbose, Cell.Value.Location, 25, FColor::Cyan, TEXT("Actor cell [%d, %d]"), Cell.Key.X, Cell.Key.Y);
+				UE_VLOG_LOCATION(this, LogFireSimulation_Actors, VeryVerbose, Cell.GetLocation(), 25, FColor::Cyan, TEXT("Actor cell [%d, %d]"), Key.X, Key.Y);
 			}
 			else
 			{
-				UE_VLOG_LOCATION(this, LogFireSimulation_Actors, VeryVerbose, Cell.Value.Location, 25, FColor::Cyan, TEXT(""));
+				UE_VLOG_LOCATION(this, LogFireSimulation_Actors, VeryVerbose, Cell.GetLocation(), 25, FColor::Cyan, TEXT(""));
 			}
 		}
 
-		if (Cell.Value.bObstacle)
+		if (Cell.IsObstacle())
 		{
 			if (bLog_Debug_VisLog_ShowCellIndex)
 			{
-				UE_VLOG_LOCATION(this, LogFireSimulation_Obstacles, VeryVerbose, Cell.Value.Location, 25, FColor::Red, TEXT("Obstacle [%d, %d]"), Cell.Key.X, Cell.Key.Y);
+				UE_VLOG_LOCATION(this, LogFireSimulation_Obstacles, VeryVerbose, Cell.GetLocation(), 25, FColor::Red, TEXT("Obstacle [%d, %d]"), Key.X, Key.Y);
 			}
 			else
 			{
-				UE_VLOG_LOCATION(this, LogFireSimulation_Obstacles, VeryVerbose, Cell.Value.Location, 25, FColor::Red, TEXT(""));
+				UE_VLOG_LOCATION(this, LogFireSimulation_Obstacles, VeryVerbose, Cell.GetLocation(), 25, FColor::Red, TEXT(""));
 			}
 		}
-	}
+	});
 }
 
 void AFireSource::OnSomethingEnteredFireVolume(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
 	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
-	// TODO invalidate cells
+	if (AffectsTerrainBake(OtherActor, OtherComp))
+	{
+		InvalidateTerrainBake(OtherComp->Bounds.GetBox());
+		GetSimulationHost()->PendingEdgeCellsWakeBoxes.Add(OtherComp->Bounds.GetBox());
+	}
 }
 
 void AFireSource::OnSomethingLeftFireVolume(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
 	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
-	// TODO Some cells are now edge cells i.e. they can burn area where was something and now its gone
+	if (AffectsTerrainBake(OtherActor, OtherComp))
+	{
+		// the component is still in the physics scene here, so its columns are swept on the next update
+		PendingTerrainBakeRebakes.Add(OtherComp->Bounds.GetBox());
+		GetSimulationHost()->PendingEdgeCellsWakeBoxes.Add(OtherComp->Bounds.GetBox());
+	}
 }
 
-float AFireSource::Combust(FFireCell& Cell, float DeltaTime, float WindEffect)
-{
-	const float Increase = DeltaTime * WindEffect * Cell.CombustionRate; 
-	ensure(Increase >= 0.f);
-	Cell.CombustionState.fetch_add(Increase);
-	return Increase; 	
-}
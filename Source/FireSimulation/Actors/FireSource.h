@@ -4,19 +4,35 @@
 
 #include "CoreMinimal.h"
 #include "NiagaraComponent.h"
+#include "Async/ParallelFor.h"
+#include "Data/CombustibleUpdateScheduler.h"
+#include "Data/FireCellGrid.h"
+#include "Data/FireCellReplication.h"
+#include "Data/FireParticleSlots.h"
+#include "Data/FirePerceptionStimuli.h"
 #include "Data/FireSimulationDataTypes.h"
+#include "Data/FireTerrainBake.h"
 #include "GameFramework/Actor.h"
+#include "Simulation/FireAreaCoverage.h"
+#include "Simulation/FireSpreadCore.h"
+#include "Simulation/FireTerrainQuery.h"
+#include "Tasks/Task.h"
 #include "FireSource.generated.h"
 
 struct FFireCell;
+class FFireQueryIndex;
 class ICombustible;
 class UCombustionComponent;
 class UBoxComponent;
+class UFireTerrainBakeData;
+class UAISense;
+class UNavArea;
+class UWindComponent;
 
 typedef TKeyValuePair<FIntVector2, FFireCell> FFireCellKVP; 
 
 UCLASS()
-class FIRESIMULATION_API AFireSource : public AActor
+class FIRESIMULATION_API AFireSource : public AActor, public IFireTerrainQuery
 {
 	GENERATED_BODY()
 
@@ -32,10 +48,44 @@ public:
 	UFUNCTION(BlueprintCallable)
 	void SetFirePaused(bool bPaused);
 
+	virtual void PostInitProperties() override;
 	virtual void GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const override;
 
 	UBoxComponent* GetVolumeBox() const { return BoxComponent; }
 
+	// Cell keys are world-aligned: cell (X, Y) is centered at (X * FireCellSize, Y * FireCellSize), so every fire source with the same
+	// cell size puts the same ground into the same cell. Z of cells is replicated relative to the actor
+	FIntVector2 GetCellKey(const FVector& WorldLocation) const;
+	FVector GetGridOrigin() const { return FVector(0.0, 0.0, GetActorLocation().Z); }
+	
+	// fire source that simulates fire started by this one. Itself, unless it was merged into another one by UGlobalFireManagerSubsystem
+	AFireSource* GetSimulationHost() { return SimulationHost.IsValid() ? SimulationHost.Get() : this; }
+	bool CanShareSimulationWith(const AFireSource* Other) const;
+	// feeders don't simulate anything, their fires are started in this fire source's grid and their terrain bakes are used for its cells
+	void AddFeeder(AFireSource* Feeder);
+	void RemoveFeeder(AFireSource* Feeder);
+	TArray<AFireSource*> ReleaseFeeders();
+
+	// runs one whole simulation step on game thread and waits for it. For tools that drive the simulation themselves, i.e. benchmark
+	void StepSimulation(float StepDeltaTime);
+	const FFireSimulationStepReport& GetLastStepReport() const { return StepReport; }
+	const FFireCellReplicationArray& GetReplicatedCells() const { return ReplicatedCells; }
+	int32 GetCellsCount() const { return Cells.Num(); }
+	// phase and combustion of all cells, so that two runs can be checked for producing the same fire
+	uint32 GetSimulationStateHash() const;
+	SIZE_T GetSimulationAllocatedSize() const;
+
+public: // IFireTerrainQuery
+	virtual bool GetCell(const FIntVector2& CellKey, const FVector& LocationBase, FFireCell& OutCell) const override;
+
+public:
+
+#if WITH_EDITOR
+	// bakes fire volume heightfield into TerrainBakeData asset
+	UFUNCTION(CallInEditor, Category = "Fire Simulation")
+	void BakeTerrainToAsset();
+#endif
+
 protected:
 	virtual void BeginPlay() override;
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
@@ -48,6 +98,33 @@ protected:
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	FName NiagaraCellLocationsParameterName = FName("FireLocations");
+
+	// locations of cells that burnt out since last update
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FName NiagaraBurntOutLocationsParameterName = FName("BurntOutFireLocations");
+
+	// Burning cells keep stable particle slots instead of sending new and burnt out locations: positions and intensities arrays hold a slot per cell
+	// (intensity 1 - burning, 0.5 - smoldering, 0 - free slot) and only changed slots are uploaded.
+	// Niagara system has to keep a particle per slot with intensity above zero
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bUseParticleSlots = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(EditCondition = "bUseParticleSlots"))
+	FName NiagaraParticlePositionsParameterName = FName("FireParticlePositions");
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(EditCondition = "bUseParticleSlots"))
+	FName NiagaraParticleIntensitiesParameterName = FName("FireParticleIntensities");
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(EditCondition = "bUseParticleSlots", UIMin = 1024, ClampMin = 1024))
+	int32 MaxParticleSlots = 65536;
+
+	// cells farther than this from every local player share one particle per ParticleAggregationSize x ParticleAggregationSize block.
+	// Decided when a cell ignites. 0 - every cell has its own particle
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(UIMin = 0.f, ClampMin = 0.f))
+	float ParticleAggregationDistance = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	EFireParticleAggregation ParticleAggregationSize = EFireParticleAggregation::Block2x2;
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	bool bStartFireAutomatically = true;
@@ -64,16 +141,114 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(UIMin = 0.f, ClampMin = 0.f))
 	double BaseFireStrength = 50.0;
 
-	// Currently only used to reserve memory for fire cell containers
+	// Currently only used to reserve memory for edge cells container. Cells grid grows on demand
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(UIMin = 1, ClampMin = 1))
 	int FireSpreadLimit = 2000;
 
-	// don't update more than this amount of actor that are burning per tick
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(UIMin = 1, ClampMin = 1))
-	int MaxActorsUpdatesPerTick = 100;
+	// Fuel of a cell is 1 when it ignites and it's reduced by surface burnout rate every second. Below this value the cell smolders
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(UIMin = 0.f, ClampMin = 0.f, UIMax = 1.f, ClampMax = 1.f))
+	float SmolderingFuelThreshold = 0.3f;
 
+	// wind pushes fire up or down a slope less than along flat ground, by horizontal / full distance between cells. Cached when cells are created
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
-	bool bLog_Debug = true;
+	bool bWindSlopeCorrection = true;
+
+	// how strong smoldering cells spread fire compared to burning ones
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(UIMin = 0.f, ClampMin = 0.f, UIMax = 1.f, ClampMax = 1.f))
+	float SmolderingSpreadFactor = 0.25f;
+
+	// game thread time per tick that combustible actors updates can take. Actors close to and in view of players are updated first
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(UIMin = 10.f, ClampMin = 10.f))
+	float ActorUpdatesBudgetMicroseconds = 500.f;
+
+	// combustible actor this far from a player is updated half as urgently as the one next to them
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(UIMin = 100.f, ClampMin = 100.f))
+	float ActorUpdatesDistanceFalloff = 2500.f;
+
+	// how many task graph workers the simulation can occupy at once. 0 - all of them. Lower it if simulation competes with rendering and physics
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(UIMin = 0, ClampMin = 0))
+	int SimulationThreadsCount = 0;
+
+	// simulation stages split work into batches of about this duration, measured from previous steps
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(UIMin = 10.f, ClampMin = 10.f))
+	float TargetBatchMicroseconds = 200.f;
+
+	// Step simulation by a fixed time step instead of frame time. Combustion is double-buffered and results are ordered by cell key,
+	// so the same ignition points give the same fire front on any machine and any amount of workers.
+	// Combustible actors don't gate cell ignition in this mode since they are updated time-sliced on game thread
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bDeterministicSimulation = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(EditCondition = "bDeterministicSimulation", UIMin = 0.005f, ClampMin = 0.005f))
+	float FixedSimulationStep = 1.f / 30.f;
+
+	// when simulation falls behind, up to this amount of fixed steps is run in one tick to catch up. Lag beyond that is dropped
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(EditCondition = "bDeterministicSimulation", UIMin = 1, ClampMin = 1))
+	int MaxSimulationStepsPerTick = 4;
+
+	// Step 32x32 cell regions far from players less often. Skipped time is accumulated and the region is stepped by all of it at once,
+	// so fire spreads and burns out at the same rate, just in coarser steps. Region that gets closer to a player is stepped right away.
+	// Without players everything is stepped at full rate. Ignored in deterministic mode, since results would depend on where players were
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(EditCondition = "!bDeterministicSimulation"))
+	bool bUseSimulationLod = false;
+
+	// regions beyond each of these distances from every player are stepped half as often: every 2nd step beyond the first one,
+	// every 4th beyond the second and every 8th beyond the third. Ascending, up to 3 of them
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(EditCondition = "bUseSimulationLod"))
+	TArray<float> SimulationLodDistances = { 8000.f, 16000.f };
+
+	// Under wind fire spreads only downwind, so upwind and blocked edge cells would be re-evaluated every step without spreading anywhere.
+	// Such cells are put to sleep by 32x32 cell regions and woken when wind changes, a cell next to them ignites or something enters or leaves the volume
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bSleepStalledEdgeCells = true;
+
+	// Offline terrain bake of fire volume. If it's not set or was baked for a different placement/cell size, terrain is baked on BeginPlay 
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	UFireTerrainBakeData* TerrainBakeData;
+
+	// bake heightfield of fire volume in background on BeginPlay so that new cells don't sweep physics scene at runtime. Cells are swept until the bake is ready
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bBakeTerrainOnBeginPlay = true;
+
+	// volumes with more cell columns than this aren't baked and sweep physics scene at runtime. A column takes 8 bytes
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(ClampMin = 1))
+	int32 MaxTerrainBakeColumns = 4 * 1024 * 1024;
+
+	// let UGlobalFireManagerSubsystem merge this fire source into another one with the same cell parameters, so that all fires
+	// on the map burn in one grid and are simulated in one pass. Otherwise this fire source runs its own simulation
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bShareSimulation = true;
+
+	// cover burning cells with a few boxes of BurningAreaNavClass so that AI avoids fire. Navigation mesh must have dynamic generation
+	// (modifiers only is enough). Boxes are rebuilt only in 32x32 cell regions that changed, so only nav tiles under them are rebuilt
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bCreateBurningAreaVolumes = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(EditCondition = "bCreateBurningAreaVolumes"))
+	TSubclassOf<UNavArea> BurningAreaNavClass;
+
+	// spread perception stimuli over burning area so that NPCs can see fire and report it
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bCreatePerceptionStimuli = true;
+
+	// one stimulus per square of this size that has burning cells
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(EditCondition = "bCreatePerceptionStimuli", UIMin = 100.f, ClampMin = 100.f))
+	float PerceptionStimuliSpacing = 1000.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(EditCondition = "bCreatePerceptionStimuli"))
+	TArray<TSubclassOf<UAISense>> PerceptionStimuliSenses;
+
+	// stimuli registered and unregistered with perception system per tick
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(EditCondition = "bCreatePerceptionStimuli", UIMin = 1, ClampMin = 1))
+	int32 PerceptionStimuliRegistrationsPerTick = 16;
+
+	// fire sources are merged only when their volumes are closer than this
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(EditCondition="bShareSimulation", ClampMin=0.f))
+	float RelevantDistanceToOtherFireSources = 500.f;
+
+	// visual logger output of every step. Walks all cells on game thread, use stat FireSim or Insights FireSim channel to profile
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bLog_Debug = false;
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	bool bLog_Debug_VisLog_ShowCellIndex = false;
@@ -85,26 +260,63 @@ protected:
 private:
 	void OnWindChanged(const FVector& NewWindVector, float NewWindStrength);
 	
-	FVector WindDirection = FVector::ZeroVector;
-	int WindDirectionQuantized = 0;
-	float WindStrength = 0.f;
+	TWeakObjectPtr<UWindComponent> WindComponent;
+	// evaluated once the wind changes, or every step if there are gusts
+	FFireWindField Wind;
+	bool bWindChanged = true;
+	// wind is above WindEffectActivationThreshold everywhere, see FFireSpreadStepParams::bEdgeCellsCanSleep
+	bool bWindDirectional = false;
+	// sum of simulated step times. Gusts are driven by it, so deterministic runs get the same wind
+	double SimulationTime = 0.0;
 	
-	// TODO FFastArraySerializer
-	UPROPERTY(ReplicatedUsing=OnRep_FireLocations)
-	TArray<FVector> FireLocations;
+	friend struct FFireCellChunkItem;
+	friend struct FFireCellReplicationArray;
+	friend class UFireSimulationBenchmarkSubsystem;
+	friend class UGlobalFireManagerSubsystem;
+	
+	// burning cells, delta replicated in chunks. Clients turn the deltas into new and burnt out fire locations
+	UPROPERTY(Replicated)
+	FFireCellReplicationArray ReplicatedCells;
 
 	// idk i'm too bad with niagara to make a good emitter so if I provide all fire locations and not just new ones - my current "as good as I could" emitter will just spawn all particles and not just new ones
 	// but if i send only new particles - old ones still live. so eh fuck it who am i a technical artist?
-	UPROPERTY(ReplicatedUsing=OnRep_NewFireLocations)
+	// locations pending for VFX. Filled by simulation on server and by ReplicatedCells on clients
 	TArray<FVector> NewFireLocations;
+	TArray<FVector> BurntOutFireLocations;
+	// VFX state with bUseParticleSlots, instead of the locations above
+	FFireParticleSlots ParticleSlots;
 	
-	UFUNCTION()
-	void OnRep_FireLocations();
-
-	UFUNCTION()
-	void OnRep_NewFireLocations();
+	// particle of ParticleAggregationSize block of distant cells. It's keyed by the first cell that ignited in the block,
+	// cells don't ignite twice, so the key never clashes with a particle of a cell of its own
+	struct FFireParticleAggregate
+	{
+		FIntVector2 ParticleKey;
+		FVector Location;
+		int32 CellsCount = 0;
+	};
+	
+	TMap<FIntVector2, FFireParticleAggregate> ParticleAggregates;
+	// cells that are represented by an aggregate particle instead of their own one
+	TSet<FIntVector2> AggregatedParticleCells;
+	TArray<FVector, TInlineAllocator<8>> LocalViewLocations;
+	uint64 LocalViewLocationsFrame = MAX_uint64;
 	
+	void AddFireParticle(const FIntVector2& CellKey, const FVector& Location);
+	void RemoveFireParticle(const FIntVector2& CellKey, const FVector& Location);
+	void SetFireParticlePhase(const FIntVector2& CellKey, EFireCellPhase Phase);
+	void UploadParticleSlots();
+	
+	void OnReplicatedCellsReceived();
 	void UpdateFireLocations();
+	void UpdateBurntOutFireLocations();
+	// publishes burning cells to fire queries of UGlobalFireManagerSubsystem. Only chunks whose replication key changed are indexed again
+	void UpdateFireQueryIndex();
+	TSharedPtr<const FFireQueryIndex, ESPMode::ThreadSafe> FireQueryIndex;
+	// chunk coord -> ReplicationID and ReplicationKey of the chunk when it was indexed. A chunk that burnt out and ignited again is a new item with a new ID
+	TMap<FIntVector2, TPair<int32, int32>> FireQueryChunkKeys;
+	void GatherViewLocations(bool bLocalPlayersOnly, TArray<FVector, TInlineAllocator<8>>& OutViewLocations) const;
+	void AddFireLocation(const FFireCellGrid::FCellRef& Cell, const FVector& Location);
+	void RemoveFireLocation(const FFireCellGrid::FCellRef& Cell);
 
 	UFUNCTION()
 	void OnSomethingEnteredFireVolume(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep,
@@ -112,44 +324,143 @@ private:
 	UFUNCTION()
 	void OnSomethingLeftFireVolume(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 
-	bool GetCell(const FVector& LocationBase, FFireCell& OutCell) const;
+	bool TryGetBakedCell(const FIntVector2& CellKey, const FVector& LocationBase, FFireCell& OutCell) const;
+	void ApplySurfaceParameters(const FPhysicMaterialCombustionParameters& Parameters, FFireCell& OutCell) const;
+	// fills bake parameters and allocates its columns. False if the volume has more than MaxTerrainBakeColumns columns
+	bool PrepareTerrainBake(FFireTerrainBake& OutBake, FBox& OutBounds) const;
+	// sweeps Columns of prepared bake from Bounds top to Bounds bottom. Doesn't touch the actor, so it runs on workers
+	static void SweepTerrainBake(const UWorld* World, FFireTerrainBake& Bake, const FBox& Bounds, const FIntRect& Columns, EParallelForFlags Flags);
+	bool BakeTerrain(FFireTerrainBake& OutBake) const;
+	void BakeTerrainAsync();
 	void PrepareImmediateInitialCells(const FIntVector2& InitialCellKey, const FVector& BaseLocation);
 	
-	void SpreadFireAsync();
-	void MarkEdgeCellForRemoval(const FIntVector2& EdgeCellKey, FAsyncFireSpreadResult& Result);
+	void TickFixedSteps();
+	// picks LOD of every tile and the time it's stepped by this step
+	void UpdateSimulationLod(float StepDeltaTime);
+	bool IsSimulationLodEnabled() const { return bUseSimulationLod && !bDeterministicSimulation; }
+	void SpreadFireAsync(float StepDeltaTime);
+	void CompleteSpreadFireAsync();
+	void SpreadFireDeterministic(int32 WorkersCount, TArray<FFireSpreadWorkerResult>& WorkerResults);
+	int32 GetSimulationWorkersCount() const;
+	
+	template<typename TBody>
+	void RunSimulationStage(FFireSimulationStageStats& StageStats, int32 ItemsCount, int32 WorkersCount, TBody&& Body) const;
+	
+	void ProcessBurntOutCells(const TArray<FIntVector2>& BurntOutCells);
+	bool IsFireActive() const { return !EdgeCells.IsEmpty() || !BurningCells.IsEmpty(); }
 	void DebugLog();
 	void ProcessFireSpreadResult(FAsyncFireSpreadResult& AggregatedResult);
-	bool IsCombustible(const FFireCell& TargetCell, const FFireCell& ByCell) const;
-	void SpreadFireBatch(const TArray<FIntVector2>& EdgeCells, int Start, int End, FAsyncFireSpreadResult& BatchResult);
-	void CreateNewFireCells(FAsyncFireSpreadResult& AggregatedResult);
-
-	float Combust(FFireCell& Cell, float DeltaTime, float WindEffect);
 	bool StartFireAtCell(const FIntVector2& InitialCellKey, const FVector& OriginLocation);
 
-	float WindEffectActivationThreshold = 2.f;
 	float HighestAltitude = FLT_MAX;
 	float LowestAltitude = -FLT_MAX;
-	int LastBurningActorUpdateIndex = 0;
 	
-	std::atomic<float> AccumulatedDeltaTime = 0.f;
+	// game thread only. Time that passed since last launched step
+	float AccumulatedDeltaTime = 0.f;
+	// staggers steps of regions with the same LOD
+	uint32 SimulationStepIndex = 0;
 	
 	std::atomic<bool> bAsyncUpdateRunning = false;
+
+	// spread pipeline state. Only touched by pipeline tasks while bAsyncUpdateRunning, and by game thread otherwise
+	UE::Tasks::FTask SpreadPipelineTask;
+	TArray<FIntVector2> EdgeCellsSnapshot;
+	TArray<FIntVector2> IgnitedCellsSnapshot;
+	FAsyncFireSpreadResult SpreadResult;
+	FFireSimulationStepReport StepReport;
+	FFireSimulationStageStats SpreadStageStats;
+	FFireSimulationStageStats PruneEdgeCellsStageStats;
+	FFireSimulationStageStats CollectCombustionTargetsStageStats;
+	FFireSimulationStageStats CommitCombustionStageStats;
+	FFireSimulationStageStats BurnoutStageStats;
+	FFireSimulationStageStats CreateNewCellsStageStats = FFireSimulationStageStats(25.0); // sweeps are way more expensive than spreading
 	
 	std::atomic<bool> bLogDebugAtomic;
 	
-	TMap<FIntVector2, FFireCell> Cells;
+	FFireCellGrid Cells;
+	// spread kernels. Cells are read from Cells grid, new ones come from GetCell
+	FFireSpreadCore SpreadCore;
+	// actors and prop instances that cells burn, cells hold indices of them. Game thread only
+	TSparseArray<FFireCellCombustible> Combustibles;
+	// combustibles that GetCell found for cells that aren't added to the grid yet, FFireCell::CombustibleIndex of such cells points here.
+	// Appended by workers, moved to Combustibles when cells are added
+	mutable FCriticalSection NewCombustiblesLock;
+	mutable TArray<FFireCellCombustible> NewCombustibles;
+	
+	int32 AddNewCombustible(const FFireCellCombustible& Combustible) const;
+	// adds cell that came from GetCell to the grid and registers its combustible
+	FFireCellGrid::FCellRef AddCell(const FIntVector2& CellKey, FFireCell Cell);
+	FFireCellCombustible* FindCombustible(const FFireCellGrid::FCellRef& Cell);
+	void ReleaseCombustible(const FFireCellGrid::FCellRef& Cell);
 	TSet<FIntVector2> EdgeCells;
 	
-	TMap<int, TArray<FIntVector2>> WindDirectionToNeighbors;
-	TArray<FIntVector2> RadialDirections;
+	// sleeping edge cells by region (tile coord). Cells that were woken one by one or burnt out are left in the array
+	// and skipped by their flag, region is dropped once none of its cells sleep
+	struct FSleepingEdgeCellsRegion
+	{
+		TArray<FIntVector2> Cells;
+		int32 SleepingCount = 0;
+	};
+	
+	TMap<FIntVector2, FSleepingEdgeCellsRegion> SleepingEdgeCells;
+	int32 SleepingEdgeCellsCount = 0;
+	// bounds of components that entered or left the volume, sleeping cells under them are woken before the next step
+	TArray<FBox> PendingEdgeCellsWakeBoxes;
+	
+	void SleepEdgeCell(const FFireCellGrid::FCellRef& Cell);
+	// returns false if the cell wasn't sleeping
+	bool RemoveSleepingEdgeCell(const FFireCellGrid::FCellRef& Cell);
+	void WakeSleepingNeighbors(const FFireCellGrid::FCellRef& Cell);
+	void WakeSleepingEdgeCells(const FBox& Box);
+	void WakeSleepingEdgeCells(const FSleepingEdgeCellsRegion& Region);
+	void WakeAllSleepingEdgeCells();
+	// ignited cells that haven't burnt out yet. Modified only on game thread outside of async spread, so pipeline reads it directly
+	TArray<FIntVector2> BurningCells;
+	FFireTerrainBake TerrainBake;
+	// bake made by TerrainBakeTask. It replaces TerrainBake once the task is done and workers of the simulation host don't read bakes
+	TSharedPtr<FFireTerrainBake, ESPMode::ThreadSafe> PendingTerrainBake;
+	UE::Tasks::FTask TerrainBakeTask;
+	// columns of TerrainBake that something entered while workers of the simulation host could be reading it or while it was being baked.
+	// Applied once the step completes
+	TArray<FBox> PendingTerrainBakeInvalidations;
+	// columns that something left, swept again on the next update once it's gone from there
+	TArray<FBox> PendingTerrainBakeRebakes;
+	
+	// only components that block fire sweeps change the terrain, pawns are never baked
+	bool AffectsTerrainBake(const AActor* OtherActor, const UPrimitiveComponent* OtherComp) const;
+	void InvalidateTerrainBake(const FBox& WorldBox);
+	// takes finished background bake, applies pending invalidations and rebakes. Only when workers of the simulation host aren't running
+	void UpdateTerrainBake();
+	bool HasPendingTerrainBakeUpdate() const { return PendingTerrainBake.IsValid() || !PendingTerrainBakeRebakes.IsEmpty(); }
+	// bakes of feeders, they cover the rest of the shared grid. Changed only when no step is running, see AddFeeder and RemoveFeeder
+	TArray<const FFireTerrainBake*> FeederTerrainBakes;
+	TArray<TWeakObjectPtr<AFireSource>> Feeders;
+	TWeakObjectPtr<AFireSource> SimulationHost;
 	TMap<TEnumAsByte<EPhysicalSurface>, FPhysicMaterialCombustionParameters> SurfacesCombustionParameters;
 	TArray<TEnumAsByte<EPhysicalSurface>> IncombustibleSurfaces;
 	
+	// boxes that cover burning area, used and pooled
 	UPROPERTY()
 	TArray<UBoxComponent*> DiscreteVolumes;
+	
+	FFirePerceptionStimuli PerceptionStimuli;
+	FFireAreaCoverage BurningArea;
+	TMap<FIntVector2, TArray<UBoxComponent*>> BurningAreaRegionVolumes;
+	TArray<UBoxComponent*> FreeBurningAreaVolumes;
+	// pipeline stage input and output. Regions are copied, so game thread keeps changing BurningArea while the stage runs
+	TArray<FFireAreaCoverage::FRegion> BurningAreaRegionsSnapshot;
+	TArray<FFireAreaCoverage::FRegionBoxes> BurningAreaBoxes;
+	
+	void DecomposeBurningArea();
+	void ApplyBurningAreaBoxes();
+	UBoxComponent* AcquireBurningAreaVolume();
+	void ReleaseBurningAreaVolume(UBoxComponent* Volume);
 
+	// fires started while async spread is running. Cells grid can't be modified during async spread, so they are started on next tick
+	TArray<FVector> PendingFireOrigins;
+	
 	// I assume since there can be thousands or actors to update their visuals, doing it in 1 tick isn't the best idea. so I time-slice it
-	TArray<TPair<FIntVector2, float>> PendingBurningActorsUpdates;
+	FCombustibleUpdateScheduler CombustibleUpdates;
 	
 	void UpdateBurningActors();
 };
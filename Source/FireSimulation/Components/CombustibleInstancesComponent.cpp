@@ -0,0 +1,88 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombustibleInstancesComponent.h"
+
+#include "Subsystems/CombustibleReplicationSubsystem.h"
+
+UCombustibleInstancesComponent::UCombustibleInstancesComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	NumCustomDataFloats = 1;
+}
+
+int32 UCombustibleInstancesComponent::AddCombustibleInstance(const FTransform& WorldTransform, float MaxCombustionLevel, float CombustionRate, uint32 ReplicationId)
+{
+	const int32 InstanceIndex = AddInstance(WorldTransform, true);
+	if (!ensure(InstanceIndex == CombustibleInstances.Num()))
+		return INDEX_NONE;
+	
+	FWriteScopeLock WriteLock(InstancesLock);
+	FCombustibleInstance& CombustibleInstance = CombustibleInstances.AddDefaulted_GetRef();
+	CombustibleInstance.MaxCombustionLevel = FMath::Max(MaxCombustionLevel, KINDA_SMALL_NUMBER);
+	CombustibleInstance.CombustionRate = CombustionRate;
+	CombustibleInstance.ReplicationId = ReplicationId;
+	CombustibleInstance.Location = WorldTransform.GetLocation();
+	return InstanceIndex;
+}
+
+bool UCombustibleInstancesComponent::AddCombustion(int32 InstanceIndex, float Combustion)
+{
+	if (!ensure(CombustibleInstances.IsValidIndex(InstanceIndex)))
+		return false;
+
+	const FCombustibleInstance& CombustibleInstance = CombustibleInstances[InstanceIndex];
+	SetCombustionState(InstanceIndex, CombustibleInstance.CombustionState + Combustion);
+	if (CombustibleInstance.ReplicationId != 0)
+	{
+		if (auto ReplicationSubsystem = GetWorld()->GetSubsystem<UCombustibleReplicationSubsystem>())
+		{
+			ReplicationSubsystem->SetCombustion(CombustibleInstance.ReplicationId, CombustibleInstance.Location,
+				CombustibleInstance.CombustionState / CombustibleInstance.MaxCombustionLevel);
+		}
+	}
+	
+	return CombustibleInstance.CombustionState >= CombustibleInstance.MaxCombustionLevel;
+}
+
+void UCombustibleInstancesComponent::SetCombustionState(int32 InstanceIndex, float NewCombustionState)
+{
+	if (!ensure(CombustibleInstances.IsValidIndex(InstanceIndex)))
+		return;
+	
+	FCombustibleInstance& CombustibleInstance = CombustibleInstances[InstanceIndex];
+	NewCombustionState = FMath::Clamp(NewCombustionState, 0.f, CombustibleInstance.MaxCombustionLevel);
+	if (NewCombustionState == CombustibleInstance.CombustionState)
+		return;
+
+	CombustibleInstance.CombustionState = NewCombustionState;
+	// render state is marked dirty once for all instances in FlushCombustionData
+	SetCustomDataValue(InstanceIndex, 0, NewCombustionState / CombustibleInstance.MaxCombustionLevel, false);
+	bCombustionDataDirty = true;
+}
+
+float UCombustibleInstancesComponent::GetCombustionState(int32 InstanceIndex) const
+{
+	return CombustibleInstances.IsValidIndex(InstanceIndex) ? CombustibleInstances[InstanceIndex].CombustionState : 0.f;
+}
+
+bool UCombustibleInstancesComponent::IsInstanceIgnited(int32 InstanceIndex) const
+{
+	return CombustibleInstances.IsValidIndex(InstanceIndex)
+		&& CombustibleInstances[InstanceIndex].CombustionState >= CombustibleInstances[InstanceIndex].MaxCombustionLevel;
+}
+
+float UCombustibleInstancesComponent::GetInstanceCombustionRate(int32 InstanceIndex) const
+{
+	FReadScopeLock ReadLock(InstancesLock);
+	return CombustibleInstances.IsValidIndex(InstanceIndex) ? CombustibleInstances[InstanceIndex].CombustionRate : 1.f;
+}
+
+bool UCombustibleInstancesComponent::FlushCombustionData()
+{
+	if (!bCombustionDataDirty)
+		return false;
+
+	MarkRenderStateDirty();
+	bCombustionDataDirty = false;
+	return true;
+}
@@ -0,0 +1,51 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "CombustibleInstancesComponent.generated.h"
+
+/**
+ * Combustible props rendered as instances of one mesh. Combustion of every instance is written to per-instance custom data 0
+ * normalized to [0, 1] of its max combustion level, so the material is expected to map it to color (i.e. with a curve atlas).
+ * Custom data changes are collected and sent to the renderer once per frame by UCombustibleInstancesSubsystem
+ */
+UCLASS(ClassGroup=(FireSimulation))
+class FIRESIMULATION_API UCombustibleInstancesComponent : public UInstancedStaticMeshComponent
+{
+	GENERATED_BODY()
+
+public:
+	UCombustibleInstancesComponent();
+
+	int32 AddCombustibleInstance(const FTransform& WorldTransform, float MaxCombustionLevel, float CombustionRate, uint32 ReplicationId = 0);
+	
+	// Server. Returns true if the instance is ignited after combustion is added
+	bool AddCombustion(int32 InstanceIndex, float Combustion);
+	void SetCombustionState(int32 InstanceIndex, float NewCombustionState);
+	float GetCombustionState(int32 InstanceIndex) const;
+	bool IsInstanceIgnited(int32 InstanceIndex) const;
+	// safe to call from simulation workers
+	float GetInstanceCombustionRate(int32 InstanceIndex) const;
+	int32 GetCombustibleInstanceCount() const { return CombustibleInstances.Num(); }
+
+	// Sends custom data of all instances changed since last flush to the renderer. Returns false if there was nothing to send
+	bool FlushCombustionData();
+
+private:
+	struct FCombustibleInstance
+	{
+		float CombustionState = 0.f;
+		float MaxCombustionLevel = 1.f;
+		float CombustionRate = 0.25f;
+		uint32 ReplicationId = 0;
+		FVector Location = FVector::ZeroVector;
+	};
+
+	// same indices as instances of the component. Instances are never removed so that cells can keep referencing them
+	TArray<FCombustibleInstance> CombustibleInstances;
+	// props can register while simulation workers sweep for new cells and read combustion rates
+	mutable FRWLock InstancesLock;
+	bool bCombustionDataDirty = false;
+};
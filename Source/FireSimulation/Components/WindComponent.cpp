@@ -19,6 +19,7 @@ void UWindComponent::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>&
 	FDoRepLifetimeParams DoRepLifetimeParams {COND_None, REPNOTIFY_OnChanged, true };
 	DOREPLIFETIME_WITH_PARAMS_FAST(UWindComponent, WindDirection, DoRepLifetimeParams)
 	DOREPLIFETIME_WITH_PARAMS_FAST(UWindComponent, WindStrength, DoRepLifetimeParams)
+	DOREPLIFETIME_WITH_PARAMS_FAST(UWindComponent, WindField, DoRepLifetimeParams)
 }
 
 void UWindComponent::SetWindDirection(const FRotator& NewDirection)
@@ -49,6 +50,17 @@ void UWindComponent::SetWindStrength(const float NewStrength)
 	MARK_PROPERTY_DIRTY_FROM_NAME(UWindComponent, WindStrength, this);
 }
 
+void UWindComponent::SetWindField(const FWindFieldDescription& NewWindField)
+{
+	if (!GetOwner()->HasAuthority())
+		return;
+
+	WindField = NewWindField;
+	WindChangedEvent.Broadcast(WindDirection.Vector(), WindStrength);
+	
+	MARK_PROPERTY_DIRTY_FROM_NAME(UWindComponent, WindField, this);
+}
+
 void UWindComponent::OnRep_WindDirection()
 {
 	WindChangedEvent.Broadcast(WindDirection.Vector(), WindStrength);
@@ -58,3 +70,8 @@ void UWindComponent::OnRep_WindStrength()
 {
 	WindChangedEvent.Broadcast(WindDirection.Vector(), WindStrength);
 }
+
+void UWindComponent::OnRep_WindField()
+{
+	WindChangedEvent.Broadcast(WindDirection.Vector(), WindStrength);
+}
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "Data/WindFieldDescription.h"
 #include "WindComponent.generated.h"
 
 
@@ -30,6 +31,16 @@ public:
 
 	UFUNCTION(BlueprintCallable)
 	void SetWindStrength(const float NewStrength);
+
+	UFUNCTION(BlueprintCallable)
+	const FWindFieldDescription& GetWindField() const { return WindField; }
+	
+	UFUNCTION(BlueprintCallable)
+	void SetWindField(const FWindFieldDescription& NewWindField);
+
+	// wind everywhere at the given time: prevailing wind, changed locally by the field and gusts
+	void EvaluateWindField(double Time, FFireWindField& OutField) const { WindField.Evaluate(GetWindDirection(), WindStrength, Time, OutField); }
+	bool HasGusts() const { return WindField.HasGusts(); }
 	
 	mutable FWindChangedEvent WindChangedEvent;
 
@@ -41,10 +52,17 @@ protected:
 	UPROPERTY(ReplicatedUsing=OnRep_WindStrength, EditAnywhere, BlueprintReadOnly, meta=(UIMin = 0.0, ClampMin = 0.0))
 	float WindStrength = 1.f;
 
+	// local variation of the wind above, i.e. for valleys and buildings. No nodes - same wind everywhere
+	UPROPERTY(ReplicatedUsing=OnRep_WindField, EditAnywhere, BlueprintReadOnly)
+	FWindFieldDescription WindField;
+
 private:
 	UFUNCTION()
 	void OnRep_WindDirection();
 
 	UFUNCTION()
 	void OnRep_WindStrength();
+
+	UFUNCTION()
+	void OnRep_WindField();
 };
\ No newline at end of file
@@ -0,0 +1,52 @@
+﻿#include "CombustibleStateReplication.h"
+
+#include "Actors/CombustibleStateReplicator.h"
+#include "Data/FireSimulationStats.h"
+#include "Subsystems/CombustibleReplicationSubsystem.h"
+
+void FCombustibleStateItem::PostReplicatedAdd(const FCombustibleStateArray& InArraySerializer)
+{
+	PostReplicatedChange(InArraySerializer);
+}
+
+void FCombustibleStateItem::PostReplicatedChange(const FCombustibleStateArray& InArraySerializer)
+{
+	if (!ensure(InArraySerializer.Owner))
+		return;
+
+	if (auto ReplicationSubsystem = InArraySerializer.Owner->GetWorld()->GetSubsystem<UCombustibleReplicationSubsystem>())
+		ReplicationSubsystem->ApplyCombustionLevel(Id, Level);
+}
+
+bool FCombustibleStateArray::SetLevel(uint32 Id, uint8 Level)
+{
+	if (const int32* ItemIndex = ItemLookup.Find(Id))
+	{
+		FCombustibleStateItem& Item = Items[*ItemIndex];
+		if (Item.Level == Level)
+			return false;
+		
+		Item.Level = Level;
+		MarkItemDirty(Item);
+		return true;
+	}
+
+	ItemLookup.Add(Id, Items.Num());
+	FCombustibleStateItem& Item = Items.AddDefaulted_GetRef();
+	Item.Id = Id;
+	Item.Level = Level;
+	MarkItemDirty(Item);
+	return true;
+}
+
+bool FCombustibleStateArray::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	const int64 StartBits = DeltaParms.Writer ? DeltaParms.Writer->GetNumBits() : 0;
+	const bool bSuccess = FFastArraySerializer::FastArrayDeltaSerialize<FCombustibleStateItem, FCombustibleStateArray>(Items, DeltaParms, *this);
+	if (DeltaParms.Writer)
+	{
+		INC_DWORD_STAT_BY(STAT_FireSim_ReplicatedBytes, (DeltaParms.Writer->GetNumBits() - StartBits + 7) / 8);
+	}
+	
+	return bSuccess;
+}
@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "CombustibleStateReplication.generated.h"
+
+class ACombustibleStateReplicator;
+struct FCombustibleStateArray;
+
+// Combustion of one prop quantized to a byte of its max combustion level. Props that haven't started burning have no item
+USTRUCT()
+struct FCombustibleStateItem : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	// UCombustibleReplicationSubsystem::MakeStableId, same on server and clients
+	UPROPERTY()
+	uint32 Id = 0;
+
+	UPROPERTY()
+	uint8 Level = 0;
+
+	FORCEINLINE static uint8 Quantize(float NormalizedCombustion) { return static_cast<uint8>(FMath::RoundToInt32(FMath::Clamp(NormalizedCombustion, 0.f, 1.f) * MAX_uint8)); }
+	FORCEINLINE static float Dequantize(uint8 Level) { return Level / static_cast<float>(MAX_uint8); }
+
+	void PostReplicatedAdd(const FCombustibleStateArray& InArraySerializer);
+	void PostReplicatedChange(const FCombustibleStateArray& InArraySerializer);
+};
+
+// Delta replicated combustion of all props in a region of the world
+USTRUCT()
+struct FCombustibleStateArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FCombustibleStateItem> Items;
+
+	ACombustibleStateReplicator* Owner = nullptr;
+
+	// server. Returns false if quantized level didn't change and there's nothing to send
+	bool SetLevel(uint32 Id, uint8 Level);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+
+private:
+	// server only, id -> index in Items
+	TMap<uint32, int32> ItemLookup;
+};
+
+template<>
+struct TStructOpsTypeTraits<FCombustibleStateArray> : public TStructOpsTypeTraitsBase2<FCombustibleStateArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
@@ -0,0 +1,149 @@
+﻿#include "CombustibleUpdateScheduler.h"
+
+#include "Camera/PlayerCameraManager.h"
+#include "Data/FireSimulationDataTypes.h"
+#include "Data/FireSimulationStats.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Interfaces/Combustible.h"
+
+void FCombustibleUpdateScheduler::Enqueue(const FFireCellCombustible& Combustible, const FIntVector2& CellKey, float Combustion)
+{
+	const FObjectKey ActorKey(Combustible.Actor.Get());
+	if (const int32* PendingIndex = PendingIndices.Find(ActorKey))
+	{
+		FPendingUpdate& PendingUpdate = Pending[*PendingIndex];
+		PendingUpdate.Combustion += Combustion;
+		PendingUpdate.Cells.AddUnique(CellKey);
+		return;
+	}
+
+	PendingIndices.Add(ActorKey, Pending.Num());
+	FPendingUpdate& PendingUpdate = Pending.AddDefaulted_GetRef();
+	PendingUpdate.Actor = Combustible.Actor;
+	PendingUpdate.ActorKey = ActorKey;
+	PendingUpdate.Interface = Combustible.Interface;
+	PendingUpdate.Cells.Add(CellKey);
+	PendingUpdate.Combustion = Combustion;
+	PendingUpdate.QueuedTime = FPlatformTime::Seconds();
+	bPriorityDirty = true;
+}
+
+void FCombustibleUpdateScheduler::Update(const UWorld* World, TFunctionRef<void(const FIntVector2&)> OnCellIgnited, TFunctionRef<void(const FIntVector2&)> OnCellLost)
+{
+	Metrics.AppliedLastUpdate = 0;
+	Metrics.MaxLatencyLastUpdate = 0.f;
+	if (Pending.IsEmpty())
+	{
+		Metrics.PendingActors = 0;
+		return;
+	}
+	
+	const double StartTime = FPlatformTime::Seconds();
+	if (bPriorityDirty || StartTime - LastRefreshTime > Settings.PriorityRefreshInterval)
+		RefreshPriorities(World, StartTime);
+
+	// refresh is paid from the same budget
+	const double Deadline = StartTime + Settings.BudgetMicroseconds * 0.000001;
+	double Now = FPlatformTime::Seconds();
+	do
+	{
+		FPendingUpdate PendingUpdate = Pending.Pop(EAllowShrinking::No);
+		PendingIndices.Remove(PendingUpdate.ActorKey);
+		if (PendingUpdate.Actor.IsValid())
+		{
+			PendingUpdate.Interface->AddCombustion(PendingUpdate.Combustion);
+			if (PendingUpdate.Interface->IsIgnited())
+				for (const FIntVector2& CellKey : PendingUpdate.Cells)
+					OnCellIgnited(CellKey);
+		}
+		else
+		{
+			for (const FIntVector2& CellKey : PendingUpdate.Cells)
+				OnCellLost(CellKey);
+		}
+
+		Now = FPlatformTime::Seconds();
+		const float Latency = Now - PendingUpdate.QueuedTime;
+		Metrics.AverageLatency = FMath::Lerp(Metrics.AverageLatency, Latency, 0.05f);
+		Metrics.MaxLatencyLastUpdate = FMath::Max(Metrics.MaxLatencyLastUpdate, Latency);
+		Metrics.AppliedLastUpdate++;
+	}
+	while (!Pending.IsEmpty() && Now < Deadline);
+
+	Metrics.PendingActors = Pending.Num();
+	INC_DWORD_STAT_BY(STAT_FireSim_ActorUpdatesApplied, Metrics.AppliedLastUpdate);
+	SET_FLOAT_STAT(STAT_FireSim_ActorUpdateLatency, Metrics.AverageLatency);
+	SET_FLOAT_STAT(STAT_FireSim_OldestPendingActorUpdate, Metrics.OldestPendingAge);
+}
+
+void FCombustibleUpdateScheduler::Reset()
+{
+	Pending.Reset();
+	PendingIndices.Reset();
+	bPriorityDirty = false;
+	Metrics = FCombustibleUpdateMetrics();
+}
+
+void FCombustibleUpdateScheduler::RefreshPriorities(const UWorld* World, double Now)
+{
+	struct FViewer
+	{
+		FVector Location;
+		FVector Direction;
+		float MinDot;
+	};
+	
+	TArray<FViewer, TInlineAllocator<8>> Viewers;
+	for (FConstPlayerControllerIterator Iterator = World->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+		if (!PlayerController)
+			continue;
+		
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		// a bit wider than the camera, actors that are about to get in view should be ready too
+		const float FOV = PlayerController->PlayerCameraManager ? PlayerController->PlayerCameraManager->GetFOVAngle() : 90.f;
+		Viewers.Add({ ViewLocation, ViewRotation.Vector(), FMath::Cos(FMath::DegreesToRadians(FMath::Min(FOV * 0.6f, 89.f))) });
+	}
+
+	Metrics.OldestPendingAge = 0.f;
+	for (FPendingUpdate& PendingUpdate : Pending)
+	{
+		const float Age = Now - PendingUpdate.QueuedTime;
+		Metrics.OldestPendingAge = FMath::Max(Metrics.OldestPendingAge, Age);
+		PendingUpdate.Urgency = Age * Settings.AgingPerSecond;
+		
+		// removed actors go first, they are cheap and their cells stop gating fire spread
+		const AActor* Actor = PendingUpdate.Actor.Get();
+		if (!Actor)
+		{
+			PendingUpdate.Urgency = FLT_MAX;
+			continue;
+		}
+		
+		const FVector ActorLocation = Actor->GetActorLocation();
+		float ViewRelevance = Viewers.IsEmpty() ? 1.f : 0.f;
+		for (const FViewer& Viewer : Viewers)
+		{
+			const FVector ToActor = ActorLocation - Viewer.Location;
+			const float Distance = ToActor.Size();
+			float Relevance = 1.f / (1.f + Distance / Settings.DistanceFalloff);
+			if (Distance > KINDA_SMALL_NUMBER && (ToActor / Distance | Viewer.Direction) < Viewer.MinDot)
+				Relevance *= Settings.OutOfViewFactor;
+			
+			ViewRelevance = FMath::Max(ViewRelevance, Relevance);
+		}
+
+		PendingUpdate.Urgency += ViewRelevance;
+	}
+
+	Pending.Sort([](const FPendingUpdate& A, const FPendingUpdate& B) { return A.Urgency < B.Urgency; });
+	for (int32 i = 0; i < Pending.Num(); i++)
+		PendingIndices.Add(Pending[i].ActorKey, i);
+	
+	LastRefreshTime = Now;
+	bPriorityDirty = false;
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+#include "UObject/ScriptInterface.h"
+
+class ICombustible;
+struct FFireCellCombustible;
+
+// How well combustible actor updates keep up with the fire
+struct FCombustibleUpdateMetrics
+{
+	int32 PendingActors = 0;
+	int32 AppliedLastUpdate = 0;
+	// moving average of seconds between the first combustion queued for an actor and the update of the actor
+	float AverageLatency = 0.f;
+	float MaxLatencyLastUpdate = 0.f;
+	// how long the oldest pending update has been waiting, as of the last priority refresh
+	float OldestPendingAge = 0.f;
+};
+
+/**
+ * Time-budgeted queue of ICombustible updates. Combustion coming from all cells of an actor is coalesced into one pending update,
+ * and most urgent updates are applied first: actors close to and in view of players, then anything that has been waiting for long.
+ * Game thread only
+ */
+class FIRESIMULATION_API FCombustibleUpdateScheduler
+{
+public:
+	struct FSettings
+	{
+		float BudgetMicroseconds = 500.f;
+		// actor this far from a viewer is half as urgent as the one right next to it
+		float DistanceFalloff = 2500.f;
+		float OutOfViewFactor = 0.25f;
+		// urgency that waiting adds per second, so that far away actors still get their updates
+		float AgingPerSecond = 0.5f;
+		float PriorityRefreshInterval = 0.25f;
+	};
+
+	FSettings Settings;
+
+	void Enqueue(const FFireCellCombustible& Combustible, const FIntVector2& CellKey, float Combustion);
+	
+	// Applies most urgent pending updates until the budget is spent. At least one update is applied per call.
+	// OnCellIgnited is called for every cell of an actor that is ignited after the update, OnCellLost for every cell of an actor that doesn't exist anymore
+	void Update(const UWorld* World, TFunctionRef<void(const FIntVector2&)> OnCellIgnited, TFunctionRef<void(const FIntVector2&)> OnCellLost);
+	
+	void Reset();
+	int32 Num() const { return Pending.Num(); }
+	bool IsEmpty() const { return Pending.IsEmpty(); }
+	const FCombustibleUpdateMetrics& GetMetrics() const { return Metrics; }
+	SIZE_T GetAllocatedSize() const { return Pending.GetAllocatedSize() + PendingIndices.GetAllocatedSize(); }
+
+private:
+	struct FPendingUpdate
+	{
+		TWeakObjectPtr<AActor> Actor;
+		// key stays unique after the actor is destroyed
+		FObjectKey ActorKey;
+		TScriptInterface<ICombustible> Interface;
+		TArray<FIntVector2, TInlineAllocator<4>> Cells;
+		float Combustion = 0.f;
+		double QueuedTime = 0.0;
+		float Urgency = 0.f;
+	};
+
+	void RefreshPriorities(const UWorld* World, double Now);
+	
+	// sorted by urgency on refresh, most urgent last so that updates are popped from the back
+	TArray<FPendingUpdate> Pending;
+	TMap<FObjectKey, int32> PendingIndices;
+	double LastRefreshTime = 0.0;
+	// something was queued since last refresh, back of Pending isn't the most urgent update anymore
+	bool bPriorityDirty = false;
+	FCombustibleUpdateMetrics Metrics;
+};
@@ -0,0 +1,242 @@
+﻿#include "FireCellReplication.h"
+
+#include "Actors/FireSource.h"
+#include "Data/FireSimulationStats.h"
+
+namespace FireCellReplication
+{
+	// small values of either sign take few bytes
+	void SerializeZigZag(FArchive& Ar, int32& Value)
+	{
+		uint32 ZigZagValue = (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31);
+		Ar.SerializeIntPacked(ZigZagValue);
+		Value = static_cast<int32>(ZigZagValue >> 1) ^ -static_cast<int32>(ZigZagValue & 1);
+	}
+}
+
+void FFireCellChunkItem::PreReplicatedRemove(const FFireCellReplicationArray& InArraySerializer)
+{
+	// chunk is removed when all of its cells burnt out
+	CellsMask = 0;
+	ApplyToOwner(InArraySerializer);
+}
+
+void FFireCellChunkItem::PostReplicatedAdd(const FFireCellReplicationArray& InArraySerializer)
+{
+	ApplyToOwner(InArraySerializer);
+}
+
+void FFireCellChunkItem::PostReplicatedChange(const FFireCellReplicationArray& InArraySerializer)
+{
+	ApplyToOwner(InArraySerializer);
+}
+
+void FFireCellChunkItem::ApplyToOwner(const FFireCellReplicationArray& InArraySerializer)
+{
+	AFireSource* Owner = InArraySerializer.Owner;
+	if (!ensure(Owner))
+		return;
+
+	// keys aren't replicated. Count applied changes, so that the owner tells changed chunks apart the same way as server does
+	ReplicationKey++;
+	
+	const FVector Origin = Owner->GetGridOrigin();
+	const double CellSize = Owner->FireCellSize;
+	auto GetWorldLocation = [this, &Origin, CellSize](uint64 CellBit, int16 ZOffset)
+	{
+		const FIntVector2 CellKey = GetCellKey(CellBit);
+		return Origin + FVector(CellKey.X * CellSize, CellKey.Y * CellSize, ZOffset * ZQuantization);
+	};
+	
+	for (uint64 BurntOut = AppliedCellsMask & ~CellsMask; BurntOut != 0; BurntOut &= BurntOut - 1)
+	{
+		const uint64 CellBit = BurntOut & (~BurntOut + 1);
+		Owner->RemoveFireParticle(GetCellKey(CellBit), GetWorldLocation(CellBit, AppliedZOffsets[GetDataIndex(AppliedCellsMask, CellBit)]));
+	}
+	
+	for (uint64 Ignited = CellsMask & ~AppliedCellsMask; Ignited != 0; Ignited &= Ignited - 1)
+	{
+		const uint64 CellBit = Ignited & (~Ignited + 1);
+		const int32 DataIndex = GetDataIndex(CellsMask, CellBit);
+		Owner->AddFireParticle(GetCellKey(CellBit), GetWorldLocation(CellBit, ZOffsets[DataIndex]));
+		if (Phases[DataIndex] != static_cast<uint8>(EFireCellPhase::Burning))
+			Owner->SetFireParticlePhase(GetCellKey(CellBit), static_cast<EFireCellPhase>(Phases[DataIndex]));
+	}
+
+	// cells that were burning before and still are may have started to smolder
+	for (uint64 Kept = CellsMask & AppliedCellsMask; Kept != 0; Kept &= Kept - 1)
+	{
+		const uint64 CellBit = Kept & (~Kept + 1);
+		const uint8 Phase = Phases[GetDataIndex(CellsMask, CellBit)];
+		if (Phase != AppliedPhases[GetDataIndex(AppliedCellsMask, CellBit)])
+			Owner->SetFireParticlePhase(GetCellKey(CellBit), static_cast<EFireCellPhase>(Phase));
+	}
+
+	AppliedCellsMask = CellsMask;
+	AppliedZOffsets = ZOffsets;
+	AppliedPhases = Phases;
+}
+
+FIntVector2 FFireCellChunkItem::GetCellKey(uint64 CellBit) const
+{
+	const int32 BitIndex = FMath::CountTrailingZeros64(CellBit);
+	return FIntVector2((ChunkX << ChunkSizeLog2) | (BitIndex & ChunkMask), (ChunkY << ChunkSizeLog2) | (BitIndex >> ChunkSizeLog2));
+}
+
+bool FFireCellChunkItem::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	FireCellReplication::SerializeZigZag(Ar, ChunkX);
+	FireCellReplication::SerializeZigZag(Ar, ChunkY);
+
+	// mask is sent row by row: 1 bit if the row has cells, then 1 bit if it's full (which it is inside of the fire), otherwise the row byte
+	uint64 NewCellsMask = 0;
+	for (int32 Row = 0; Row < ChunkSize; Row++)
+	{
+		uint8 RowBits = static_cast<uint8>(CellsMask >> (Row * ChunkSize));
+		uint8 bHasCells = RowBits != 0;
+		Ar.SerializeBits(&bHasCells, 1);
+		if (bHasCells)
+		{
+			uint8 bFullRow = RowBits == 0xFF;
+			Ar.SerializeBits(&bFullRow, 1);
+			if (bFullRow)
+				RowBits = 0xFF;
+			else
+				Ar << RowBits;
+		}
+		else
+		{
+			RowBits = 0;
+		}
+
+		NewCellsMask |= static_cast<uint64>(RowBits) << (Row * ChunkSize);
+	}
+
+	if (Ar.IsLoading())
+	{
+		CellsMask = NewCellsMask;
+		Phases.SetNumZeroed(FMath::CountBits(CellsMask));
+		ZOffsets.SetNumZeroed(Phases.Num());
+	}
+
+	// Z is sent as difference from the previous cell of the chunk. Terrain is mostly continuous, so flat runs cost 1 bit per cell
+	int32 PreviousZ = 0;
+	for (int32 i = 0; i < Phases.Num(); i++)
+	{
+		Ar.SerializeBits(&Phases[i], 3);
+
+		int32 DeltaZ = ZOffsets[i] - PreviousZ;
+		uint8 bSameZ = DeltaZ == 0;
+		Ar.SerializeBits(&bSameZ, 1);
+		if (!bSameZ)
+		{
+			FireCellReplication::SerializeZigZag(Ar, DeltaZ);
+		}
+		else
+		{
+			DeltaZ = 0;
+		}
+
+		ZOffsets[i] = static_cast<int16>(PreviousZ + DeltaZ);
+		PreviousZ = ZOffsets[i];
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+void FFireCellReplicationArray::SetCell(const FIntVector2& CellKey, double RelativeZ, EFireCellPhase Phase)
+{
+	FFireCellChunkItem& Chunk = FindOrAddChunk(FFireCellChunkItem::GetChunkCoord(CellKey));
+	const uint64 CellBit = FFireCellChunkItem::GetCellBit(CellKey);
+	const int32 DataIndex = FFireCellChunkItem::GetDataIndex(Chunk.CellsMask, CellBit);
+	if (Chunk.CellsMask & CellBit)
+	{
+		Chunk.Phases[DataIndex] = static_cast<uint8>(Phase);
+		Chunk.ZOffsets[DataIndex] = FFireCellChunkItem::QuantizeZ(RelativeZ);
+	}
+	else
+	{
+		Chunk.CellsMask |= CellBit;
+		Chunk.Phases.Insert(static_cast<uint8>(Phase), DataIndex);
+		Chunk.ZOffsets.Insert(FFireCellChunkItem::QuantizeZ(RelativeZ), DataIndex);
+	}
+
+	MarkItemDirty(Chunk);
+}
+
+void FFireCellReplicationArray::SetCellPhase(const FIntVector2& CellKey, EFireCellPhase Phase)
+{
+	const int32* ChunkIndex = ChunkLookup.Find(FFireCellChunkItem::GetChunkCoord(CellKey));
+	if (!ChunkIndex)
+		return;
+
+	FFireCellChunkItem& Chunk = Items[*ChunkIndex];
+	const uint64 CellBit = FFireCellChunkItem::GetCellBit(CellKey);
+	if ((Chunk.CellsMask & CellBit) == 0)
+		return;
+
+	Chunk.Phases[FFireCellChunkItem::GetDataIndex(Chunk.CellsMask, CellBit)] = static_cast<uint8>(Phase);
+	MarkItemDirty(Chunk);
+}
+
+void FFireCellReplicationArray::RemoveCell(const FIntVector2& CellKey)
+{
+	const FIntVector2 ChunkCoord = FFireCellChunkItem::GetChunkCoord(CellKey);
+	const int32* ChunkIndexPtr = ChunkLookup.Find(ChunkCoord);
+	if (!ChunkIndexPtr)
+		return;
+
+	const int32 ChunkIndex = *ChunkIndexPtr;
+	FFireCellChunkItem& Chunk = Items[ChunkIndex];
+	const uint64 CellBit = FFireCellChunkItem::GetCellBit(CellKey);
+	if ((Chunk.CellsMask & CellBit) == 0)
+		return;
+
+	const int32 DataIndex = FFireCellChunkItem::GetDataIndex(Chunk.CellsMask, CellBit);
+	Chunk.CellsMask &= ~CellBit;
+	Chunk.Phases.RemoveAt(DataIndex);
+	Chunk.ZOffsets.RemoveAt(DataIndex);
+	if (Chunk.CellsMask != 0)
+	{
+		MarkItemDirty(Chunk);
+		return;
+	}
+
+	ChunkLookup.Remove(ChunkCoord);
+	Items.RemoveAtSwap(ChunkIndex);
+	if (ChunkIndex < Items.Num())
+		ChunkLookup[Items[ChunkIndex].GetChunkCoord()] = ChunkIndex;
+	
+	MarkArrayDirty();
+}
+
+bool FFireCellReplicationArray::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	const int64 StartBits = DeltaParms.Writer ? DeltaParms.Writer->GetNumBits() : 0;
+	const bool bSuccess = FFastArraySerializer::FastArrayDeltaSerialize<FFireCellChunkItem, FFireCellReplicationArray>(Items, DeltaParms, *this);
+	if (DeltaParms.Writer)
+	{
+		INC_DWORD_STAT_BY(STAT_FireSim_ReplicatedBytes, (DeltaParms.Writer->GetNumBits() - StartBits + 7) / 8);
+	}
+	
+	return bSuccess;
+}
+
+void FFireCellReplicationArray::PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters)
+{
+	if (Owner)
+		Owner->OnReplicatedCellsReceived();
+}
+
+FFireCellChunkItem& FFireCellReplicationArray::FindOrAddChunk(const FIntVector2& ChunkCoord)
+{
+	if (const int32* ChunkIndex = ChunkLookup.Find(ChunkCoord))
+		return Items[*ChunkIndex];
+
+	ChunkLookup.Add(ChunkCoord, Items.Num());
+	FFireCellChunkItem& Chunk = Items.AddDefaulted_GetRef();
+	Chunk.ChunkX = ChunkCoord.X;
+	Chunk.ChunkY = ChunkCoord.Y;
+	return Chunk;
+}
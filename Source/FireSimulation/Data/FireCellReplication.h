@@ -0,0 +1,113 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Data/FireSimulationDataTypes.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "FireCellReplication.generated.h"
+
+class AFireSource;
+struct FFireCellReplicationArray;
+
+// Burning cells of an 8x8 block replicated as one fast array item. Blocks keep the amount of items (and so the amount of changes per update)
+// far below fast array limits, and a late joiner receives the fire as many small items instead of one huge array.
+// Cell data is ordered by bit index in CellsMask.
+// Cells are sent as grid indices: X/Y come from chunk coordinate and the bit, only Z is stored, quantized relative to GetGridOrigin().Z.
+// Keys are world-aligned, so clients reconstruct world location as (X * FireCellSize, Y * FireCellSize, GetGridOrigin().Z + Z)
+USTRUCT()
+struct FFireCellChunkItem : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	static constexpr int32 ChunkSizeLog2 = 3;
+	static constexpr int32 ChunkSize = 1 << ChunkSizeLog2;
+	static constexpr int32 ChunkMask = ChunkSize - 1;
+	// Z offsets are stored in units of this many cm, which gives +-655 m of height range
+	static constexpr float ZQuantization = 2.f;
+
+	// cell keys are world-aligned, so chunk coordinates are as well. Full range is kept, they are sent packed: a few bytes anywhere in a level
+	UPROPERTY()
+	int32 ChunkX = 0;
+
+	UPROPERTY()
+	int32 ChunkY = 0;
+
+	// bit per cell of the block, row-major
+	UPROPERTY()
+	uint64 CellsMask = 0;
+
+	// EFireCellPhase of every cell
+	UPROPERTY()
+	TArray<uint8> Phases;
+
+	// quantized cell Z relative to GetGridOrigin().Z
+	UPROPERTY()
+	TArray<int16> ZOffsets;
+
+	// client only, last state that was applied. Used to tell ignited and burnt out cells apart when the item changes
+	uint64 AppliedCellsMask = 0;
+	TArray<int16> AppliedZOffsets;
+	TArray<uint8> AppliedPhases;
+
+	FORCEINLINE static FIntVector2 GetChunkCoord(const FIntVector2& CellKey) { return FIntVector2(CellKey.X >> ChunkSizeLog2, CellKey.Y >> ChunkSizeLog2); }
+	FORCEINLINE static uint64 GetCellBit(const FIntVector2& CellKey) { return 1ull << (((CellKey.Y & ChunkMask) << ChunkSizeLog2) | (CellKey.X & ChunkMask)); }
+	FORCEINLINE static int32 GetDataIndex(uint64 Mask, uint64 CellBit) { return FMath::CountBits(Mask & (CellBit - 1)); }
+	FORCEINLINE static int16 QuantizeZ(double RelativeZ) { return static_cast<int16>(FMath::Clamp(FMath::RoundToInt32(RelativeZ / ZQuantization), MIN_int16, MAX_int16)); }
+	FIntVector2 GetCellKey(uint64 CellBit) const;
+	FIntVector2 GetChunkCoord() const { return FIntVector2(ChunkX, ChunkY); }
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+	void PreReplicatedRemove(const FFireCellReplicationArray& InArraySerializer);
+	void PostReplicatedAdd(const FFireCellReplicationArray& InArraySerializer);
+	void PostReplicatedChange(const FFireCellReplicationArray& InArraySerializer);
+
+private:
+	void ApplyToOwner(const FFireCellReplicationArray& InArraySerializer);
+};
+
+template<>
+struct TStructOpsTypeTraits<FFireCellChunkItem> : public TStructOpsTypeTraitsBase2<FFireCellChunkItem>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+// Delta replicated set of burning cells of a fire source. Server adds, changes and removes cells, clients get per-chunk deltas
+// and forward ignited and burnt out locations to the owner's VFX
+USTRUCT()
+struct FFireCellReplicationArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FFireCellChunkItem> Items;
+
+	AFireSource* Owner = nullptr;
+
+	// server
+	void SetCell(const FIntVector2& CellKey, double RelativeZ, EFireCellPhase Phase);
+	void SetCellPhase(const FIntVector2& CellKey, EFireCellPhase Phase);
+	void RemoveCell(const FIntVector2& CellKey);
+
+	// client
+	void PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+
+private:
+	FFireCellChunkItem& FindOrAddChunk(const FIntVector2& ChunkCoord);
+	
+	// server only, chunk coord -> index in Items
+	TMap<FIntVector2, int32> ChunkLookup;
+};
+
+template<>
+struct TStructOpsTypeTraits<FFireCellReplicationArray> : public TStructOpsTypeTraitsBase2<FFireCellReplicationArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
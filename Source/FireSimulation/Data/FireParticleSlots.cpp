@@ -0,0 +1,94 @@
+﻿#include "FireParticleSlots.h"
+
+bool FFireParticleSlots::Add(const FIntVector2& CellKey, const FVector& Location, float Intensity)
+{
+	int32 Slot = INDEX_NONE;
+	if (const int32* ExistingSlot = SlotIndices.Find(CellKey))
+	{
+		Slot = *ExistingSlot;
+	}
+	else if (!FreeSlots.IsEmpty())
+	{
+		Slot = FreeSlots.Pop(EAllowShrinking::No);
+	}
+	else if (Positions.Num() < Capacity)
+	{
+		// new slots are free until taken, so growing in big steps costs nothing but memory, and whole uploads stay rare
+		const int32 OldSize = Positions.Num();
+		const int32 NewSize = FMath::Min(Capacity, FMath::Max(4096, OldSize * 2));
+		Positions.SetNumZeroed(NewSize);
+		Intensities.SetNumZeroed(NewSize);
+		DirtyFlags.Add(false, NewSize - OldSize);
+		for (int32 NewSlot = NewSize - 1; NewSlot > OldSize; NewSlot--)
+			FreeSlots.Add(NewSlot);
+		
+		Slot = OldSize;
+		bResized = true;
+	}
+	else
+	{
+		return false;
+	}
+
+	SlotIndices.Add(CellKey, Slot);
+	Positions[Slot] = Location;
+	Intensities[Slot] = Intensity;
+	MarkDirty(Slot);
+	return true;
+}
+
+void FFireParticleSlots::SetIntensity(const FIntVector2& CellKey, float Intensity)
+{
+	const int32* Slot = SlotIndices.Find(CellKey);
+	if (Slot && Intensities[*Slot] != Intensity)
+	{
+		Intensities[*Slot] = Intensity;
+		MarkDirty(*Slot);
+	}
+}
+
+void FFireParticleSlots::Remove(const FIntVector2& CellKey)
+{
+	int32 Slot;
+	if (!SlotIndices.RemoveAndCopyValue(CellKey, Slot))
+		return;
+
+	Intensities[Slot] = 0.f;
+	FreeSlots.Add(Slot);
+	MarkDirty(Slot);
+}
+
+void FFireParticleSlots::Reset()
+{
+	Positions.Reset();
+	Intensities.Reset();
+	FreeSlots.Reset();
+	SlotIndices.Reset();
+	DirtyFlags.Reset();
+	DirtySlots.Reset();
+	bResized = true;
+}
+
+void FFireParticleSlots::MarkDirty(int32 Slot)
+{
+	if (!DirtyFlags[Slot])
+	{
+		DirtyFlags[Slot] = true;
+		DirtySlots.Add(Slot);
+	}
+}
+
+void FFireParticleSlots::ClearDirty()
+{
+	for (const int32 Slot : DirtySlots)
+		DirtyFlags[Slot] = false;
+	
+	DirtySlots.Reset();
+	bResized = false;
+}
+
+SIZE_T FFireParticleSlots::GetAllocatedSize() const
+{
+	return Positions.GetAllocatedSize() + Intensities.GetAllocatedSize() + FreeSlots.GetAllocatedSize() + SlotIndices.GetAllocatedSize()
+		+ DirtyFlags.GetAllocatedSize() + DirtySlots.GetAllocatedSize();
+}
@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Stable VFX particle slots of burning cells. Every burning cell owns an index in position and intensity arrays until it burns out,
+ * then the index goes to a free list and the next ignited cell reuses it. VFX reads the arrays as persistent state, so only changed slots
+ * have to be uploaded, and a client that joins late gets the current fire instead of a burst of every particle at once.
+ * Arrays grow geometrically up to the capacity, cells that ignite when all slots are taken get no particle. Game thread only
+ */
+class FIRESIMULATION_API FFireParticleSlots
+{
+public:
+	void SetCapacity(int32 NewCapacity) { Capacity = NewCapacity; }
+	
+	// false if there are no free slots
+	bool Add(const FIntVector2& CellKey, const FVector& Location, float Intensity);
+	void SetIntensity(const FIntVector2& CellKey, float Intensity);
+	void Remove(const FIntVector2& CellKey);
+	void Reset();
+
+	int32 Num() const { return SlotIndices.Num(); }
+	const TArray<FVector>& GetPositions() const { return Positions; }
+	const TArray<float>& GetIntensities() const { return Intensities; }
+	
+	bool IsDirty() const { return bResized || !DirtySlots.IsEmpty(); }
+	// arrays grew since the last ClearDirty, they have to be uploaded as a whole
+	bool IsResized() const { return bResized; }
+	const TArray<int32>& GetDirtySlots() const { return DirtySlots; }
+	void ClearDirty();
+	
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	void MarkDirty(int32 Slot);
+	
+	int32 Capacity = 65536;
+	TArray<FVector> Positions;
+	// 0 for free slots
+	TArray<float> Intensities;
+	TArray<int32> FreeSlots;
+	TMap<FIntVector2, int32> SlotIndices;
+	TBitArray<> DirtyFlags;
+	TArray<int32> DirtySlots;
+	bool bResized = false;
+};
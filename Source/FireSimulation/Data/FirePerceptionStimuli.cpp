@@ -0,0 +1,130 @@
+﻿#include "FirePerceptionStimuli.h"
+
+#include "Actors/FirePerceptionStimulus.h"
+#include "Data/FireSimulationStats.h"
+
+FIntVector2 FFirePerceptionStimuli::GetSpotKey(const FVector& Location) const
+{
+	return FIntVector2(FMath::FloorToInt32(Location.X / Settings.Spacing), FMath::FloorToInt32(Location.Y / Settings.Spacing));
+}
+
+void FFirePerceptionStimuli::AddBurningCell(const FVector& Location)
+{
+	const FIntVector2 SpotKey = GetSpotKey(Location);
+	FSpot& Spot = Spots.FindOrAdd(SpotKey);
+	Spot.BurningCells.Add(Location);
+	Spot.Location = Location;
+	DirtySpots.Add(SpotKey);
+}
+
+void FFirePerceptionStimuli::RemoveBurningCell(const FVector& Location)
+{
+	const FIntVector2 SpotKey = GetSpotKey(Location);
+	FSpot* Spot = Spots.Find(SpotKey);
+	const int32 CellIndex = Spot ? Spot->BurningCells.Find(Location) : INDEX_NONE;
+	if (CellIndex == INDEX_NONE)
+		return;
+	
+	Spot->BurningCells.RemoveAtSwap(CellIndex, EAllowShrinking::No);
+	if (Spot->BurningCells.IsEmpty())
+	{
+		DirtySpots.Add(SpotKey);
+	}
+	else if (Spot->Location == Location)
+	{
+		// stimulus can't stay on ash
+		Spot->Location = Spot->BurningCells.Last();
+		DirtySpots.Add(SpotKey);
+	}
+}
+
+void FFirePerceptionStimuli::Update(AActor* Owner)
+{
+	int32 Registrations = 0;
+	FIntVector2 RetrySpotKey;
+	bool bRetrySpot = false;
+	for (auto It = DirtySpots.CreateIterator(); It && Registrations < Settings.MaxRegistrationsPerUpdate; ++It)
+	{
+		const FIntVector2 SpotKey = *It;
+		It.RemoveCurrent();
+		FSpot* Spot = Spots.Find(SpotKey);
+		if (!Spot)
+			continue;
+		
+		AFirePerceptionStimulus* Stimulus = Spot->Stimulus.Get();
+		if (Spot->BurningCells.IsEmpty())
+		{
+			if (Stimulus)
+			{
+				Stimulus->SetStimulusActive(false);
+				FreeStimuli.Add(Stimulus);
+				ActiveCount--;
+				Registrations++;
+			}
+			
+			Spots.Remove(SpotKey);
+			continue;
+		}
+
+		if (!Stimulus)
+		{
+			Stimulus = AcquireStimulus(Owner);
+			// can't spawn now, it won't get better until the next update
+			if (!Stimulus)
+			{
+				RetrySpotKey = SpotKey;
+				bRetrySpot = true;
+				break;
+			}
+			
+			Spot->Stimulus = Stimulus;
+		}
+		
+		// moving a registered stimulus is free for perception, it reads locations when it senses
+		Stimulus->SetActorLocation(Spot->Location + FVector(0.f, 0.f, Settings.Height));
+		if (!Stimulus->IsStimulusActive())
+		{
+			Stimulus->SetStimulusActive(true);
+			ActiveCount++;
+			Registrations++;
+		}
+	}
+
+	if (bRetrySpot)
+		DirtySpots.Add(RetrySpotKey);
+	
+	SET_DWORD_STAT(STAT_FireSim_PerceptionStimuli, ActiveCount);
+}
+
+AFirePerceptionStimulus* FFirePerceptionStimuli::AcquireStimulus(AActor* Owner)
+{
+	while (!FreeStimuli.IsEmpty())
+		if (AFirePerceptionStimulus* FreeStimulus = FreeStimuli.Pop(EAllowShrinking::No).Get())
+			return FreeStimulus;
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Owner = Owner;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AFirePerceptionStimulus* Stimulus = Owner->GetWorld()->SpawnActor<AFirePerceptionStimulus>(Owner->GetActorLocation(), FRotator::ZeroRotator, SpawnParameters);
+	if (Stimulus)
+	{
+		Stimulus->SetSenses(Settings.Senses);
+		AllStimuli.Add(Stimulus);
+	}
+	
+	return Stimulus;
+}
+
+void FFirePerceptionStimuli::Reset()
+{
+	for (const TWeakObjectPtr<AFirePerceptionStimulus>& Stimulus : AllStimuli)
+		if (Stimulus.IsValid())
+			Stimulus->Destroy();
+	
+	Spots.Reset();
+	DirtySpots.Reset();
+	FreeStimuli.Reset();
+	AllStimuli.Reset();
+	ActiveCount = 0;
+}
@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class AActor;
+class AFirePerceptionStimulus;
+class UAISense;
+
+/**
+ * Sparse set of perception stimuli over the burning area. The world is split in squares of Spacing size, and every square
+ * with burning cells gets one stimulus, at the latest cell that ignited in it, so stimuli follow the fire front. When that cell burns out
+ * the stimulus moves to another cell of the square that still burns.
+ * Stimuli actors are pooled, and only a limited amount of them is registered or unregistered with perception system per update,
+ * since perception cost grows with registered sources. Game thread only
+ */
+class FIRESIMULATION_API FFirePerceptionStimuli
+{
+public:
+	struct FSettings
+	{
+		float Spacing = 1000.f;
+		// above the burning cell, so that sight traces don't hit the ground the fire is on
+		float Height = 50.f;
+		int32 MaxRegistrationsPerUpdate = 16;
+		TArray<TSubclassOf<UAISense>> Senses;
+	};
+
+	FSettings Settings;
+
+	void AddBurningCell(const FVector& Location);
+	void RemoveBurningCell(const FVector& Location);
+	
+	void Update(AActor* Owner);
+	// destroys all stimuli
+	void Reset();
+	
+	int32 NumActive() const { return ActiveCount; }
+
+private:
+	struct FSpot
+	{
+		// cells burn out roughly in the order they ignited, so the one to remove is usually found near the start
+		TArray<FVector> BurningCells;
+		FVector Location = FVector::ZeroVector;
+		TWeakObjectPtr<AFirePerceptionStimulus> Stimulus;
+	};
+
+	FIntVector2 GetSpotKey(const FVector& Location) const;
+	AFirePerceptionStimulus* AcquireStimulus(AActor* Owner);
+	
+	TMap<FIntVector2, FSpot> Spots;
+	// spots whose burning cells appeared, moved or disappeared since they were last applied
+	TSet<FIntVector2> DirtySpots;
+	TArray<TWeakObjectPtr<AFirePerceptionStimulus>> FreeStimuli;
+	TArray<TWeakObjectPtr<AFirePerceptionStimulus>> AllStimuli;
+	int32 ActiveCount = 0;
+};
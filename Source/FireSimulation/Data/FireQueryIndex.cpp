@@ -0,0 +1,273 @@
+﻿#include "FireQueryIndex.h"
+
+#include "Data/FireCellReplication.h"
+
+void FFireQueryIndex::AddBucket(const FIntVector2& BucketCoord, uint64 CellsMask)
+{
+	BuildingBucket = MakeShared<FBucket, ESPMode::ThreadSafe>();
+	BuildingBucket->CellsMask = CellsMask;
+	BuildingBucket->Cells.Reserve(FMath::CountBits(CellsMask));
+	Buckets.Add(BucketCoord, BuildingBucket.ToSharedRef());
+}
+
+void FFireQueryIndex::AddCell(const FIntVector2& CellKey, float Z, float CombustionState, float FireHeight, bool bSmoldering)
+{
+	const FCell& Cell = BuildingBucket->Cells.Add_GetRef({ Z, CombustionState, FireHeight, bSmoldering });
+	BuildingBucket->Bounds += GetFlameColumn(CellKey, Cell);
+}
+
+void FFireQueryIndex::RemoveBucket(const FIntVector2& BucketCoord)
+{
+	Buckets.Remove(BucketCoord);
+}
+
+void FFireQueryIndex::UpdateBounds()
+{
+	// removed and rebuilt buckets can shrink the bounds, so they are summed from scratch. One box per bucket
+	BuildingBucket.Reset();
+	Bounds.Init();
+	for (const TPair<FIntVector2, FBucketRef>& Bucket : Buckets)
+		Bounds += Bucket.Value->Bounds;
+}
+
+FIntVector2 FFireQueryIndex::GetCellKey(double X, double Y) const
+{
+	return FIntVector2(FMath::RoundToInt32(X / CellSize), FMath::RoundToInt32(Y / CellSize));
+}
+
+const FFireQueryIndex::FCell* FFireQueryIndex::FindCell(const FIntVector2& CellKey) const
+{
+	const FBucketRef* Bucket = Buckets.Find(FFireCellChunkItem::GetChunkCoord(CellKey));
+	if (!Bucket)
+		return nullptr;
+	
+	const uint64 CellBit = FFireCellChunkItem::GetCellBit(CellKey);
+	const uint64 CellsMask = (*Bucket)->CellsMask;
+	return CellsMask & CellBit ? &(*Bucket)->Cells[FFireCellChunkItem::GetDataIndex(CellsMask, CellBit)] : nullptr;
+}
+
+FBox FFireQueryIndex::GetFlameColumn(const FIntVector2& CellKey, const FCell& Cell) const
+{
+	const double HalfCellSize = CellSize * 0.5;
+	const FVector2D Center(CellKey.X * CellSize, CellKey.Y * CellSize);
+	return FBox(FVector(Center.X - HalfCellSize, Center.Y - HalfCellSize, Cell.Z - HalfCellSize),
+		FVector(Center.X + HalfCellSize, Center.Y + HalfCellSize, Cell.Z + Cell.FireHeight));
+}
+
+FFireQueryResult FFireQueryIndex::MakeResult(const FIntVector2& CellKey, const FCell& Cell, double Distance) const
+{
+	FFireQueryResult Result;
+	Result.Location = FVector(CellKey.X * CellSize, CellKey.Y * CellSize, Cell.Z);
+	Result.CombustionState = Cell.CombustionState;
+	Result.FireHeight = Cell.FireHeight;
+	Result.bSmoldering = Cell.bSmoldering;
+	Result.Distance = Distance;
+	return Result;
+}
+
+template<typename TVisitor>
+void FFireQueryIndex::ForEachCell(const FIntVector2& MinKey, const FIntVector2& MaxKey, TVisitor&& Visitor) const
+{
+	const FIntVector2 MinBucket = FFireCellChunkItem::GetChunkCoord(MinKey);
+	const FIntVector2 MaxBucket = FFireCellChunkItem::GetChunkCoord(MaxKey);
+	// huge areas touch more buckets than there are, walk the existing ones instead
+	const int64 BucketsInRange = static_cast<int64>(MaxBucket.X - MinBucket.X + 1) * (MaxBucket.Y - MinBucket.Y + 1);
+	auto VisitBucket = [&](const FIntVector2& BucketCoord, const FBucket& Bucket)
+	{
+		int32 CellIndex = 0;
+		for (uint64 Mask = Bucket.CellsMask; Mask != 0; Mask &= Mask - 1, CellIndex++)
+		{
+			const int32 BitIndex = FMath::CountTrailingZeros64(Mask);
+			const FIntVector2 CellKey((BucketCoord.X << FFireCellChunkItem::ChunkSizeLog2) | (BitIndex & FFireCellChunkItem::ChunkMask),
+				(BucketCoord.Y << FFireCellChunkItem::ChunkSizeLog2) | (BitIndex >> FFireCellChunkItem::ChunkSizeLog2));
+			if (CellKey.X >= MinKey.X && CellKey.X <= MaxKey.X && CellKey.Y >= MinKey.Y && CellKey.Y <= MaxKey.Y)
+				Visitor(CellKey, Bucket.Cells[CellIndex]);
+		}
+	};
+	
+	if (BucketsInRange > Buckets.Num())
+	{
+		for (const TPair<FIntVector2, FBucketRef>& Bucket : Buckets)
+			if (Bucket.Key.X >= MinBucket.X && Bucket.Key.X <= MaxBucket.X && Bucket.Key.Y >= MinBucket.Y && Bucket.Key.Y <= MaxBucket.Y)
+				VisitBucket(Bucket.Key, *Bucket.Value);
+		
+		return;
+	}
+	
+	for (int32 Y = MinBucket.Y; Y <= MaxBucket.Y; Y++)
+	{
+		for (int32 X = MinBucket.X; X <= MaxBucket.X; X++)
+		{
+			const FIntVector2 BucketCoord(X, Y);
+			if (const FBucketRef* Bucket = Buckets.Find(BucketCoord))
+				VisitBucket(BucketCoord, **Bucket);
+		}
+	}
+}
+
+bool FFireQueryIndex::QueryPoint(const FVector& Location, FFireQueryResult& OutResult) const
+{
+	if (!Bounds.IsInsideOrOn(Location))
+		return false;
+	
+	const FIntVector2 CellKey = GetCellKey(Location.X, Location.Y);
+	const FCell* Cell = FindCell(CellKey);
+	if (!Cell || !GetFlameColumn(CellKey, *Cell).IsInsideOrOn(Location))
+		return false;
+	
+	OutResult = MakeResult(CellKey, *Cell, 0.0);
+	return true;
+}
+
+void FFireQueryIndex::QueryRadius(const FVector& Center, float Radius, TArray<FFireQueryResult>& OutResults) const
+{
+	if (Bounds.ComputeSquaredDistanceToPoint(Center) > FMath::Square(Radius))
+		return;
+	
+	const double RadiusSquared = FMath::Square(Radius);
+	ForEachCell(GetCellKey(Center.X - Radius, Center.Y - Radius), GetCellKey(Center.X + Radius, Center.Y + Radius),
+		[this, &Center, RadiusSquared, &OutResults](const FIntVector2& CellKey, const FCell& Cell)
+		{
+			const double DistanceSquared = GetFlameColumn(CellKey, Cell).ComputeSquaredDistanceToPoint(Center);
+			if (DistanceSquared <= RadiusSquared)
+				OutResults.Emplace(MakeResult(CellKey, Cell, FMath::Sqrt(DistanceSquared)));
+		});
+}
+
+void FFireQueryIndex::QueryBox(const FBox& Box, TArray<FFireQueryResult>& OutResults) const
+{
+	if (!Bounds.Intersect(Box))
+		return;
+	
+	const FVector Center = Box.GetCenter();
+	ForEachCell(GetCellKey(Box.Min.X, Box.Min.Y), GetCellKey(Box.Max.X, Box.Max.Y), [this, &Box, &Center, &OutResults](const FIntVector2& CellKey, const FCell& Cell)
+	{
+		const FBox FlameColumn = GetFlameColumn(CellKey, Cell);
+		if (FlameColumn.Intersect(Box))
+			OutResults.Emplace(MakeResult(CellKey, Cell, FMath::Sqrt(FlameColumn.ComputeSquaredDistanceToPoint(Center))));
+	});
+}
+
+bool FFireQueryIndex::FindNearest(const FVector& Location, float Radius, FFireQueryResult& OutResult) const
+{
+	if (Bounds.ComputeSquaredDistanceToPoint(Location) > FMath::Square(Radius))
+		return false;
+	
+	double NearestDistanceSquared = FMath::Square(Radius);
+	const FCell* NearestCell = nullptr;
+	FIntVector2 NearestCellKey;
+	ForEachCell(GetCellKey(Location.X - Radius, Location.Y - Radius), GetCellKey(Location.X + Radius, Location.Y + Radius),
+		[&](const FIntVector2& CellKey, const FCell& Cell)
+		{
+			const double DistanceSquared = GetFlameColumn(CellKey, Cell).ComputeSquaredDistanceToPoint(Location);
+			if (DistanceSquared <= NearestDistanceSquared)
+			{
+				NearestDistanceSquared = DistanceSquared;
+				NearestCell = &Cell;
+				NearestCellKey = CellKey;
+			}
+		});
+
+	if (!NearestCell)
+		return false;
+	
+	OutResult = MakeResult(NearestCellKey, *NearestCell, FMath::Sqrt(NearestDistanceSquared));
+	return true;
+}
+
+bool FFireQueryIndex::QuerySegment(const FVector& Start, const FVector& End, FFireQueryResult& OutResult) const
+{
+	if (!FMath::LineBoxIntersection(Bounds, Start, End, End - Start))
+		return false;
+	
+	// walk cells under the segment in order (2D DDA). Cell centers are at integer coordinates, so borders are at +-0.5
+	const FVector2D From(Start.X / CellSize, Start.Y / CellSize);
+	const FVector2D Direction = FVector2D(End.X / CellSize, End.Y / CellSize) - From;
+	FIntVector2 CellKey = GetCellKey(Start.X, Start.Y);
+	const FIntVector2 EndCellKey = GetCellKey(End.X, End.Y);
+	const int32 StepX = Direction.X >= 0.0 ? 1 : -1;
+	const int32 StepY = Direction.Y >= 0.0 ? 1 : -1;
+	const double DeltaX = Direction.X != 0.0 ? StepX / Direction.X : UE_DOUBLE_BIG_NUMBER;
+	const double DeltaY = Direction.Y != 0.0 ? StepY / Direction.Y : UE_DOUBLE_BIG_NUMBER;
+	double NextX = Direction.X != 0.0 ? (CellKey.X + StepX * 0.5 - From.X) / Direction.X : UE_DOUBLE_BIG_NUMBER;
+	double NextY = Direction.Y != 0.0 ? (CellKey.Y + StepY * 0.5 - From.Y) / Direction.Y : UE_DOUBLE_BIG_NUMBER;
+	
+	const int32 StepsCount = FMath::Abs(EndCellKey.X - CellKey.X) + FMath::Abs(EndCellKey.Y - CellKey.Y);
+	for (int32 Step = 0; Step <= StepsCount; Step++)
+	{
+		if (const FCell* Cell = FindCell(CellKey))
+		{
+			FVector HitLocation;
+			FVector HitNormal;
+			float HitTime;
+			if (FMath::LineExtentBoxIntersection(GetFlameColumn(CellKey, *Cell), Start, End, FVector::ZeroVector, HitLocation, HitNormal, HitTime))
+			{
+				OutResult = MakeResult(CellKey, *Cell, FVector::Dist(Start, HitLocation));
+				return true;
+			}
+		}
+
+		if (NextX < NextY)
+		{
+			CellKey.X += StepX;
+			NextX += DeltaX;
+		}
+		else
+		{
+			CellKey.Y += StepY;
+			NextY += DeltaY;
+		}
+	}
+	
+	return false;
+}
+
+bool FFireQuerySnapshot::QueryPoint(const FVector& Location, FFireQueryResult& OutResult) const
+{
+	for (const FFireQueryIndexRef& Index : Indices)
+		if (Index->QueryPoint(Location, OutResult))
+			return true;
+	
+	return false;
+}
+
+void FFireQuerySnapshot::QueryRadius(const FVector& Center, float Radius, TArray<FFireQueryResult>& OutResults) const
+{
+	for (const FFireQueryIndexRef& Index : Indices)
+		Index->QueryRadius(Center, Radius, OutResults);
+}
+
+void FFireQuerySnapshot::QueryBox(const FBox& Box, TArray<FFireQueryResult>& OutResults) const
+{
+	for (const FFireQueryIndexRef& Index : Indices)
+		Index->QueryBox(Box, OutResults);
+}
+
+bool FFireQuerySnapshot::FindNearest(const FVector& Location, float Radius, FFireQueryResult& OutResult) const
+{
+	bool bFound = false;
+	for (const FFireQueryIndexRef& Index : Indices)
+	{
+		// every next index only has to beat the nearest found so far
+		if (Index->FindNearest(Location, bFound ? OutResult.Distance : Radius, OutResult))
+			bFound = true;
+	}
+	
+	return bFound;
+}
+
+bool FFireQuerySnapshot::QuerySegment(const FVector& Start, const FVector& End, FFireQueryResult& OutResult) const
+{
+	bool bFound = false;
+	FFireQueryResult IndexResult;
+	for (const FFireQueryIndexRef& Index : Indices)
+	{
+		if (Index->QuerySegment(Start, End, IndexResult) && (!bFound || IndexResult.Distance < OutResult.Distance))
+		{
+			OutResult = IndexResult;
+			bFound = true;
+		}
+	}
+	
+	return bFound;
+}
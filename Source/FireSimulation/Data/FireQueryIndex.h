@@ -0,0 +1,107 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "FireQueryIndex.generated.h"
+
+// Burning cell found by a fire query
+USTRUCT(BlueprintType)
+struct FIRESIMULATION_API FFireQueryResult
+{
+	GENERATED_BODY()
+
+	// ground location of the cell, flames go up from it by FireHeight
+	UPROPERTY(BlueprintReadOnly)
+	FVector Location = FVector::ZeroVector;
+
+	// exact on server. Clients don't receive combustion, they get 1 for burning cells and 0.5 for smoldering ones
+	UPROPERTY(BlueprintReadOnly)
+	float CombustionState = 0.f;
+
+	// exact on server, base fire strength of the fire source on clients
+	UPROPERTY(BlueprintReadOnly)
+	float FireHeight = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	bool bSmoldering = false;
+
+	// from the query location to the flame column of the cell. 0 for point queries, from Start to where the segment enters flames for segment queries
+	UPROPERTY(BlueprintReadOnly)
+	float Distance = 0.f;
+};
+
+// Immutable spatial index of burning cells of one fire source. Built on game thread, then only read, so it can be queried from any thread.
+// Cells are hashed in 8x8 buckets, the same blocks that replicate burning cells, so server and clients index the same fire the same way.
+// Buckets are immutable and ref-counted: the next index is a copy of the previous one that replaces only the buckets of changed blocks.
+// A cell is a flame column: cell square from ground Z (minus half a cell of slack for uneven ground) up to ground Z + fire height
+class FIRESIMULATION_API FFireQueryIndex
+{
+public:
+	explicit FFireQueryIndex(double InCellSize) : CellSize(InCellSize) {}
+
+	// building. AddBucket replaces the bucket, its cells must be added right after it, in the order of bits of CellsMask.
+	// UpdateBounds is called once all buckets are set
+	void AddBucket(const FIntVector2& BucketCoord, uint64 CellsMask);
+	void AddCell(const FIntVector2& CellKey, float Z, float CombustionState, float FireHeight, bool bSmoldering);
+	void RemoveBucket(const FIntVector2& BucketCoord);
+	void UpdateBounds();
+
+	bool IsEmpty() const { return Buckets.IsEmpty(); }
+	const FBox& GetBounds() const { return Bounds; }
+
+	bool QueryPoint(const FVector& Location, FFireQueryResult& OutResult) const;
+	void QueryRadius(const FVector& Center, float Radius, TArray<FFireQueryResult>& OutResults) const;
+	void QueryBox(const FBox& Box, TArray<FFireQueryResult>& OutResults) const;
+	bool FindNearest(const FVector& Location, float Radius, FFireQueryResult& OutResult) const;
+	// first burning cell along the segment, from Start
+	bool QuerySegment(const FVector& Start, const FVector& End, FFireQueryResult& OutResult) const;
+
+private:
+	struct FCell
+	{
+		float Z = 0.f;
+		float CombustionState = 0.f;
+		float FireHeight = 0.f;
+		bool bSmoldering = false;
+	};
+
+	struct FBucket
+	{
+		uint64 CellsMask = 0;
+		FBox Bounds = FBox(ForceInit);
+		TArray<FCell> Cells;
+	};
+
+	using FBucketRef = TSharedRef<const FBucket, ESPMode::ThreadSafe>;
+
+	const FCell* FindCell(const FIntVector2& CellKey) const;
+	FBox GetFlameColumn(const FIntVector2& CellKey, const FCell& Cell) const;
+	FFireQueryResult MakeResult(const FIntVector2& CellKey, const FCell& Cell, double Distance) const;
+	FIntVector2 GetCellKey(double X, double Y) const;
+	
+	// calls Visitor(CellKey, Cell) for cells whose key is within [MinKey, MaxKey]
+	template<typename TVisitor>
+	void ForEachCell(const FIntVector2& MinKey, const FIntVector2& MaxKey, TVisitor&& Visitor) const;
+
+	double CellSize = 1.0;
+	FBox Bounds = FBox(ForceInit);
+	TMap<FIntVector2, FBucketRef> Buckets;
+	// bucket that is being built, not shared with any other index yet
+	TSharedPtr<FBucket, ESPMode::ThreadSafe> BuildingBucket;
+};
+
+using FFireQueryIndexRef = TSharedRef<const FFireQueryIndex, ESPMode::ThreadSafe>;
+
+// Fire query indices of all fire sources of the world at some moment. Never modified once published, hold it as long as needed
+struct FIRESIMULATION_API FFireQuerySnapshot
+{
+	TArray<FFireQueryIndexRef> Indices;
+
+	bool IsEmpty() const { return Indices.IsEmpty(); }
+	bool QueryPoint(const FVector& Location, FFireQueryResult& OutResult) const;
+	void QueryRadius(const FVector& Center, float Radius, TArray<FFireQueryResult>& OutResults) const;
+	void QueryBox(const FBox& Box, TArray<FFireQueryResult>& OutResults) const;
+	bool FindNearest(const FVector& Location, float Radius, FFireQueryResult& OutResult) const;
+	bool QuerySegment(const FVector& Start, const FVector& End, FFireQueryResult& OutResult) const;
+};
+
+using FFireQuerySnapshotRef = TSharedRef<const FFireQuerySnapshot, ESPMode::ThreadSafe>;
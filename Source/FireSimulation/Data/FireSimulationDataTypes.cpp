@@ -1,23 +1,28 @@
 ﻿#include "FireSimulationDataTypes.h"
 
+#include "Components/CombustibleInstancesComponent.h"
 #include "Interfaces/Combustible.h"
 
-bool FFireCell::IsIgnited() const
+bool FFireCellCombustible::SetActor(AActor* InActor, float& InOutCombustionRate)
 {
-	if (!bHasCombustibleInterface)
-		return CombustionState.load() >= 1.f;
-
-	return CombustionState.load() >= 1.f && bCombustibleActorIgnited;
+	auto Combustible = Cast<ICombustible>(InActor);
+	if (!Combustible)
+		return false;
+	
+	Interface.SetObject(InActor);
+	Interface.SetInterface(Combustible);
+	Actor = InActor;
+	InOutCombustionRate *= Combustible->GetCombustionRate();
+	return true;
 }
 
-void FFireCell::SetActor(AActor* Actor)
+bool FFireCellCombustible::SetInstance(UCombustibleInstancesComponent* InInstances, int32 InInstanceIndex, float& InOutCombustionRate)
 {
-	if (auto Combustible = Cast<ICombustible>(Actor))
-	{
-		CombustibleInterface.SetObject(Actor);
-		CombustibleInterface.SetInterface(Combustible);
-		CombustibleActor = Actor;
-		CombustionRate *= Combustible->GetCombustionRate();
-		bHasCombustibleInterface = true;
-	}
+	if (!InInstances || InInstanceIndex == INDEX_NONE)
+		return false;
+	
+	Instances = InInstances;
+	InstanceIndex = InInstanceIndex;
+	InOutCombustionRate *= InInstances->GetInstanceCombustionRate(InInstanceIndex);
+	return true;
 }
@@ -1,8 +1,18 @@
 ﻿#pragma once
 
+#include "Simulation/FireSpreadTypes.h"
 #include "FireSimulationDataTypes.generated.h"
 
 class ICombustible;
+class UCombustibleInstancesComponent;
+
+// Block of distant cells that share one particle. Value is log2 of the block side, so a block is found by shifting cell keys
+UENUM(BlueprintType)
+enum class EFireParticleAggregation : uint8
+{
+	Block2x2 = 1 UMETA(DisplayName = "2x2"),
+	Block4x4 = 2 UMETA(DisplayName = "4x4"),
+};
 
 USTRUCT(BlueprintType)
 struct FPhysicMaterialCombustionParameters
@@ -22,118 +32,67 @@ struct FPhysicMaterialCombustionParameters
 	float BurnoutRate = 0.015f;
 };
 
-struct FFireCell
+// Cold data of cells that have a combustible actor. Kept by AFireSource, cells point to it with FFireCell::CombustibleIndex. Only game thread reads it
+struct FFireCellCombustible
 {
-    FFireCell()
-    {
-    	// CombustionState = 0.f;
-    	CombustionState.store(0.f);
-    };
-
-    FFireCell(const FFireCell& Other) : 
-          CombustionRate(Other.CombustionRate),
-          BurnoutRate(Other.BurnoutRate),
-          FireHeight(Other.FireHeight),
-          Location(Other.Location),
-          CombustibleActor(Other.CombustibleActor),
-          CombustibleInterface(Other.CombustibleInterface),
-          bObstacle(Other.bObstacle),
-          bHasCombustibleInterface(Other.bHasCombustibleInterface)
-    {
-    	// CombustionState = Other.CombustionState;
-    	CombustionState.store(Other.CombustionState.load());
-    }
-
-    FFireCell& operator=(const FFireCell& Other)
-    {
-        // CombustionState = Other.CombustionState;
-        CombustionState.store(Other.CombustionState.load());
-        CombustionRate = Other.CombustionRate;
-        BurnoutRate = Other.BurnoutRate;
-        FireHeight = Other.FireHeight;
-        Location = Other.Location;
-        CombustibleActor = Other.CombustibleActor;
-        CombustibleInterface = Other.CombustibleInterface;
-        bObstacle = Other.bObstacle;
-        bHasCombustibleInterface = Other.bHasCombustibleInterface;
-        return *this;
-    }
-
-    FFireCell(FFireCell&& Other) noexcept
-        :
-          CombustionRate(Other.CombustionRate),
-          BurnoutRate(Other.BurnoutRate),
-          FireHeight(Other.FireHeight),
-          Location(MoveTemp(Other.Location)),
-          CombustibleActor(MoveTemp(Other.CombustibleActor)),
-          CombustibleInterface(MoveTemp(Other.CombustibleInterface)),
-          bObstacle(Other.bObstacle),
-          bHasCombustibleInterface(Other.bHasCombustibleInterface)
-    {
-    	// CombustionState = Other.CombustionState;
-    	CombustionState.store(Other.CombustionState.load());
-        // Other.CombustionState.store(0.f);
-    }
-
-    FFireCell& operator=(FFireCell&& Other) noexcept
-    {
-        // CombustionState = Other.CombustionState;
-        CombustionState.store(Other.CombustionState.load());
-        CombustionRate = Other.CombustionRate;
-        BurnoutRate = Other.BurnoutRate;
-        FireHeight = Other.FireHeight;
-        Location = MoveTemp(Other.Location);
-        CombustibleActor = MoveTemp(Other.CombustibleActor);
-        CombustibleInterface = MoveTemp(Other.CombustibleInterface);
-        bObstacle = Other.bObstacle;
-        bHasCombustibleInterface = Other.bHasCombustibleInterface;
-
-        Other.CombustionState.store(0.f);
-        return *this;
-    }
-
-    ~FFireCell() = default;
-
-	// this one is local. in theory, there can be multiple AFireSource that affect the same cell. IDK. perhaps make a UFireSubsystem that has like global map of fire cells
-	// but then again - currently fire cells indices are relative to actor root
-	std::atomic<float> CombustionState;
-
-	// FCriticalSection CombustionLock;
-
-	float CombustionRate = 1.f;
-	float BurnoutRate = 0.005f;
-	float FireHeight = 100.f; // affects verticality
+	TWeakObjectPtr<AActor> Actor;
+	TScriptInterface<ICombustible> Interface;
+	// instanced props have no actor, they are updated in bulk right away instead of going through actor updates queue
+	TWeakObjectPtr<UCombustibleInstancesComponent> Instances;
+	int32 InstanceIndex = INDEX_NONE;
+
+	// return false if there's nothing combustible. Combustion rate of the cell is scaled by the combustible's own rate
+	bool SetActor(AActor* InActor, float& InOutCombustionRate);
+	bool SetInstance(UCombustibleInstancesComponent* InInstances, int32 InInstanceIndex, float& InOutCombustionRate);
+};
 
-	FVector Location = FVector::ZeroVector;
-	
-	TWeakObjectPtr<AActor> CombustibleActor;
-	TScriptInterface<ICombustible> CombustibleInterface;
+// Measured cost of a simulation stage, used to size batches so that each one takes about the same time
+struct FFireSimulationStageStats
+{
+	FFireSimulationStageStats() = default;
+	explicit FFireSimulationStageStats(double InitialMicrosecondsPerItem) : MicrosecondsPerItem(InitialMicrosecondsPerItem) {}
 	
-	bool bObstacle = false;
-	bool bHasCombustibleInterface = false; // used for async execution since calling .IsValid() or IsValid(Actor) is not safe outside of GT 
-	// since cell individual combustion state is not equal to actor combustion state (as it can get burnt by multiple cells)
-	// and since it's not threadsafe to access actors outside of GT, i'm using this bool which is written to in GT and read in other threads 
-    bool bCombustibleActorIgnited = false;
+	// moving average of worker time spent per item
+	double MicrosecondsPerItem = 1.0;
+
+	int32 GetBatchSize(float TargetBatchMicroseconds) const
+	{
+		return FMath::Clamp(FMath::RoundToInt32(TargetBatchMicroseconds / MicrosecondsPerItem), 1, 4096);
+	}
 	
+	void Update(int32 ItemsCount, int32 WorkersCount, double Seconds)
+	{
+		const double Sample = Seconds * 1000000.0 * WorkersCount / ItemsCount;
+		MicrosecondsPerItem = FMath::Max(0.01, FMath::Lerp(MicrosecondsPerItem, Sample, 0.2));
+	}
+};
 
-    bool IsObstacle() const { return bObstacle; }
-	bool IsIgnited() const;
-	// bool IsIgnited() const { return CombustionState >= 1.f; }
-	void SetActor(AActor* Actor);
+// Cost and size of one simulation step, for profiling tools. Stage times are wall time of the whole stage, including merging of worker results
+struct FFireSimulationStepReport
+{
+	double SpreadMs = 0.0;
+	double PruneEdgeCellsMs = 0.0;
+	double CreateNewCellsMs = 0.0;
+	double BurnoutMs = 0.0;
+	double ProcessResultMs = 0.0;
+	// only measured by AFireSource::StepSimulation, since on tick actors are updated before the step is launched
+	double UpdateBurningActorsMs = 0.0;
+	
+	int32 EdgeCells = 0;
+	int32 BurningCells = 0;
+	int32 IgnitedCells = 0;
+	int32 NewCells = 0;
+	int32 BurntOutCells = 0;
+	int32 PendingActorUpdates = 0;
 };
 
 struct FAsyncFireSpreadResult
 {
-	TMap<FIntVector2, float> CombustionActorUpdates;
-	TSet<FIntVector2> IgnitedCells;
-	TSet<FIntVector2> NotEdgeCellAnymore;
-	TMap<FIntVector2, FFireCell> NewCells;
-	
-	void Aggregate(FAsyncFireSpreadResult& Other)
-	{
-		CombustionActorUpdates.Append(MoveTemp(Other.CombustionActorUpdates));
-		IgnitedCells.Append(MoveTemp(Other.IgnitedCells));
-		NotEdgeCellAnymore.Append(MoveTemp(Other.NotEdgeCellAnymore));
-		NewCells.Append(MoveTemp(Other.NewCells)); // new cells are usually appended separately
-	}
+	TArray<TPair<FIntVector2, float>> CombustionActorUpdates;
+	TArray<FIntVector2> IgnitedCells;
+	TArray<FIntVector2> NotEdgeCellAnymore;
+	TArray<FIntVector2> StalledEdgeCells;
+	TArray<TPair<FIntVector2, FFireCell>> NewCells;
+	TArray<FIntVector2> BurntOutCells;
+	TArray<FIntVector2> SmolderingCells;
 };
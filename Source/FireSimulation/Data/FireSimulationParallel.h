@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+#include "Data/FireSimulationStats.h"
+
+namespace FireSimulation
+{
+	// Row-major order of cell keys. Used to give results a stable order that doesn't depend on how work was split between workers
+	struct FCellKeyLess
+	{
+		FORCEINLINE bool operator()(const FIntVector2& A, const FIntVector2& B) const
+		{
+			return A.Y != B.Y ? A.Y < B.Y : A.X < B.X;
+		}
+	};
+
+	// Concatenates per worker append-only arrays into one. Destination offsets are a prefix sum of worker array sizes,
+	// then every worker array is moved into its range in parallel
+	template<typename TWorkerResult, typename TElement>
+	void ConcatenateParallel(TArray<TWorkerResult>& WorkerResults, TArray<TElement> TWorkerResult::* Member, TArray<TElement>& OutArray)
+	{
+		FIRESIM_SCOPE(MergeResults);
+		TArray<int32, TInlineAllocator<64>> Offsets;
+		Offsets.SetNumUninitialized(WorkerResults.Num());
+		int32 TotalCount = 0;
+		for (int32 i = 0; i < WorkerResults.Num(); i++)
+		{
+			Offsets[i] = TotalCount;
+			TotalCount += (WorkerResults[i].*Member).Num();
+		}
+
+		const int32 BaseOffset = OutArray.Num();
+		if constexpr (std::is_trivially_copyable_v<TElement>)
+			OutArray.AddUninitialized(TotalCount);
+		else
+			OutArray.AddDefaulted(TotalCount);
+		
+		ParallelFor(WorkerResults.Num(), [&WorkerResults, &Offsets, &OutArray, Member, BaseOffset](int32 WorkerIndex)
+		{
+			TArray<TElement>& Source = WorkerResults[WorkerIndex].*Member;
+			TElement* Destination = OutArray.GetData() + BaseOffset + Offsets[WorkerIndex];
+			if constexpr (std::is_trivially_copyable_v<TElement>)
+			{
+				FMemory::Memcpy(Destination, Source.GetData(), Source.Num() * sizeof(TElement));
+			}
+			else
+			{
+				for (int32 i = 0; i < Source.Num(); i++)
+					Destination[i] = MoveTemp(Source[i]);
+			}
+			
+			Source.Reset();
+		});
+	}
+}
@@ -0,0 +1,39 @@
+﻿#include "FireSimulationStats.h"
+
+UE_TRACE_CHANNEL_DEFINE(FireSimChannel)
+
+DEFINE_STAT(STAT_FireSim_Tick);
+DEFINE_STAT(STAT_FireSim_Spread);
+DEFINE_STAT(STAT_FireSim_CollectCombustionTargets);
+DEFINE_STAT(STAT_FireSim_CommitCombustion);
+DEFINE_STAT(STAT_FireSim_PruneEdgeCells);
+DEFINE_STAT(STAT_FireSim_CreateNewCells);
+DEFINE_STAT(STAT_FireSim_Burnout);
+DEFINE_STAT(STAT_FireSim_StageWorker);
+DEFINE_STAT(STAT_FireSim_MergeResults);
+DEFINE_STAT(STAT_FireSim_ProcessFireSpreadResult);
+DEFINE_STAT(STAT_FireSim_UpdateBurningActors);
+DEFINE_STAT(STAT_FireSim_NiagaraUpload);
+DEFINE_STAT(STAT_FireSim_InstanceDataUpload);
+DEFINE_STAT(STAT_FireSim_Sweep);
+DEFINE_STAT(STAT_FireSim_BakeTerrain);
+DEFINE_STAT(STAT_FireSim_DecomposeBurningArea);
+DEFINE_STAT(STAT_FireSim_UpdateBurningAreaVolumes);
+DEFINE_STAT(STAT_FireSim_BuildFireQueryIndex);
+DEFINE_STAT(STAT_FireSim_UpdateSimulationLod);
+
+DEFINE_STAT(STAT_FireSim_Cells);
+DEFINE_STAT(STAT_FireSim_EdgeCells);
+DEFINE_STAT(STAT_FireSim_BurningCells);
+DEFINE_STAT(STAT_FireSim_SteppedEdgeCells);
+DEFINE_STAT(STAT_FireSim_SleepingEdgeCells);
+DEFINE_STAT(STAT_FireSim_PendingActorUpdates);
+DEFINE_STAT(STAT_FireSim_PerceptionStimuli);
+DEFINE_STAT(STAT_FireSim_IgnitionsPerStep);
+DEFINE_STAT(STAT_FireSim_NewCellsPerStep);
+DEFINE_STAT(STAT_FireSim_ActorUpdateLatency);
+DEFINE_STAT(STAT_FireSim_OldestPendingActorUpdate);
+
+DEFINE_STAT(STAT_FireSim_Sweeps);
+DEFINE_STAT(STAT_FireSim_ActorUpdatesApplied);
+DEFINE_STAT(STAT_FireSim_ReplicatedBytes);
@@ -0,0 +1,53 @@
+﻿#pragma once
+
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+
+// Insights channel of fire simulation scopes. Record it together with cpu channel: -trace=cpu,firesim
+UE_TRACE_CHANNEL_EXTERN(FireSimChannel, FIRESIMULATION_API)
+
+DECLARE_STATS_GROUP(TEXT("FireSim"), STATGROUP_FireSim, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tick"), STAT_FireSim_Tick, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Spread"), STAT_FireSim_Spread, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Collect combustion targets"), STAT_FireSim_CollectCombustionTargets, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Commit combustion"), STAT_FireSim_CommitCombustion, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Prune edge cells"), STAT_FireSim_PruneEdgeCells, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Create new cells"), STAT_FireSim_CreateNewCells, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Burnout"), STAT_FireSim_Burnout, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Stage worker"), STAT_FireSim_StageWorker, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Merge results"), STAT_FireSim_MergeResults, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Process spread result"), STAT_FireSim_ProcessFireSpreadResult, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update burning actors"), STAT_FireSim_UpdateBurningActors, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Niagara upload"), STAT_FireSim_NiagaraUpload, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Instance data upload"), STAT_FireSim_InstanceDataUpload, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Sweep"), STAT_FireSim_Sweep, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Bake terrain"), STAT_FireSim_BakeTerrain, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decompose burning area"), STAT_FireSim_DecomposeBurningArea, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update burning area volumes"), STAT_FireSim_UpdateBurningAreaVolumes, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build fire query index"), STAT_FireSim_BuildFireQueryIndex, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update simulation LOD"), STAT_FireSim_UpdateSimulationLod, STATGROUP_FireSim, FIRESIMULATION_API);
+
+// state, set every tick
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Cells"), STAT_FireSim_Cells, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Edge cells"), STAT_FireSim_EdgeCells, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Burning cells"), STAT_FireSim_BurningCells, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Edge cells stepped"), STAT_FireSim_SteppedEdgeCells, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Sleeping edge cells"), STAT_FireSim_SleepingEdgeCells, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Pending actor updates"), STAT_FireSim_PendingActorUpdates, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Perception stimuli"), STAT_FireSim_PerceptionStimuli, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Ignitions per step"), STAT_FireSim_IgnitionsPerStep, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("New cells per step"), STAT_FireSim_NewCellsPerStep, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Actor update latency (s)"), STAT_FireSim_ActorUpdateLatency, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Oldest pending actor update (s)"), STAT_FireSim_OldestPendingActorUpdate, STATGROUP_FireSim, FIRESIMULATION_API);
+
+// per frame
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Sweeps"), STAT_FireSim_Sweeps, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Actor updates applied"), STAT_FireSim_ActorUpdatesApplied, STATGROUP_FireSim, FIRESIMULATION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Replicated bytes (all connections)"), STAT_FireSim_ReplicatedBytes, STATGROUP_FireSim, FIRESIMULATION_API);
+
+// cycle stat for stat FireSim and cpu event on FireSim channel for Insights. Name is the suffix of STAT_FireSim_ stat
+#define FIRESIM_SCOPE(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_FireSim_##Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL_STR("FireSim." #Name, FireSimChannel)
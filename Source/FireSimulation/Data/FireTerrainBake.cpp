@@ -0,0 +1,47 @@
+﻿#include "FireTerrainBake.h"
+
+#include "Data/LogChannels.h"
+#include "Serialization/CustomVersion.h"
+
+const FGuid FFireTerrainBakeVersion::GUID(0x6508043C, 0xCED641BD, 0xB5656252, 0xD953333F);
+static FCustomVersionRegistration GRegisterFireTerrainBakeVersion(FFireTerrainBakeVersion::GUID, FFireTerrainBakeVersion::LatestVersion, TEXT("FireTerrainBakeVer"));
+
+FIntRect FFireTerrainBake::GetColumns(const FBox& WorldBox) const
+{
+	if (!IsValid())
+		return FIntRect();
+
+	const int32 MinX = FMath::Max(FMath::FloorToInt32((WorldBox.Min.X - Origin.X) / CellSize) - MinKey.X, 0);
+	const int32 MinY = FMath::Max(FMath::FloorToInt32((WorldBox.Min.Y - Origin.Y) / CellSize) - MinKey.Y, 0);
+	const int32 MaxX = FMath::Min(FMath::CeilToInt32((WorldBox.Max.X - Origin.X) / CellSize) - MinKey.X + 1, Size.X);
+	const int32 MaxY = FMath::Min(FMath::CeilToInt32((WorldBox.Max.Y - Origin.Y) / CellSize) - MinKey.Y + 1, Size.Y);
+	return MinX < MaxX && MinY < MaxY ? FIntRect(MinX, MinY, MaxX, MaxY) : FIntRect();
+}
+
+int32 FFireTerrainBake::Invalidate(const FBox& WorldBox)
+{
+	const FIntRect Columns = GetColumns(WorldBox);
+	for (int32 Y = Columns.Min.Y; Y < Columns.Max.Y; Y++)
+		for (int32 X = Columns.Min.X; X < Columns.Max.X; X++)
+			Cells[Y * Size.X + X].Flags |= EFireTerrainBakeFlags::Invalidated;
+
+	return Columns.Area();
+}
+
+FArchive& operator<<(FArchive& Ar, FFireTerrainBake& Bake)
+{
+	Ar.UsingCustomVersion(FFireTerrainBakeVersion::GUID);
+	Ar << Bake.Origin << Bake.CellSize << Bake.SweepHalfHeight;
+	Ar << Bake.MinKey.X << Bake.MinKey.Y << Bake.Size;
+	Ar << Bake.Cells << Bake.Surfaces;
+
+	// layout didn't change, so stale bake is read fully and then dropped
+	const int32 Version = Ar.CustomVer(FFireTerrainBakeVersion::GUID);
+	if (Ar.IsLoading() && Version < FFireTerrainBakeVersion::MinimumValidVersion)
+	{
+		UE_LOG(LogFireSimulation, Warning, TEXT("Fire terrain bake %s has outdated version %d, it has to be rebaked"), *Ar.GetArchiveName(), Version);
+		Bake.Reset();
+	}
+	
+	return Ar;
+}
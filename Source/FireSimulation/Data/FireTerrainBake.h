@@ -0,0 +1,120 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Chaos/ChaosEngineInterface.h"
+#include "Data/FireSimulationDataTypes.h"
+
+enum class EFireTerrainBakeFlags : uint8
+{
+	None = 0,
+	// something was hit in this column
+	Hit = 1 << 0,
+	// hit surface is incombustible or has no physical material
+	Obstacle = 1 << 1,
+	// combustible or movable actor was hit, it can move or die so the cell must be swept at runtime
+	RequiresSweep = 1 << 2,
+	// something entered or left the fire volume in this column after the bake
+	Invalidated = 1 << 3,
+};
+ENUM_CLASS_FLAGS(EFireTerrainBakeFlags)
+
+// Changes of bake layout and keying. Bakes saved before MinimumValidVersion are dropped on load, so they are rebaked instead of burning in wrong cells
+struct FFireTerrainBakeVersion
+{
+	enum Type
+	{
+		BeforeCustomVersionWasAdded = 0,
+		// keys are on the world-aligned grid shared by all fire sources instead of relative to the fire source
+		WorldAlignedKeys,
+
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+
+	static constexpr Type MinimumValidVersion = WorldAlignedKeys;
+	FIRESIMULATION_API static const FGuid GUID;
+};
+
+struct FFireTerrainBakeCell
+{
+	float SurfaceZ = 0.f;
+	uint8 SurfaceType = SurfaceType_Default;
+	EFireTerrainBakeFlags Flags = EFireTerrainBakeFlags::None;
+
+	friend FArchive& operator<<(FArchive& Ar, FFireTerrainBakeCell& Cell)
+	{
+		uint8 Flags = static_cast<uint8>(Cell.Flags);
+		Ar << Cell.SurfaceZ << Cell.SurfaceType << Flags;
+		Cell.Flags = static_cast<EFireTerrainBakeFlags>(Flags);
+		return Ar;
+	}
+};
+
+// surface combustion parameters resolved from UFireSimulationSettings at bake time
+struct FFireTerrainBakeSurface
+{
+	FPhysicMaterialCombustionParameters Parameters;
+	bool bHasParameters = false;
+	bool bIncombustible = false;
+
+	friend FArchive& operator<<(FArchive& Ar, FFireTerrainBakeSurface& Surface)
+	{
+		Ar << Surface.Parameters.IgnitionRate << Surface.Parameters.BurningStrength << Surface.Parameters.BurnoutRate;
+		Ar << Surface.bHasParameters << Surface.bIncombustible;
+		return Ar;
+	}
+};
+
+// Heightfield of the fire volume with one entry per fire cell column, keyed the same way as fire cells (world-aligned grid).
+// Stores the topmost combustible-channel surface of every column, so cell creation doesn't have to sweep the physics scene.
+// 6 bytes per column on disk, 8 in memory
+struct FFireTerrainBake
+{
+	FVector Origin = FVector::ZeroVector;
+	double CellSize = 0.0;
+	// sweep box half height used for the bake, it must match runtime sweeps for the data to be valid
+	double SweepHalfHeight = 0.0;
+	FIntVector2 MinKey = FIntVector2(0, 0);
+	FIntPoint Size = FIntPoint::ZeroValue;
+
+	TArray<FFireTerrainBakeCell> Cells;
+	TArray<FFireTerrainBakeSurface> Surfaces;
+
+	bool IsValid() const { return Size.X > 0 && Size.Y > 0 && Cells.Num() == static_cast<int64>(Size.X) * Size.Y && Surfaces.Num() == SurfaceType_Max; }
+	bool IsCompatible(const FVector& InOrigin, double InCellSize, double InSweepHalfHeight) const
+	{
+		return IsValid() && Origin.Equals(InOrigin, 1.0) && FMath::IsNearlyEqual(CellSize, InCellSize) && FMath::IsNearlyEqual(SweepHalfHeight, InSweepHalfHeight);
+	}
+
+	void Reset()
+	{
+		Cells.Empty();
+		Surfaces.Empty();
+		Size = FIntPoint::ZeroValue;
+	}
+
+	FORCEINLINE int32 GetIndex(const FIntVector2& Key) const
+	{
+		const int32 X = Key.X - MinKey.X;
+		const int32 Y = Key.Y - MinKey.Y;
+		return X >= 0 && Y >= 0 && X < Size.X && Y < Size.Y ? Y * Size.X + X : INDEX_NONE;
+	}
+
+	FORCEINLINE const FFireTerrainBakeCell* Find(const FIntVector2& Key) const
+	{
+		const int32 Index = GetIndex(Key);
+		return Index != INDEX_NONE ? &Cells[Index] : nullptr;
+	}
+
+	FORCEINLINE FVector GetCellLocation(const FIntVector2& Key, float SurfaceZ) const
+	{
+		return FVector(Origin.X + Key.X * CellSize, Origin.Y + Key.Y * CellSize, SurfaceZ);
+	}
+
+	// columns that intersect world space box, clamped to the bake. Max is exclusive, empty if the box misses the bake
+	FIntRect GetColumns(const FBox& WorldBox) const;
+	// marks all columns that intersect world space box as requiring a runtime sweep. Returns amount of invalidated columns
+	int32 Invalidate(const FBox& WorldBox);
+
+	friend FArchive& operator<<(FArchive& Ar, FFireTerrainBake& Bake);
+};
@@ -0,0 +1,10 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FireTerrainBakeData.h"
+
+void UFireTerrainBakeData::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+	Ar << Bake;
+}
@@ -0,0 +1,22 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Data/FireTerrainBake.h"
+#include "Engine/DataAsset.h"
+#include "FireTerrainBakeData.generated.h"
+
+/**
+ * Offline terrain bake for AFireSource. Baked in editor by AFireSource::BakeTerrainToAsset, stored as compact binary blob
+ */
+UCLASS()
+class FIRESIMULATION_API UFireTerrainBakeData : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Serialize(FArchive& Ar) override;
+
+	FFireTerrainBake Bake;
+};
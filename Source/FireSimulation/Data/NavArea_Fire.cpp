@@ -0,0 +1,8 @@
+﻿#include "NavArea_Fire.h"
+
+UNavArea_Fire::UNavArea_Fire(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	DefaultCost = 100.f;
+	FixedAreaEnteringCost = 1000.f;
+	DrawColor = FColor(255, 96, 0);
+}
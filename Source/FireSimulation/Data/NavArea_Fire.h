@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "NavAreas/NavArea.h"
+#include "NavArea_Fire.generated.h"
+
+/**
+ * Burning ground. Pathfinding avoids it unless there's no other way, AFireSource covers burning cells with volumes of this area
+ */
+UCLASS()
+class FIRESIMULATION_API UNavArea_Fire : public UNavArea
+{
+	GENERATED_BODY()
+
+public:
+	UNavArea_Fire(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+};
@@ -0,0 +1,60 @@
+﻿#include "WindFieldDescription.h"
+
+void FWindFieldDescription::Initialize(const FVector2D& NewOrigin, float NewNodeSpacing, const FIntPoint& NewSize)
+{
+	Origin = NewOrigin;
+	NodeSpacing = FMath::Max(NewNodeSpacing, 100.f);
+	Size = FIntPoint(FMath::Max(NewSize.X, 0), FMath::Max(NewSize.Y, 0));
+	YawOffsets.Init(0, Size.X * Size.Y);
+	StrengthScales.Init(static_cast<uint8>(StrengthScaleOne), Size.X * Size.Y);
+}
+
+void FWindFieldDescription::SetNode(int32 X, int32 Y, float YawOffsetDegrees, float StrengthScale)
+{
+	if (!ensure(X >= 0 && X < Size.X && Y >= 0 && Y < Size.Y && HasNodes()))
+		return;
+
+	const int32 Index = Y * Size.X + X;
+	YawOffsets[Index] = static_cast<int8>(FMath::RoundToInt32(FRotator::NormalizeAxis(YawOffsetDegrees) / 360.f * 256.f) & 0xFF);
+	StrengthScales[Index] = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt32(StrengthScale * StrengthScaleOne), 0, MAX_uint8));
+}
+
+void FWindFieldDescription::Evaluate(const FVector& WindDirection, float WindStrength, double Time, FFireWindField& OutField) const
+{
+	// fire spreads over the ground, vertical wind doesn't matter
+	const FVector2D GustDirection = FVector2D(WindDirection).GetSafeNormal();
+	const FVector2f Prevailing = FVector2f(GustDirection * WindStrength);
+	const double GustPhase = Time / GustPeriod;
+	auto GetGustScale = [this, &GustDirection, GustPhase](const FVector2D& Location)
+	{
+		const double Phase = GustPhase - (Location | GustDirection) / GustWavelength;
+		return FMath::Max(0.f, 1.f + GustAmplitude * FMath::Sin(static_cast<float>(UE_TWO_PI * FMath::Frac(Phase))));
+	};
+	
+	if (!HasNodes())
+	{
+		OutField.Nodes.Reset();
+		OutField.Uniform = HasGusts() ? Prevailing * GetGustScale(FVector2D::ZeroVector) : Prevailing;
+		return;
+	}
+
+	OutField.Origin = Origin;
+	OutField.InvNodeSpacing = 1.0 / NodeSpacing;
+	OutField.SizeX = Size.X;
+	OutField.SizeY = Size.Y;
+	OutField.Nodes.SetNumUninitialized(Size.X * Size.Y);
+	for (int32 Y = 0; Y < Size.Y; Y++)
+	{
+		for (int32 X = 0; X < Size.X; X++)
+		{
+			const int32 Index = Y * Size.X + X;
+			float Scale = StrengthScales[Index] / StrengthScaleOne;
+			if (HasGusts())
+				Scale *= GetGustScale(Origin + FVector2D(X, Y) * NodeSpacing);
+
+			float Sin, Cos;
+			FMath::SinCos(&Sin, &Cos, YawOffsets[Index] * (UE_TWO_PI / 256.f));
+			OutField.Nodes[Index] = FVector2f(Prevailing.X * Cos - Prevailing.Y * Sin, Prevailing.X * Sin + Prevailing.Y * Cos) * Scale;
+		}
+	}
+}
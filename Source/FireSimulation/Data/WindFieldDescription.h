@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Data/FireWindField.h"
+#include "WindFieldDescription.generated.h"
+
+/**
+ * Local variation of the prevailing wind of UWindComponent: coarse grid over the level where every node turns and scales the prevailing wind,
+ * i.e. to make it follow a valley or die down behind buildings. Optional gusts travel downwind as waves of strength.
+ * Nodes are quantized to 2 bytes, so the whole grid replicates compactly
+ */
+USTRUCT(BlueprintType)
+struct FIRESIMULATION_API FWindFieldDescription
+{
+	GENERATED_BODY()
+
+	static constexpr float StrengthScaleOne = 64.f;
+	
+	// world XY of node (0, 0)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FVector2D Origin = FVector2D::ZeroVector;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(UIMin = 500.f, ClampMin = 100.f))
+	float NodeSpacing = 2000.f;
+
+	// nodes along X and Y. Field is only used if both are at least 2, otherwise wind is the same everywhere
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FIntPoint Size = FIntPoint::ZeroValue;
+
+	// row-major. Yaw offset from prevailing wind, 256 steps per full turn
+	UPROPERTY(EditAnywhere)
+	TArray<int8> YawOffsets;
+
+	// row-major. Strength scale of prevailing wind, StrengthScaleOne is 1x
+	UPROPERTY(EditAnywhere)
+	TArray<uint8> StrengthScales;
+
+	// relative strength change at the peak of a gust. 0 - no gusts
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(UIMin = 0.f, ClampMin = 0.f, UIMax = 1.f))
+	float GustAmplitude = 0.f;
+
+	// seconds between gusts at any point
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(UIMin = 0.5f, ClampMin = 0.1f))
+	float GustPeriod = 8.f;
+
+	// distance between gust fronts
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(UIMin = 500.f, ClampMin = 100.f))
+	float GustWavelength = 6000.f;
+
+	bool HasNodes() const { return Size.X >= 2 && Size.Y >= 2 && YawOffsets.Num() == Size.X * Size.Y && StrengthScales.Num() == Size.X * Size.Y; }
+	bool HasGusts() const { return GustAmplitude > 0.f; }
+
+	// resets the grid to nodes that don't change prevailing wind
+	void Initialize(const FVector2D& NewOrigin, float NewNodeSpacing, const FIntPoint& NewSize);
+	void SetNode(int32 X, int32 Y, float YawOffsetDegrees, float StrengthScale);
+	
+	void Evaluate(const FVector& WindDirection, float WindStrength, double Time, FFireWindField& OutField) const;
+};
@@ -15,10 +15,11 @@ public class FireSimulation : ModuleRules
 			"InputCore",
 			"EnhancedInput",
 			"AIModule",
-			"UMG"
+			"UMG",
+			"FireSimulationCore"
 		});
 
-		PrivateDependencyModuleNames.AddRange(new string[] { "Niagara", "DeveloperSettings", "PhysicsCore", "NetCore"});
+		PrivateDependencyModuleNames.AddRange(new string[] { "Niagara", "DeveloperSettings", "PhysicsCore", "NetCore", "Json", "NavigationSystem"});
 
 		PublicIncludePaths.AddRange(new string[] {
 			"FireSimulation",
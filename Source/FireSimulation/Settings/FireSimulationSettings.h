@@ -7,6 +7,8 @@
 #include "Engine/DeveloperSettings.h"
 #include "FireSimulationSettings.generated.h"
 
+class UPhysicalMaterial;
+
 /**
  * 
  */
@@ -21,4 +23,20 @@ public:
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Config)
 	TArray<TEnumAsByte<EPhysicalSurface>> IncombustibleSurfaces;
+
+	// combustible props are replicated in bulk per square region of this size (cm)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Config, Category = "Replication", meta=(UIMin = 1000.f, ClampMin = 100.f))
+	float CombustibleReplicationRegionSize = 10000.f;
+
+	// region of combustible props is relevant to players closer than this to its bounds
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Config, Category = "Replication", meta=(UIMin = 1000.f, ClampMin = 0.f))
+	float CombustibleReplicationCullDistance = 15000.f;
+
+	// actors that FireSim.Benchmark scatters over synthetic terrain. Must block combustible collision channel to be picked up by fire cells
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Config, Category = "Benchmark")
+	TSoftClassPtr<AActor> BenchmarkCombustibleActorClass;
+
+	// surface of synthetic terrain that FireSim.Benchmark spawns
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Config, Category = "Benchmark")
+	TSoftObjectPtr<UPhysicalMaterial> BenchmarkTerrainPhysicalMaterial;
 };
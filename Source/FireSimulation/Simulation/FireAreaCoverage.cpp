@@ -0,0 +1,99 @@
+﻿#include "FireAreaCoverage.h"
+
+bool FFireAreaCoverage::FRegion::IsEmpty() const
+{
+	for (const uint32 Row : Rows)
+		if (Row != 0)
+			return false;
+	
+	return true;
+}
+
+void FFireAreaCoverage::AddBurningCell(const FIntVector2& CellKey, float Bottom, float Top)
+{
+	const FIntVector2 RegionCoord(CellKey.X >> RegionSizeLog2, CellKey.Y >> RegionSizeLog2);
+	TUniquePtr<FRegion>& Region = Regions.FindOrAdd(RegionCoord);
+	if (!Region)
+	{
+		Region = MakeUnique<FRegion>();
+		Region->Coord = RegionCoord;
+	}
+
+	const int32 LocalX = CellKey.X & RegionMask;
+	const int32 LocalY = CellKey.Y & RegionMask;
+	Region->Rows[LocalY] |= 1u << LocalX;
+	Region->Bottom[(LocalY << RegionSizeLog2) | LocalX] = Bottom;
+	Region->Top[(LocalY << RegionSizeLog2) | LocalX] = Top;
+	DirtyRegions.Add(RegionCoord);
+}
+
+void FFireAreaCoverage::RemoveBurningCell(const FIntVector2& CellKey)
+{
+	const FIntVector2 RegionCoord(CellKey.X >> RegionSizeLog2, CellKey.Y >> RegionSizeLog2);
+	if (TUniquePtr<FRegion>* Region = Regions.Find(RegionCoord))
+	{
+		(*Region)->Rows[CellKey.Y & RegionMask] &= ~(1u << (CellKey.X & RegionMask));
+		DirtyRegions.Add(RegionCoord);
+	}
+}
+
+TArray<FFireAreaCoverage::FRegion> FFireAreaCoverage::ExtractDirtyRegions()
+{
+	TArray<FRegion> DirtyRegionsCopy;
+	DirtyRegionsCopy.Reserve(DirtyRegions.Num());
+	for (const FIntVector2& RegionCoord : DirtyRegions)
+	{
+		const TUniquePtr<FRegion>* Region = Regions.Find(RegionCoord);
+		if (!Region)
+			continue;
+		
+		DirtyRegionsCopy.Add(**Region);
+		if ((*Region)->IsEmpty())
+			Regions.Remove(RegionCoord);
+	}
+
+	DirtyRegions.Reset();
+	return DirtyRegionsCopy;
+}
+
+void FFireAreaCoverage::Decompose(const FRegion& Region, FRegionBoxes& OutBoxes) const
+{
+	OutBoxes.Coord = Region.Coord;
+	OutBoxes.Boxes.Reset();
+	
+	uint32 Rows[RegionSize];
+	FMemory::Memcpy(Rows, Region.Rows, sizeof(Rows));
+	const int32 RegionX = Region.Coord.X << RegionSizeLog2;
+	const int32 RegionY = Region.Coord.Y << RegionSizeLog2;
+	for (int32 StartY = 0; StartY < RegionSize; StartY++)
+	{
+		while (Rows[StartY] != 0)
+		{
+			// run of burning cells along the row. Bits above the run are zeroes after the shift, so the run ends at the first zero
+			const int32 StartX = FMath::CountTrailingZeros(Rows[StartY]);
+			const uint32 ShiftedRow = Rows[StartY] >> StartX;
+			const int32 Length = ShiftedRow == MAX_uint32 ? RegionSize : FMath::CountTrailingZeros(~ShiftedRow);
+			const uint32 RunMask = (Length == RegionSize ? MAX_uint32 : (1u << Length) - 1) << StartX;
+			
+			int32 EndY = StartY;
+			while (EndY + 1 < RegionSize && (Rows[EndY + 1] & RunMask) == RunMask)
+				EndY++;
+
+			float Bottom = MAX_flt;
+			float Top = -MAX_flt;
+			for (int32 Y = StartY; Y <= EndY; Y++)
+			{
+				Rows[Y] &= ~RunMask;
+				for (int32 X = StartX; X < StartX + Length; X++)
+				{
+					Bottom = FMath::Min(Bottom, Region.Bottom[(Y << RegionSizeLog2) | X]);
+					Top = FMath::Max(Top, Region.Top[(Y << RegionSizeLog2) | X]);
+				}
+			}
+
+			// cell keys are cell centers
+			OutBoxes.Boxes.Emplace(FVector((RegionX + StartX - 0.5) * CellSize, (RegionY + StartY - 0.5) * CellSize, Bottom),
+				FVector((RegionX + StartX + Length - 0.5) * CellSize, (RegionY + EndY + 0.5) * CellSize, Top));
+		}
+	}
+}
@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Data/FireCellGrid.h"
+
+/**
+ * Burning area as a small set of axis-aligned boxes, for nav modifiers and damage volumes.
+ * Burning cells are kept as bit rows of 32x32 regions (the tiles of FFireCellGrid). Only regions where cells ignited or burnt out
+ * since the last update are decomposed again: the first burning cell of a region starts a run along its row, the run grows down
+ * while rows below burn under all of it, and its cells are taken out. Decomposition works on copies of regions, so it runs on workers
+ * while game thread keeps updating the coverage
+ */
+class FIRESIMULATION_API FFireAreaCoverage
+{
+public:
+	static constexpr int32 RegionSizeLog2 = FFireCellGrid::TileSizeLog2;
+	static constexpr int32 RegionSize = 1 << RegionSizeLog2;
+	static constexpr int32 RegionMask = RegionSize - 1;
+
+	struct FRegion
+	{
+		FIntVector2 Coord = FIntVector2::ZeroValue;
+		// bit per burning cell
+		uint32 Rows[RegionSize] = {};
+		// vertical extent of flames of every cell, row-major
+		float Bottom[RegionSize * RegionSize];
+		float Top[RegionSize * RegionSize];
+
+		bool IsEmpty() const;
+	};
+
+	struct FRegionBoxes
+	{
+		FIntVector2 Coord = FIntVector2::ZeroValue;
+		// empty if nothing burns in the region anymore
+		TArray<FBox> Boxes;
+	};
+
+	explicit FFireAreaCoverage(double InCellSize = 25.0) : CellSize(InCellSize) {}
+	
+	void SetCellSize(double NewCellSize) { CellSize = NewCellSize; }
+	double GetCellSize() const { return CellSize; }
+
+	void AddBurningCell(const FIntVector2& CellKey, float Bottom, float Top);
+	void RemoveBurningCell(const FIntVector2& CellKey);
+
+	bool HasDirtyRegions() const { return !DirtyRegions.IsEmpty(); }
+	// copies of regions changed since the last call. Regions without burning cells are forgotten after being copied
+	TArray<FRegion> ExtractDirtyRegions();
+
+	// thread safe
+	void Decompose(const FRegion& Region, FRegionBoxes& OutBoxes) const;
+	
+	SIZE_T GetAllocatedSize() const { return Regions.GetAllocatedSize() + Regions.Num() * sizeof(FRegion) + DirtyRegions.GetAllocatedSize(); }
+
+private:
+	double CellSize = 25.0;
+	TMap<FIntVector2, TUniquePtr<FRegion>> Regions;
+	TSet<FIntVector2> DirtyRegions;
+};
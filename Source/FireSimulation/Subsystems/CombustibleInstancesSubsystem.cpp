@@ -0,0 +1,83 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombustibleInstancesSubsystem.h"
+
+#include "Components/CombustibleInstancesComponent.h"
+#include "Data/FireSimulationStats.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+
+UCombustibleInstancesComponent* UCombustibleInstancesSubsystem::AddInstance(const UStaticMeshComponent* SourceMesh, UMaterialInterface* Material,
+	float MaxCombustionLevel, float CombustionRate, uint32 ReplicationId, int32& OutInstanceIndex)
+{
+	OutInstanceIndex = INDEX_NONE;
+	if (!ensure(SourceMesh && SourceMesh->GetStaticMesh()))
+		return nullptr;
+
+	UCombustibleInstancesComponent* Component = FindOrAddComponent(SourceMesh, Material);
+	if (!Component)
+		return nullptr;
+	
+	OutInstanceIndex = Component->AddCombustibleInstance(SourceMesh->GetComponentTransform(), MaxCombustionLevel, CombustionRate, ReplicationId);
+	return OutInstanceIndex != INDEX_NONE ? Component : nullptr;
+}
+
+void UCombustibleInstancesSubsystem::Tick(float DeltaTime)
+{
+	FIRESIM_SCOPE(InstanceDataUpload);
+	for (UCombustibleInstancesComponent* Component : Components)
+		if (IsValid(Component))
+			Component->FlushCombustionData();
+}
+
+TStatId UCombustibleInstancesSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombustibleInstancesSubsystem, STATGROUP_Tickables);
+}
+
+bool UCombustibleInstancesSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+UCombustibleInstancesComponent* UCombustibleInstancesSubsystem::FindOrAddComponent(const UStaticMeshComponent* SourceMesh, UMaterialInterface* Material)
+{
+	UStaticMesh* StaticMesh = SourceMesh->GetStaticMesh();
+	if (!Material)
+		Material = SourceMesh->GetMaterial(0);
+	
+	for (UCombustibleInstancesComponent* Component : Components)
+	{
+		if (IsValid(Component) && Component->GetStaticMesh() == StaticMesh && Component->GetMaterial(0) == Material)
+			return Component;
+	}
+
+	if (!InstancesActor)
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.Name = TEXT("CombustibleInstances");
+		SpawnParameters.NameMode = FActorSpawnParameters::ESpawnActorNameMode::Requested;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+		InstancesActor = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+		if (!ensure(InstancesActor))
+			return nullptr;
+
+		// every machine builds its own instances from the props it has, nothing to replicate here
+		InstancesActor->SetReplicates(false);
+	}
+
+	UCombustibleInstancesComponent* Component = NewObject<UCombustibleInstancesComponent>(InstancesActor);
+	Component->SetStaticMesh(StaticMesh);
+	Component->SetMaterial(0, Material);
+	Component->SetCollisionProfileName(SourceMesh->GetCollisionProfileName());
+	Component->SetCollisionResponseToChannels(SourceMesh->GetCollisionResponseToChannels());
+	Component->SetCollisionEnabled(SourceMesh->GetCollisionEnabled());
+	Component->SetCastShadow(SourceMesh->CastShadow);
+	if (!InstancesActor->GetRootComponent())
+		InstancesActor->SetRootComponent(Component);
+	
+	Component->RegisterComponent();
+	InstancesActor->AddInstanceComponent(Component);
+	Components.Add(Component);
+	return Component;
+}
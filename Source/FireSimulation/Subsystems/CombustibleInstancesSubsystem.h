@@ -0,0 +1,45 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombustibleInstancesSubsystem.generated.h"
+
+class UCombustibleInstancesComponent;
+class UMaterialInterface;
+class UStaticMesh;
+class UStaticMeshComponent;
+
+/**
+ * Shared manager of instanced combustible props. Props with the same mesh and material go to one UCombustibleInstancesComponent,
+ * so thousands of scattered props are a few draw calls instead of a draw call and a dynamic material instance each.
+ * Combustion changes of all instances are uploaded to the renderer once per frame
+ */
+UCLASS()
+class FIRESIMULATION_API UCombustibleInstancesSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Adds an instance that looks and collides like SourceMesh. Material overrides the first material slot if set.
+	// ReplicationId - UCombustibleReplicationSubsystem id that instance combustion is replicated with, 0 if it isn't replicated
+	UCombustibleInstancesComponent* AddInstance(const UStaticMeshComponent* SourceMesh, UMaterialInterface* Material, float MaxCombustionLevel,
+		float CombustionRate, uint32 ReplicationId, int32& OutInstanceIndex);
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	UCombustibleInstancesComponent* FindOrAddComponent(const UStaticMeshComponent* SourceMesh, UMaterialInterface* Material);
+
+	UPROPERTY()
+	AActor* InstancesActor;
+
+	// one per mesh and material. There are few of them, so they are just searched linearly
+	UPROPERTY()
+	TArray<UCombustibleInstancesComponent*> Components;
+};
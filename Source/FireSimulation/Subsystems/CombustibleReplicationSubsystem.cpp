@@ -0,0 +1,87 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombustibleReplicationSubsystem.h"
+
+#include "Actors/CombustibleActor.h"
+#include "Actors/CombustibleStateReplicator.h"
+#include "Data/LogChannels.h"
+#include "Engine/World.h"
+#include "Settings/FireSimulationSettings.h"
+
+uint32 UCombustibleReplicationSubsystem::MakeStableId(const AActor* Actor)
+{
+	if (!Actor || !Actor->IsNetStartupActor() || !Actor->GetLevel())
+		return 0;
+
+	// object names are the same on all machines for actors loaded with the level. Package names differ only in PIE prefix
+	const FString LevelPackageName = UWorld::RemovePIEPrefix(Actor->GetLevel()->GetPackage()->GetName());
+	const uint32 Id = FCrc::StrCrc32(*Actor->GetName(), FCrc::StrCrc32(*LevelPackageName));
+	return Id != 0 ? Id : 1;
+}
+
+bool UCombustibleReplicationSubsystem::RegisterCombustible(uint32 Id, ACombustibleActor* Actor)
+{
+	if (Id == 0)
+		return false;
+
+	TWeakObjectPtr<ACombustibleActor>& Combustible = Combustibles.FindOrAdd(Id);
+	if (Combustible.IsValid() && Combustible.Get() != Actor)
+	{
+		UE_LOG(LogFireSimulation, Warning, TEXT("Combustible %s has the same replication id as %s, it will replicate itself"), *Actor->GetName(), *Combustible->GetName());
+		return false;
+	}
+
+	Combustible = Actor;
+	uint8 PendingLevel = 0;
+	if (PendingLevels.RemoveAndCopyValue(Id, PendingLevel))
+		Actor->ApplyReplicatedCombustion(FCombustibleStateItem::Dequantize(PendingLevel));
+	
+	return true;
+}
+
+void UCombustibleReplicationSubsystem::UnregisterCombustible(uint32 Id)
+{
+	Combustibles.Remove(Id);
+}
+
+void UCombustibleReplicationSubsystem::SetCombustion(uint32 Id, const FVector& Location, float NormalizedCombustion)
+{
+	if (ACombustibleStateReplicator* Replicator = FindOrAddReplicator(Location))
+		Replicator->SetCombustionLevel(Id, FCombustibleStateItem::Quantize(NormalizedCombustion));
+}
+
+void UCombustibleReplicationSubsystem::ApplyCombustionLevel(uint32 Id, uint8 Level)
+{
+	const TWeakObjectPtr<ACombustibleActor>* Combustible = Combustibles.Find(Id);
+	if (Combustible && Combustible->IsValid())
+		(*Combustible)->ApplyReplicatedCombustion(FCombustibleStateItem::Dequantize(Level));
+	else
+		PendingLevels.Add(Id, Level);
+}
+
+bool UCombustibleReplicationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+ACombustibleStateReplicator* UCombustibleReplicationSubsystem::FindOrAddReplicator(const FVector& Location)
+{
+	const UFireSimulationSettings* FireSimSettings = GetDefault<UFireSimulationSettings>();
+	const double RegionSize = FMath::Max(FireSimSettings->CombustibleReplicationRegionSize, 100.f);
+	const FIntVector2 Region(FMath::FloorToInt32(Location.X / RegionSize), FMath::FloorToInt32(Location.Y / RegionSize));
+	TWeakObjectPtr<ACombustibleStateReplicator>& Replicator = Replicators.FindOrAdd(Region);
+	if (Replicator.IsValid())
+		return Replicator.Get();
+
+	const FVector RegionCenter((Region.X + 0.5) * RegionSize, (Region.Y + 0.5) * RegionSize, Location.Z);
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	Replicator = GetWorld()->SpawnActor<ACombustibleStateReplicator>(RegionCenter, FRotator::ZeroRotator, SpawnParameters);
+	if (!ensure(Replicator.IsValid()))
+		return nullptr;
+	
+	// relevant when a viewer is within cull distance of any corner of the region, not just of its center
+	const double CullDistance = FireSimSettings->CombustibleReplicationCullDistance + RegionSize * UE_HALF_SQRT_2;
+	Replicator->SetNetCullDistanceSquared(CullDistance * CullDistance);
+	return Replicator.Get();
+}
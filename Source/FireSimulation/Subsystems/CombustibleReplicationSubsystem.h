@@ -0,0 +1,47 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombustibleReplicationSubsystem.generated.h"
+
+class ACombustibleActor;
+class ACombustibleStateReplicator;
+
+/**
+ * Replicates combustion of combustible props in bulk. World is split into square regions, each region that has burning props gets
+ * an ACombustibleStateReplicator that sends quantized combustion of its props keyed by stable ids.
+ * This way net driver considers a replicator per burning region instead of every prop, and the props don't need to replicate at all
+ */
+UCLASS()
+class FIRESIMULATION_API UCombustibleReplicationSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Id of the actor that is the same on server and all clients, 0 if there isn't one. Only actors loaded with the level have it
+	static uint32 MakeStableId(const AActor* Actor);
+
+	// Server and clients. Returns false if the id is taken, in which case the actor should replicate itself
+	bool RegisterCombustible(uint32 Id, ACombustibleActor* Actor);
+	void UnregisterCombustible(uint32 Id);
+
+	// server
+	void SetCombustion(uint32 Id, const FVector& Location, float NormalizedCombustion);
+
+	// client
+	void ApplyCombustionLevel(uint32 Id, uint8 Level);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	ACombustibleStateReplicator* FindOrAddReplicator(const FVector& Location);
+	
+	TMap<uint32, TWeakObjectPtr<ACombustibleActor>> Combustibles;
+	// client only, levels received before the prop got loaded
+	TMap<uint32, uint8> PendingLevels;
+	// server only, region coord -> replicator
+	TMap<FIntVector2, TWeakObjectPtr<ACombustibleStateReplicator>> Replicators;
+};
@@ -0,0 +1,426 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FireSimulationBenchmarkSubsystem.h"
+
+#include "Actors/FireSource.h"
+#include "Components/BoxComponent.h"
+#include "Data/LogChannels.h"
+#include "Dom/JsonObject.h"
+#include "GameFramework/GameStateBase.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "Serialization/BitWriter.h"
+#include "Serialization/JsonSerializer.h"
+#include "Settings/FireSimulationSettings.h"
+
+static FAutoConsoleCommandWithWorldAndArgs CmdFireSimBenchmark(
+	TEXT("FireSim.Benchmark"),
+	TEXT("Runs fire simulation benchmark on synthetic terrain and writes results to Saved/Profiling/FireSim. ")
+	TEXT("Args: Name= Size= Patch= Noise= Actors= Ignitions= Steps= Seed= Workers= Cell= Dt= Quit"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (auto Benchmark = World ? World->GetSubsystem<UFireSimulationBenchmarkSubsystem>() : nullptr)
+			Benchmark->StartBenchmark(FFireSimulationBenchmarkParams::FromArgs(Args));
+		else
+			UE_LOG(LogFireSimulation, Error, TEXT("FireSim.Benchmark can only run in game world"));
+	}));
+
+FFireSimulationBenchmarkParams FFireSimulationBenchmarkParams::FromArgs(const TArray<FString>& Args)
+{
+	FFireSimulationBenchmarkParams Result;
+	const FString Joined = FString::Join(Args, TEXT(" "));
+	FParse::Value(*Joined, TEXT("Name="), Result.Name);
+	FParse::Value(*Joined, TEXT("Size="), Result.Size);
+	FParse::Value(*Joined, TEXT("Patch="), Result.PatchSize);
+	FParse::Value(*Joined, TEXT("Noise="), Result.Noise);
+	FParse::Value(*Joined, TEXT("Actors="), Result.Actors);
+	FParse::Value(*Joined, TEXT("Ignitions="), Result.Ignitions);
+	FParse::Value(*Joined, TEXT("Steps="), Result.Steps);
+	FParse::Value(*Joined, TEXT("Seed="), Result.Seed);
+	FParse::Value(*Joined, TEXT("Workers="), Result.Workers);
+	FParse::Value(*Joined, TEXT("Cell="), Result.CellSize);
+	FParse::Value(*Joined, TEXT("Dt="), Result.StepTime);
+	Result.bQuit = Args.ContainsByPredicate([](const FString& Arg) { return Arg.Equals(TEXT("Quit"), ESearchCase::IgnoreCase); });
+
+	Result.Size = FMath::Max(Result.Size, 8);
+	Result.PatchSize = FMath::Clamp(Result.PatchSize, 1, Result.Size);
+	Result.Noise = FMath::Max(Result.Noise, 0.f);
+	Result.Actors = FMath::Max(Result.Actors, 0);
+	Result.Ignitions = FMath::Max(Result.Ignitions, 1);
+	Result.Steps = FMath::Max(Result.Steps, 1);
+	Result.Workers = FMath::Max(Result.Workers, 0);
+	Result.CellSize = FMath::Max(Result.CellSize, 10.f);
+	Result.StepTime = FMath::Max(Result.StepTime, 0.005f);
+	return Result;
+}
+
+void UFireSimulationBenchmarkSubsystem::StartBenchmark(const FFireSimulationBenchmarkParams& NewParams)
+{
+	UWorld* World = GetWorld();
+	if (IsBenchmarkRunning())
+	{
+		UE_LOG(LogFireSimulation, Warning, TEXT("FireSim.Benchmark: benchmark %s is already running"), *Params.Name);
+		return;
+	}
+
+	// fire source takes wind from game state and only simulates on authority
+	if (World->GetNetMode() == NM_Client || !World->GetGameState())
+	{
+		UE_LOG(LogFireSimulation, Error, TEXT("FireSim.Benchmark: needs a started game on server or standalone"));
+		return;
+	}
+
+	Params = NewParams;
+	LastSummary = FFireSimulationBenchmarkSummary();
+	Samples.Reset();
+	Samples.Reserve(Params.Steps);
+	ReplicatedChunkKeys.Reset();
+	CurrentStep = 0;
+
+	UE_LOG(LogFireSimulation, Log, TEXT("FireSim.Benchmark: starting %s. %dx%d cells, noise %.1f, %d actors, %d ignitions, %d steps"),
+		*Params.Name, Params.Size, Params.Size, Params.Noise, Params.Actors, Params.Ignitions, Params.Steps);
+
+	const double SetupStartTime = FPlatformTime::Seconds();
+	SpawnTerrain();
+	SpawnCombustibleActors();
+	SpawnFireSource();
+	SetupMs = (FPlatformTime::Seconds() - SetupStartTime) * 1000.0;
+	StartTime = FPlatformTime::Seconds();
+
+	if (!IsBenchmarkRunning())
+	{
+		UE_LOG(LogFireSimulation, Error, TEXT("FireSim.Benchmark: failed to start fire"));
+		Cleanup();
+	}
+}
+
+void UFireSimulationBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	if (!FireSource.IsValid())
+		return;
+
+	// one step per frame, so that actors updated by the step and garbage collection get their regular frame
+	AFireSource* Source = FireSource.Get();
+	const double StepStartTime = FPlatformTime::Seconds();
+	Source->StepSimulation(Params.StepTime);
+
+	FFireSimulationBenchmarkSample& Sample = Samples.AddDefaulted_GetRef();
+	Sample.Step = CurrentStep++;
+	Sample.StepMs = (FPlatformTime::Seconds() - StepStartTime) * 1000.0;
+	Sample.Report = Source->GetLastStepReport();
+	Sample.Cells = Source->GetCellsCount();
+	Sample.AllocatedBytes = Source->GetSimulationAllocatedSize();
+	Sample.ReplicatedBytes = MeasureReplicatedBytes();
+
+	if (CurrentStep >= Params.Steps || (!Source->IsFireActive() && Sample.Report.PendingActorUpdates == 0))
+		FinishBenchmark();
+}
+
+TStatId UFireSimulationBenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFireSimulationBenchmarkSubsystem, STATGROUP_Tickables);
+}
+
+bool UFireSimulationBenchmarkSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UFireSimulationBenchmarkSubsystem::SpawnTerrain()
+{
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AActor* Terrain = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform(Params.Origin), SpawnParameters);
+	SpawnedActors.Add(Terrain);
+
+	USceneComponent* Root = NewObject<USceneComponent>(Terrain, TEXT("Root"));
+	Root->SetMobility(EComponentMobility::Static);
+	Terrain->SetRootComponent(Root);
+	Root->RegisterComponent();
+	Root->SetWorldLocation(Params.Origin);
+
+	// terrain is static, so fire source bake trusts it and doesn't sweep it at runtime, same as level geometry
+	UPhysicalMaterial* PhysicalMaterial = GetDefault<UFireSimulationSettings>()->BenchmarkTerrainPhysicalMaterial.LoadSynchronous();
+	constexpr double Thickness = 100.0;
+	const int32 PatchSize = Params.Noise > 0.f ? Params.PatchSize : Params.Size;
+	const int32 PatchesCount = FMath::DivideAndRoundUp(Params.Size, PatchSize);
+	const double HalfPatch = PatchSize * Params.CellSize * 0.5;
+	for (int32 PatchY = 0; PatchY < PatchesCount; PatchY++)
+	{
+		for (int32 PatchX = 0; PatchX < PatchesCount; PatchX++)
+		{
+			const int32 CellX = -Params.Size / 2 + PatchX * PatchSize;
+			const int32 CellY = -Params.Size / 2 + PatchY * PatchSize;
+
+			UBoxComponent* Box = NewObject<UBoxComponent>(Terrain);
+			Box->SetMobility(EComponentMobility::Static);
+			Box->SetupAttachment(Root);
+			Box->SetBoxExtent(FVector(HalfPatch, HalfPatch, Thickness * 0.5), false);
+			// cell key 0 is centered on fire source, so patch starts half a cell before its first cell
+			Box->SetRelativeLocation(FVector((CellX - 0.5) * Params.CellSize + HalfPatch, (CellY - 0.5) * Params.CellSize + HalfPatch,
+				GetTerrainHeight(CellX, CellY) - Thickness * 0.5));
+			Box->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+			Box->SetCollisionResponseToAllChannels(ECR_Block);
+			Box->SetGenerateOverlapEvents(false);
+			Box->RegisterComponent();
+			if (PhysicalMaterial)
+				Box->SetPhysMaterialOverride(PhysicalMaterial);
+		}
+	}
+}
+
+void UFireSimulationBenchmarkSubsystem::SpawnCombustibleActors()
+{
+	if (Params.Actors <= 0)
+		return;
+
+	UClass* CombustibleActorClass = GetDefault<UFireSimulationSettings>()->BenchmarkCombustibleActorClass.LoadSynchronous();
+	if (!CombustibleActorClass)
+	{
+		UE_LOG(LogFireSimulation, Warning, TEXT("FireSim.Benchmark: BenchmarkCombustibleActorClass is not set in fire simulation settings, running without combustible actors"));
+		return;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	FRandomStream RandomStream(Params.Seed);
+	SpawnedActors.Reserve(SpawnedActors.Num() + Params.Actors);
+	for (int32 i = 0; i < Params.Actors; i++)
+	{
+		const int32 CellX = RandomStream.RandRange(-Params.Size / 2, Params.Size / 2 - 1);
+		const int32 CellY = RandomStream.RandRange(-Params.Size / 2, Params.Size / 2 - 1);
+		const FRotator Rotation(0.f, RandomStream.FRandRange(0.f, 360.f), 0.f);
+		if (AActor* CombustibleActor = GetWorld()->SpawnActor<AActor>(CombustibleActorClass, GetTerrainLocation(CellX, CellY), Rotation, SpawnParameters))
+			SpawnedActors.Add(CombustibleActor);
+	}
+}
+
+void UFireSimulationBenchmarkSubsystem::SpawnFireSource()
+{
+	const FTransform Transform(Params.Origin);
+	AFireSource* NewFireSource = GetWorld()->SpawnActorDeferred<AFireSource>(AFireSource::StaticClass(), Transform, nullptr, nullptr,
+		ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+
+	// deterministic mode so that the same params give the same fire on every run
+	NewFireSource->bStartFireAutomatically = false;
+	NewFireSource->bDeterministicSimulation = true;
+	NewFireSource->FixedSimulationStep = Params.StepTime;
+	NewFireSource->FireCellSize = Params.CellSize;
+	NewFireSource->SimulationThreadsCount = Params.Workers;
+	NewFireSource->TerrainBakeData = nullptr;
+	NewFireSource->bBakeTerrainOnBeginPlay = true;
+	NewFireSource->bLog_Debug = false;
+	// measure one isolated simulation, not a level fire source it could be merged into
+	NewFireSource->bShareSimulation = false;
+	// stimuli are updated in Tick, which benchmark doesn't run
+	NewFireSource->bCreatePerceptionStimuli = false;
+	// LOD would depend on where the player camera happens to be, runs have to be comparable
+	NewFireSource->bUseSimulationLod = false;
+	const double HalfSize = Params.Size * Params.CellSize * 0.5;
+	NewFireSource->BoxComponent->SetBoxExtent(FVector(HalfSize, HalfSize, Params.Noise + 200.0));
+	NewFireSource->FinishSpawning(Transform);
+	SpawnedActors.Add(NewFireSource);
+
+	// center first, the rest evenly on a circle around it
+	bool bAnyFireStarted = false;
+	for (int32 i = 0; i < Params.Ignitions; i++)
+	{
+		FIntVector2 IgnitionCell = FIntVector2::ZeroValue;
+		if (i > 0)
+		{
+			const double Angle = UE_TWO_PI * (i - 1) / FMath::Max(Params.Ignitions - 1, 1);
+			IgnitionCell = FIntVector2(FMath::RoundToInt32(FMath::Cos(Angle) * Params.Size * 0.25), FMath::RoundToInt32(FMath::Sin(Angle) * Params.Size * 0.25));
+		}
+
+		NewFireSource->StartFireAtLocation(GetTerrainLocation(IgnitionCell.X, IgnitionCell.Y));
+		bAnyFireStarted |= NewFireSource->IsFireActive();
+	}
+
+	// benchmark steps the simulation itself
+	NewFireSource->SetActorTickEnabled(false);
+	if (bAnyFireStarted)
+		FireSource = NewFireSource;
+}
+
+float UFireSimulationBenchmarkSubsystem::GetTerrainHeight(int32 CellX, int32 CellY) const
+{
+	if (Params.Noise <= 0.f)
+		return 0.f;
+
+	const FVector2D Patch(FMath::FloorToFloat(static_cast<float>(CellX) / Params.PatchSize), FMath::FloorToFloat(static_cast<float>(CellY) / Params.PatchSize));
+	const FVector2D SeedOffset(Params.Seed % 1024 * 0.618, Params.Seed % 1024 * 0.382);
+	return FMath::PerlinNoise2D(Patch * 0.173 + SeedOffset) * Params.Noise;
+}
+
+FVector UFireSimulationBenchmarkSubsystem::GetTerrainLocation(int32 CellX, int32 CellY) const
+{
+	return Params.Origin + FVector(CellX * Params.CellSize, CellY * Params.CellSize, GetTerrainHeight(CellX, CellY));
+}
+
+int64 UFireSimulationBenchmarkSubsystem::MeasureReplicatedBytes()
+{
+	// chunks are serialized the same way net driver does it. Removed chunks only cost their id, so they are not counted
+	int64 Bits = 0;
+	for (const FFireCellChunkItem& Item : FireSource->GetReplicatedCells().Items)
+	{
+		int32& KnownReplicationKey = ReplicatedChunkKeys.FindOrAdd(Item.ReplicationID, INDEX_NONE);
+		if (KnownReplicationKey == Item.ReplicationKey)
+			continue;
+
+		KnownReplicationKey = Item.ReplicationKey;
+		FFireCellChunkItem ItemCopy = Item;
+		FBitWriter Writer(0, true);
+		bool bSuccess = true;
+		ItemCopy.NetSerialize(Writer, nullptr, bSuccess);
+		Bits += Writer.GetNumBits();
+	}
+
+	return (Bits + 7) / 8;
+}
+
+void UFireSimulationBenchmarkSubsystem::FinishBenchmark()
+{
+	UE_LOG(LogFireSimulation, Log, TEXT("FireSim.Benchmark: %s finished after %d steps in %.2f s"), *Params.Name, CurrentStep, FPlatformTime::Seconds() - StartTime);
+	LastSummary = MakeSummary();
+	UE_LOG(LogFireSimulation, Log, TEXT("FireSim.Benchmark: %s peak cells %d, ignited %d, burnt out %d, state hash %08x, step mean %.3f ms, max %.3f ms"), *Params.Name,
+		LastSummary.PeakCells, LastSummary.IgnitedCells, LastSummary.BurntOutCells, LastSummary.StateHash, LastSummary.MeanStepMs, LastSummary.MaxStepMs);
+	
+	if (Params.bWriteResults)
+		WriteResults();
+	
+	Cleanup();
+
+	if (Params.bQuit)
+		FPlatformMisc::RequestExit(false, TEXT("FireSim.Benchmark"));
+}
+
+FFireSimulationBenchmarkSummary UFireSimulationBenchmarkSubsystem::MakeSummary() const
+{
+	FFireSimulationBenchmarkSummary Summary;
+	Summary.CompletedSteps = Samples.Num();
+	Summary.StateHash = FireSource.IsValid() ? FireSource->GetSimulationStateHash() : 0;
+	for (const FFireSimulationBenchmarkSample& Sample : Samples)
+	{
+		Summary.PeakCells = FMath::Max(Summary.PeakCells, Sample.Cells);
+		Summary.IgnitedCells += Sample.Report.IgnitedCells;
+		Summary.BurntOutCells += Sample.Report.BurntOutCells;
+		Summary.MeanStepMs += Sample.StepMs;
+		Summary.MaxStepMs = FMath::Max(Summary.MaxStepMs, Sample.StepMs);
+	}
+
+	Summary.MeanStepMs = Samples.IsEmpty() ? 0.0 : Summary.MeanStepMs / Samples.Num();
+	return Summary;
+}
+
+void UFireSimulationBenchmarkSubsystem::WriteResults() const
+{
+	const FString BasePath = FPaths::ProfilingDir() / TEXT("FireSim") / FString::Printf(TEXT("%s-%s"), *Params.Name, *FDateTime::Now().ToString());
+
+	FString Csv = TEXT("Step,StepMs,SpreadMs,PruneEdgeCellsMs,CreateNewCellsMs,BurnoutMs,ProcessResultMs,UpdateBurningActorsMs,")
+		TEXT("EdgeCells,BurningCells,IgnitedCells,NewCells,BurntOutCells,PendingActorUpdates,Cells,AllocatedBytes,ReplicatedBytes\n");
+	for (const FFireSimulationBenchmarkSample& Sample : Samples)
+	{
+		const FFireSimulationStepReport& Report = Sample.Report;
+		Csv += FString::Printf(TEXT("%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%d,%d,%d,%d,%d,%d,%d,%lld,%lld\n"), Sample.Step, Sample.StepMs,
+			Report.SpreadMs, Report.PruneEdgeCellsMs, Report.CreateNewCellsMs, Report.BurnoutMs, Report.ProcessResultMs, Report.UpdateBurningActorsMs,
+			Report.EdgeCells, Report.BurningCells, Report.IgnitedCells, Report.NewCells, Report.BurntOutCells, Report.PendingActorUpdates,
+			Sample.Cells, Sample.AllocatedBytes, Sample.ReplicatedBytes);
+	}
+
+	auto MakeTimingsObject = [this](double FFireSimulationStepReport::* Field)
+	{
+		TArray<double> Values;
+		Values.Reserve(Samples.Num());
+		double Total = 0.0;
+		for (const FFireSimulationBenchmarkSample& Sample : Samples)
+		{
+			Values.Add(Sample.Report.*Field);
+			Total += Sample.Report.*Field;
+		}
+
+		Values.Sort();
+		auto Percentile = [&Values](double Fraction) { return Values.IsEmpty() ? 0.0 : Values[FMath::Min(FMath::FloorToInt32(Values.Num() * Fraction), Values.Num() - 1)]; };
+		TSharedRef<FJsonObject> TimingsObject = MakeShared<FJsonObject>();
+		TimingsObject->SetNumberField(TEXT("TotalMs"), Total);
+		TimingsObject->SetNumberField(TEXT("MeanMs"), Values.IsEmpty() ? 0.0 : Total / Values.Num());
+		TimingsObject->SetNumberField(TEXT("P50Ms"), Percentile(0.5));
+		TimingsObject->SetNumberField(TEXT("P95Ms"), Percentile(0.95));
+		TimingsObject->SetNumberField(TEXT("MaxMs"), Values.IsEmpty() ? 0.0 : Values.Last());
+		return TimingsObject;
+	};
+
+	TSharedRef<FJsonObject> ParamsObject = MakeShared<FJsonObject>();
+	ParamsObject->SetNumberField(TEXT("Size"), Params.Size);
+	ParamsObject->SetNumberField(TEXT("PatchSize"), Params.PatchSize);
+	ParamsObject->SetNumberField(TEXT("Noise"), Params.Noise);
+	ParamsObject->SetNumberField(TEXT("Actors"), Params.Actors);
+	ParamsObject->SetNumberField(TEXT("Ignitions"), Params.Ignitions);
+	ParamsObject->SetNumberField(TEXT("Steps"), Params.Steps);
+	ParamsObject->SetNumberField(TEXT("Seed"), Params.Seed);
+	ParamsObject->SetNumberField(TEXT("Workers"), Params.Workers);
+	ParamsObject->SetNumberField(TEXT("CellSize"), Params.CellSize);
+	ParamsObject->SetNumberField(TEXT("StepTime"), Params.StepTime);
+
+	TSharedRef<FJsonObject> StagesObject = MakeShared<FJsonObject>();
+	StagesObject->SetObjectField(TEXT("Spread"), MakeTimingsObject(&FFireSimulationStepReport::SpreadMs));
+	StagesObject->SetObjectField(TEXT("PruneEdgeCells"), MakeTimingsObject(&FFireSimulationStepReport::PruneEdgeCellsMs));
+	StagesObject->SetObjectField(TEXT("CreateNewCells"), MakeTimingsObject(&FFireSimulationStepReport::CreateNewCellsMs));
+	StagesObject->SetObjectField(TEXT("Burnout"), MakeTimingsObject(&FFireSimulationStepReport::BurnoutMs));
+	StagesObject->SetObjectField(TEXT("ProcessFireSpreadResult"), MakeTimingsObject(&FFireSimulationStepReport::ProcessResultMs));
+	StagesObject->SetObjectField(TEXT("UpdateBurningActors"), MakeTimingsObject(&FFireSimulationStepReport::UpdateBurningActorsMs));
+
+	int32 PeakCells = 0;
+	int32 PeakEdgeCells = 0;
+	int64 PeakAllocatedBytes = 0;
+	int64 TotalReplicatedBytes = 0;
+	int64 PeakReplicatedBytes = 0;
+	for (const FFireSimulationBenchmarkSample& Sample : Samples)
+	{
+		PeakCells = FMath::Max(PeakCells, Sample.Cells);
+		PeakEdgeCells = FMath::Max(PeakEdgeCells, Sample.Report.EdgeCells);
+		PeakAllocatedBytes = FMath::Max(PeakAllocatedBytes, Sample.AllocatedBytes);
+		PeakReplicatedBytes = FMath::Max(PeakReplicatedBytes, Sample.ReplicatedBytes);
+		TotalReplicatedBytes += Sample.ReplicatedBytes;
+	}
+
+	TSharedRef<FJsonObject> RootObject = MakeShared<FJsonObject>();
+	RootObject->SetStringField(TEXT("Name"), Params.Name);
+	RootObject->SetObjectField(TEXT("Params"), ParamsObject);
+	RootObject->SetNumberField(TEXT("CompletedSteps"), Samples.Num());
+	RootObject->SetStringField(TEXT("StateHash"), FString::Printf(TEXT("%08x"), LastSummary.StateHash));
+	RootObject->SetNumberField(TEXT("SetupMs"), SetupMs);
+	RootObject->SetObjectField(TEXT("Stages"), StagesObject);
+	RootObject->SetNumberField(TEXT("PeakCells"), PeakCells);
+	RootObject->SetNumberField(TEXT("PeakEdgeCells"), PeakEdgeCells);
+	RootObject->SetNumberField(TEXT("PeakAllocatedBytes"), PeakAllocatedBytes);
+	RootObject->SetNumberField(TEXT("TotalReplicatedBytes"), TotalReplicatedBytes);
+	RootObject->SetNumberField(TEXT("PeakReplicatedBytesPerStep"), PeakReplicatedBytes);
+
+	FString Json;
+	const TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(RootObject, JsonWriter);
+
+	const bool bSaved = FFileHelper::SaveStringToFile(Csv, *(BasePath + TEXT(".csv"))) && FFileHelper::SaveStringToFile(Json, *(BasePath + TEXT(".json")));
+	if (bSaved)
+	{
+		UE_LOG(LogFireSimulation, Log, TEXT("FireSim.Benchmark: results written to %s.csv/.json"), *FPaths::ConvertRelativePathToFull(BasePath));
+	}
+	else
+	{
+		UE_LOG(LogFireSimulation, Error, TEXT("FireSim.Benchmark: failed to write results to %s"), *BasePath);
+	}
+}
+
+void UFireSimulationBenchmarkSubsystem::Cleanup()
+{
+	for (AActor* SpawnedActor : SpawnedActors)
+		if (IsValid(SpawnedActor))
+			SpawnedActor->Destroy();
+
+	SpawnedActors.Empty();
+	FireSource.Reset();
+}
@@ -0,0 +1,111 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Data/FireSimulationDataTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "FireSimulationBenchmarkSubsystem.generated.h"
+
+class AFireSource;
+
+struct FFireSimulationBenchmarkParams
+{
+	FString Name = TEXT("FireSim");
+	// side of synthetic terrain in fire cells
+	int32 Size = 256;
+	// side of one terrain box in fire cells. Terrain is built from boxes of this size at noise height
+	int32 PatchSize = 8;
+	// terrain height amplitude in cm. 0 - flat terrain made of a single box
+	float Noise = 0.f;
+	int32 Actors = 2000;
+	int32 Ignitions = 4;
+	int32 Steps = 600;
+	int32 Seed = 1337;
+	// SimulationThreadsCount of benchmarked fire source
+	int32 Workers = 0;
+	float CellSize = 25.f;
+	float StepTime = 1.f / 30.f;
+	// benchmark area is placed far below the level so that it doesn't collide with level geometry
+	FVector Origin = FVector(0.f, 0.f, -200000.f);
+	// exit the game when benchmark is done. For command line runs
+	bool bQuit = false;
+	// write CSV and JSON reports. Automation tests only check the summary
+	bool bWriteResults = true;
+
+	static FFireSimulationBenchmarkParams FromArgs(const TArray<FString>& Args);
+};
+
+struct FFireSimulationBenchmarkSample
+{
+	int32 Step = 0;
+	// wall time of the whole step, including actor updates
+	double StepMs = 0.0;
+	FFireSimulationStepReport Report;
+	int32 Cells = 0;
+	int64 AllocatedBytes = 0;
+	// payload of replicated cell chunks that changed during the step. Fast array headers and packet overhead are not included
+	int64 ReplicatedBytes = 0;
+};
+
+// Totals of a finished run. Runs with the same params must end with the same cells, automation tests compare them
+struct FFireSimulationBenchmarkSummary
+{
+	int32 CompletedSteps = 0;
+	int32 PeakCells = 0;
+	int32 IgnitedCells = 0;
+	int32 BurntOutCells = 0;
+	// see AFireSource::GetSimulationStateHash
+	uint32 StateHash = 0;
+	double MeanStepMs = 0.0;
+	double MaxStepMs = 0.0;
+};
+
+/**
+ * Reproducible headless benchmark of AFireSource. Spawns synthetic terrain with combustible actors, ignites it at fixed points,
+ * runs fixed amount of deterministic simulation steps (one per frame) and writes per-step CSV and summary JSON to Saved/Profiling/FireSim.
+ * Usage: FireSim.Benchmark [Name=] [Size=] [Patch=] [Noise=] [Actors=] [Ignitions=] [Steps=] [Seed=] [Workers=] [Cell=] [Dt=] [Quit]
+ * Headless: UnrealEditor-Cmd FireSimulation.uproject <Map> -game -nullrhi -unattended -ExecCmds="FireSim.Benchmark Steps=600 Quit"
+ */
+UCLASS()
+class FIRESIMULATION_API UFireSimulationBenchmarkSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void StartBenchmark(const FFireSimulationBenchmarkParams& NewParams);
+	bool IsBenchmarkRunning() const { return FireSource.IsValid(); }
+	const FFireSimulationBenchmarkSummary& GetLastSummary() const { return LastSummary; }
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	void SpawnTerrain();
+	void SpawnCombustibleActors();
+	void SpawnFireSource();
+	float GetTerrainHeight(int32 CellX, int32 CellY) const;
+	FVector GetTerrainLocation(int32 CellX, int32 CellY) const;
+	int64 MeasureReplicatedBytes();
+	void FinishBenchmark();
+	FFireSimulationBenchmarkSummary MakeSummary() const;
+	void WriteResults() const;
+	void Cleanup();
+
+	FFireSimulationBenchmarkParams Params;
+	FFireSimulationBenchmarkSummary LastSummary;
+	TWeakObjectPtr<AFireSource> FireSource;
+
+	UPROPERTY()
+	TArray<AActor*> SpawnedActors;
+
+	TArray<FFireSimulationBenchmarkSample> Samples;
+	// replication id -> replication key of chunk item when it was last measured
+	TMap<int32, int32> ReplicatedChunkKeys;
+	int32 CurrentStep = 0;
+	double SetupMs = 0.0;
+	double StartTime = 0.0;
+};
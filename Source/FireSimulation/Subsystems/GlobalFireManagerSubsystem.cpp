@@ -6,40 +6,145 @@
 #include "Actors/FireSource.h"
 #include "Components/BoxComponent.h"
 
+namespace FireManager
+{
+	FBox GetVolumeBounds(const AFireSource* FireSource)
+	{
+		const UBoxComponent* VolumeBox = FireSource->GetVolumeBox();
+		return IsValid(VolumeBox) ? VolumeBox->Bounds.GetBox() : FBox(ForceInit);
+	}
+}
+
 void UGlobalFireManagerSubsystem::RegisterFireSource(AFireSource* FireSource)
 {
+	FireSources.Add(FireSource);
+	if (FireSource->bShareSimulation)
+	{
+		for (AFireSource* RelevantFireSource : GetRelevantFireSources(FireSource, FireSource->RelevantDistanceToOtherFireSources))
+		{
+			AFireSource* Host = RelevantFireSource->GetSimulationHost();
+			if (SimulationHosts.Contains(Host) && Host->CanShareSimulationWith(FireSource))
+			{
+				Host->AddFeeder(FireSource);
+				return;
+			}
+		}
+	}
+	
+	SimulationHosts.Add(FireSource);
 	if (!GlobalFireSource.IsValid())
 		GlobalFireSource = FireSource;
-	
-	FireSources.Add(FireSource);
 }
 
 void UGlobalFireManagerSubsystem::UnregisterFireSource(AFireSource* FireSource)
 {
+	FireSources.Remove(FireSource);
+	SetFireQueryIndex(FireSource, nullptr);
+	if (SimulationHosts.Remove(FireSource) == 0)
+	{
+		AFireSource* Host = FireSource->GetSimulationHost();
+		if (Host != FireSource)
+			Host->RemoveFeeder(FireSource);
+		
+		return;
+	}
+
 	if (FireSource == GlobalFireSource)
 		GlobalFireSource.Reset();
 	
-	FireSources.Remove(FireSource);
+	// fires that already spread to the feeders' area burn out with the host. Feeders become hosts themselves or join other hosts
+	for (AFireSource* Feeder : FireSource->ReleaseFeeders())
+	{
+		FireSources.Remove(Feeder);
+		RegisterFireSource(Feeder);
+	}
+	
+	if (!GlobalFireSource.IsValid())
+		for (const TWeakObjectPtr<AFireSource>& Host : SimulationHosts)
+			if (Host.IsValid())
+			{
+				GlobalFireSource = Host;
+				break;
+			}
 }
 
 void UGlobalFireManagerSubsystem::StartFire(const FVector& Origin)
 {
+	for (const auto& FireSource : FireSources)
+	{
+		if (FireSource.IsValid() && FireManager::GetVolumeBounds(FireSource.Get()).IsInsideOrOn(Origin))
+		{
+			FireSource->StartFireAtLocation(Origin);
+			return;
+		}
+	}
+	
 	if (GlobalFireSource.IsValid())
 		GlobalFireSource->StartFireAtLocation(Origin);
 }
 
 void UGlobalFireManagerSubsystem::SetFireSimulationPaused(bool bPaused)
 {
-	if (GlobalFireSource.IsValid())
-	{
-		GlobalFireSource->SetFirePaused(bPaused);
-	}
+	for (const TWeakObjectPtr<AFireSource>& Host : SimulationHosts)
+		if (Host.IsValid())
+			Host->SetFirePaused(bPaused);
+}
+
+FFireQuerySnapshotRef UGlobalFireManagerSubsystem::GetFireQuerySnapshot() const
+{
+	FReadScopeLock ReadLock(FireQuerySnapshotLock);
+	return FireQuerySnapshot;
+}
+
+void UGlobalFireManagerSubsystem::SetFireQueryIndex(const AFireSource* FireSource, TSharedPtr<const FFireQueryIndex, ESPMode::ThreadSafe> Index)
+{
+	check(IsInGameThread());
+	if (Index.IsValid() && !Index->IsEmpty())
+		FireQueryIndices.Add(FireSource, Index.ToSharedRef());
+	else if (FireQueryIndices.Remove(FireSource) == 0)
+		return;
+	
+	// readers may hold the previous snapshot, so a new one is published instead of changing it
+	TSharedRef<FFireQuerySnapshot, ESPMode::ThreadSafe> NewSnapshot = MakeShared<FFireQuerySnapshot, ESPMode::ThreadSafe>();
+	FireQueryIndices.GenerateValueArray(NewSnapshot->Indices);
+	
+	FWriteScopeLock WriteLock(FireQuerySnapshotLock);
+	FireQuerySnapshot = NewSnapshot;
+}
+
+bool UGlobalFireManagerSubsystem::IsLocationOnFire(const FVector& Location, FFireQueryResult& OutFire) const
+{
+	return GetFireQuerySnapshot()->QueryPoint(Location, OutFire);
+}
+
+bool UGlobalFireManagerSubsystem::FindNearestFire(const FVector& Location, float Radius, FFireQueryResult& OutFire) const
+{
+	return GetFireQuerySnapshot()->FindNearest(Location, Radius, OutFire);
+}
+
+TArray<FFireQueryResult> UGlobalFireManagerSubsystem::GetFiresInRadius(const FVector& Center, float Radius) const
+{
+	TArray<FFireQueryResult> Fires;
+	GetFireQuerySnapshot()->QueryRadius(Center, Radius, Fires);
+	return Fires;
+}
+
+TArray<FFireQueryResult> UGlobalFireManagerSubsystem::GetFiresInBox(const FBox& Box) const
+{
+	TArray<FFireQueryResult> Fires;
+	GetFireQuerySnapshot()->QueryBox(Box, Fires);
+	return Fires;
+}
+
+bool UGlobalFireManagerSubsystem::TraceFire(const FVector& Start, const FVector& End, FFireQueryResult& OutFire) const
+{
+	return GetFireQuerySnapshot()->QuerySegment(Start, End, OutFire);
 }
 
 TArray<AFireSource*> UGlobalFireManagerSubsystem::GetRelevantFireSources(AFireSource* FireSource, float RelevancyDistance) const
 {
 	TArray<AFireSource*> RelevantFireSources;
-	FVector NewFireSourceOrigin = FireSource->GetActorLocation();
+	const FBox NewFireSourceBounds = FireManager::GetVolumeBounds(FireSource).ExpandBy(RelevancyDistance);
 	for (const auto& ExistingFireSource : FireSources)
 	{
 		if (!ExistingFireSource.IsValid())
@@ -48,17 +153,10 @@ TArray<AFireSource*> UGlobalFireManagerSubsystem::GetRelevantFireSources(AFireSo
 			continue;
 		}
 		
-		UBoxComponent* ExistingFireSourceBounds = ExistingFireSource->GetVolumeBox();
-		if (!IsValid(ExistingFireSourceBounds))
-		{
-			ensure(false);
+		if (ExistingFireSource == FireSource)
 			continue;
-		}
-
-		FVector LocalOrigin = ExistingFireSourceBounds->GetComponentTransform().InverseTransformPosition(NewFireSourceOrigin);
-		FVector BoxExtent = ExistingFireSourceBounds->GetUnscaledBoxExtent() + FVector(RelevancyDistance);;
-		const bool bInside = FMath::Abs(LocalOrigin.X) <= BoxExtent.X && FMath::Abs(LocalOrigin.Y) <= BoxExtent.Y && FMath::Abs(LocalOrigin.Z) <= BoxExtent.Z;
-		if (bInside)
+		
+		if (NewFireSourceBounds.Intersect(FireManager::GetVolumeBounds(ExistingFireSource.Get())))
 			RelevantFireSources.Add(ExistingFireSource.Get());
 	}
 	
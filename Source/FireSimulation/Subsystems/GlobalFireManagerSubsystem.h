@@ -3,6 +3,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Data/FireQueryIndex.h"
 #include "Subsystems/WorldSubsystem.h"
 #include "GlobalFireManagerSubsystem.generated.h"
 
@@ -22,13 +23,44 @@ public:
 
 	UFUNCTION(BlueprintCallable)
 	void SetFireSimulationPaused(bool bPaused);
+
+	// Fire queries. Snapshot is thread-safe: grab it once and query it from any thread, it's replaced, never modified, when fire changes.
+	// Works on server and clients, see FFireQueryResult for what clients know about cells
+	FFireQuerySnapshotRef GetFireQuerySnapshot() const;
+	// game thread, called by fire sources when their fire changes. Null index removes the fire source from queries
+	void SetFireQueryIndex(const AFireSource* FireSource, TSharedPtr<const FFireQueryIndex, ESPMode::ThreadSafe> Index);
+	
+	UFUNCTION(BlueprintCallable)
+	bool IsLocationOnFire(const FVector& Location, FFireQueryResult& OutFire) const;
+	
+	UFUNCTION(BlueprintCallable)
+	bool FindNearestFire(const FVector& Location, float Radius, FFireQueryResult& OutFire) const;
+	
+	UFUNCTION(BlueprintCallable)
+	TArray<FFireQueryResult> GetFiresInRadius(const FVector& Center, float Radius) const;
+	
+	UFUNCTION(BlueprintCallable)
+	TArray<FFireQueryResult> GetFiresInBox(const FBox& Box) const;
+	
+	// first fire between Start and End
+	UFUNCTION(BlueprintCallable)
+	bool TraceFire(const FVector& Start, const FVector& End, FFireQueryResult& OutFire) const;
 	
 private:
 	TArray<AFireSource*> GetRelevantFireSources(AFireSource* FireSource, const float RelevancyDistance) const;
 	TSet<TWeakObjectPtr<AFireSource>> FireSources;
 
-	// at first I had an idea that there should be a fire source per starting fire (i.e. exploding a barrel, throwing a molotov)
-	// but then there's a problem of synchronizing and/or merging overlapping fire sources but I'm short on time by now
-	// so fuck it. for the demo there will be just one global fire sim. what could go wrong after all
+	// fire sources that run a simulation. Every other registered fire source is a feeder of one of them:
+	// all fire sources use world-aligned cell keys, so overlapping compatible fire sources burn in the host's grid
+	// and a fire crossing the border between their volumes is simply the same fire
+	TArray<TWeakObjectPtr<AFireSource>> SimulationHosts;
+
+	// fallback for fires started outside of any fire source volume
 	TWeakObjectPtr<AFireSource> GlobalFireSource;	
+	
+	// game thread only
+	TMap<TObjectKey<AFireSource>, FFireQueryIndexRef> FireQueryIndices;
+	// published to any thread, guarded by the lock
+	FFireQuerySnapshotRef FireQuerySnapshot = MakeShared<const FFireQuerySnapshot, ESPMode::ThreadSafe>();
+	mutable FRWLock FireQuerySnapshotLock;
 };
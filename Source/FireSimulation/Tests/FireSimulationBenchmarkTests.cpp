@@ -0,0 +1,135 @@
+﻿#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Game/FSGameState.h"
+#include "Misc/AutomationTest.h"
+#include "Subsystems/FireSimulationBenchmarkSubsystem.h"
+
+#if WITH_AUTOMATION_TESTS
+
+namespace FireSimulationBenchmarkTests
+{
+	// Game world without game mode or game instance: just what benchmark needs, a game state with wind and a physics scene
+	class FScopedBenchmarkWorld
+	{
+	public:
+		FScopedBenchmarkWorld()
+		{
+			World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("FireSimBenchmarkTestWorld"));
+			FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+			WorldContext.SetCurrentWorld(World);
+
+			const FURL URL;
+			World->InitializeActorsForPlay(URL);
+			AGameStateBase* GameState = World->SpawnActor<AFSGameState>();
+			World->SetGameState(GameState);
+			GameState->HandleBeginPlay();
+		}
+
+		~FScopedBenchmarkWorld()
+		{
+			GEngine->DestroyWorldContext(World);
+			World->DestroyWorld(false);
+			CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		}
+
+		UWorld* Get() const { return World; }
+
+	private:
+		UWorld* World = nullptr;
+	};
+
+	// Small scenario that still has every stage busy: noisy terrain, props, several ignitions. Deterministic simulation is forced by the benchmark
+	FFireSimulationBenchmarkParams MakeParams()
+	{
+		FFireSimulationBenchmarkParams Params;
+		Params.Name = TEXT("FireSimAutomation");
+		Params.Size = 96;
+		Params.Noise = 30.f;
+		Params.Actors = 300;
+		Params.Ignitions = 3;
+		Params.Steps = 300;
+		Params.Seed = 4242;
+		Params.bWriteResults = false;
+		return Params;
+	}
+
+	// runs the benchmark to the end by ticking the world, one simulation step per tick, same as the console command does
+	bool RunBenchmark(FAutomationTestBase& Test, UWorld* World, const FFireSimulationBenchmarkParams& Params, FFireSimulationBenchmarkSummary& OutSummary)
+	{
+		UFireSimulationBenchmarkSubsystem* Benchmark = World->GetSubsystem<UFireSimulationBenchmarkSubsystem>();
+		if (!Test.TestNotNull(TEXT("Benchmark subsystem"), Benchmark))
+			return false;
+
+		Benchmark->StartBenchmark(Params);
+		if (!Test.TestTrue(TEXT("Benchmark started"), Benchmark->IsBenchmarkRunning()))
+			return false;
+
+		// benchmark also finishes once the fire and pending actor updates are over, actor updates are time budgeted
+		for (int32 Tick = 0; Tick < Params.Steps * 2 && Benchmark->IsBenchmarkRunning(); Tick++)
+			World->Tick(LEVELTICK_All, Params.StepTime);
+
+		if (!Test.TestFalse(TEXT("Benchmark finished"), Benchmark->IsBenchmarkRunning()))
+			return false;
+
+		OutSummary = Benchmark->GetLastSummary();
+		return true;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFireSimulationBenchmarkDeterminismTest, "FireSimulation.Benchmark.Determinism",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+bool FFireSimulationBenchmarkDeterminismTest::RunTest(const FString& Parameters)
+{
+	using namespace FireSimulationBenchmarkTests;
+	const FFireSimulationBenchmarkParams Params = MakeParams();
+
+	FScopedBenchmarkWorld World;
+	FFireSimulationBenchmarkSummary First;
+	FFireSimulationBenchmarkSummary Second;
+	if (!RunBenchmark(*this, World.Get(), Params, First) || !RunBenchmark(*this, World.Get(), Params, Second))
+		return false;
+
+	TestEqual(TEXT("Peak cells"), Second.PeakCells, First.PeakCells);
+	TestEqual(TEXT("Ignited cells"), Second.IgnitedCells, First.IgnitedCells);
+	TestEqual(TEXT("Burnt out cells"), Second.BurntOutCells, First.BurntOutCells);
+	TestEqual(TEXT("State hash"), Second.StateHash, First.StateHash);
+
+	// the same ground with another seed has props and hills elsewhere
+	FFireSimulationBenchmarkParams OtherSeedParams = Params;
+	OtherSeedParams.Seed++;
+	FFireSimulationBenchmarkSummary OtherSeed;
+	if (RunBenchmark(*this, World.Get(), OtherSeedParams, OtherSeed))
+		TestNotEqual(TEXT("State hash of another seed"), OtherSeed.StateHash, First.StateHash);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFireSimulationBenchmarkEnvelopeTest, "FireSimulation.Benchmark.Envelope",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+bool FFireSimulationBenchmarkEnvelopeTest::RunTest(const FString& Parameters)
+{
+	using namespace FireSimulationBenchmarkTests;
+	const FFireSimulationBenchmarkParams Params = MakeParams();
+
+	FScopedBenchmarkWorld World;
+	FFireSimulationBenchmarkSummary Summary;
+	if (!RunBenchmark(*this, World.Get(), Params, Summary))
+		return false;
+
+	// fire has to get past its initial cells, and can't have more cells than the terrain plus obstacle cells along its border
+	const int32 MaxCells = (Params.Size + 2) * (Params.Size + 2);
+	TestTrue(FString::Printf(TEXT("Fire spread beyond ignitions (%d ignited cells)"), Summary.IgnitedCells), Summary.IgnitedCells > Params.Ignitions * 9);
+	TestTrue(FString::Printf(TEXT("Peak cells %d within terrain (%d)"), Summary.PeakCells, MaxCells), Summary.PeakCells > 0 && Summary.PeakCells <= MaxCells);
+	TestTrue(TEXT("Burnt out cells ignited first"), Summary.BurntOutCells <= Summary.IgnitedCells + Params.Ignitions);
+
+	// generous, to catch order of magnitude regressions on a loaded build machine and not to measure anything
+	constexpr double MaxMeanStepMs = 20.0;
+	constexpr double MaxStepMs = 250.0;
+	TestTrue(FString::Printf(TEXT("Mean step %.3f ms below %.1f ms"), Summary.MeanStepMs, MaxMeanStepMs), Summary.MeanStepMs < MaxMeanStepMs);
+	TestTrue(FString::Printf(TEXT("Max step %.3f ms below %.1f ms"), Summary.MaxStepMs, MaxStepMs), Summary.MaxStepMs < MaxStepMs);
+	return true;
+}
+
+#endif
@@ -0,0 +1,430 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Simulation/FireSpreadTypes.h"
+
+// Sparse grid of fire cells. Cells are stored in dense TileSize x TileSize tiles that are allocated on demand, so memory grows with burned area
+// and not with the square of the fire spread limit. Tiles keep pointers to their 8 neighbor tiles, so neighbor access is index arithmetic
+// inside a tile and a single pointer hop on tile borders - no hashing in the spread loop.
+// Tile data is laid out as structure of arrays: the fields the spread loop reads are in their own contiguous arrays.
+// Whatever burns on a cell is kept by the owner of the grid, cells only hold the owner's handle of it (FFireCell::CombustibleIndex).
+// Tiles where every cell burnt out or is an obstacle are compacted: their memory is released and all of their cells resolve to one shared
+// read-only ash tile, so the rest of the grid still sees them as existing cells that can't burn.
+// Structural changes (adding cells/tiles, compaction) are game thread only and must not overlap with async spread, reading and writing cell data is fine
+class FFireCellGrid
+{
+public:
+	static constexpr int32 TileSizeLog2 = 5;
+	static constexpr int32 TileSize = 1 << TileSizeLog2;
+	static constexpr int32 TileMask = TileSize - 1;
+	static constexpr int32 CellsPerTile = TileSize * TileSize;
+	// directions of neighbor pairs a cell keeps slope factors for. The other 4 neighbors keep the factor of their pair with this cell
+	static constexpr int32 SlopeDirectionsCount = 4;
+	static constexpr int32 SlopeDirectionsX[SlopeDirectionsCount] = { 1, 0, 1, 1 };
+	static constexpr int32 SlopeDirectionsY[SlopeDirectionsCount] = { 0, 1, 1, -1 };
+
+	struct FTile
+	{
+		FIntVector2 Coord = FIntVector2(0, 0);
+
+		// 3x3 block of tiles around this one, row-major from (-1, -1). Index 4 is this tile
+		FTile* Neighbors[9] = {};
+
+		uint64 Occupancy[CellsPerTile / 64] = {};
+		int32 NumCells = 0;
+		// obstacles and burnt out cells. Tile is compacted when all of its cells are settled
+		int32 NumSettledCells = 0;
+
+		// simulation LOD, tile is one LOD region. Set by owner before every step: time this tile is stepped by, 0 - it's skipped this step.
+		// Skipped steps accumulate in PendingDeltaTime, so a region stepped every 4th step is stepped by 4 steps worth of time
+		float StepDeltaTime = 0.f;
+		float PendingDeltaTime = 0.f;
+		uint8 SimulationLod = 0;
+
+		// hot, read by spread loop for every neighbor
+		std::atomic<float> CombustionState[CellsPerTile];
+		float CombustionRate[CellsPerTile];
+		float FireHeight[CellsPerTile];
+		float LocationZ[CellsPerTile];
+		EFireCellFlags Flags[CellsPerTile];
+		EFireCellPhase Phase[CellsPerTile];
+		std::atomic<uint8> Claims[CellsPerTile];
+		// combustion added to cells with combustible actors during a step, accumulated by all workers that burn the cell
+		std::atomic<float> PendingActorCombustion[CellsPerTile];
+		// deterministic mode gathers combustion of a step here while CombustionState still holds the previous step, then commits it
+		float NextCombustionState[CellsPerTile];
+		// horizontal / full distance to the neighbor in SlopeDirections, wind pushes fire up or down a slope less than along flat ground.
+		// Cached when either of the cells is created, see SetSlopeCellSize
+		float SlopeFactors[SlopeDirectionsCount][CellsPerTile];
+
+		// cold
+		float BurnoutRate[CellsPerTile];
+		// 1 when cell ignites, reduced by BurnoutRate every second while it burns
+		float Fuel[CellsPerTile];
+		// simulation time when cell ignited. A cell that ignited while its tile was skipped is stepped only by the time it burned
+		double IgnitionTime[CellsPerTile];
+		FVector Location[CellsPerTile];
+		// FFireCell::CombustibleIndex
+		int32 CombustibleIndex[CellsPerTile];
+
+		FORCEINLINE bool IsOccupied(int32 LocalIndex) const { return (Occupancy[LocalIndex >> 6] & (1ull << (LocalIndex & 63))) != 0; }
+		FORCEINLINE FIntVector2 GetCellKey(int32 LocalIndex) const
+		{
+			return FIntVector2((Coord.X << TileSizeLog2) | (LocalIndex & TileMask), (Coord.Y << TileSizeLog2) | (LocalIndex >> TileSizeLog2));
+		}
+	};
+
+	// Resolved position of a cell in the grid. Cheap to copy, use it instead of keys when walking neighbors
+	struct FCellRef
+	{
+		FTile* Tile = nullptr;
+		int32 LocalIndex = INDEX_NONE;
+
+		FORCEINLINE bool IsValid() const { return Tile != nullptr && Tile->IsOccupied(LocalIndex); }
+		FORCEINLINE FIntVector2 GetKey() const { return Tile->GetCellKey(LocalIndex); }
+
+		FORCEINLINE std::atomic<float>& CombustionState() const { return Tile->CombustionState[LocalIndex]; }
+		FORCEINLINE float GetCombustionRate() const { return Tile->CombustionRate[LocalIndex]; }
+		FORCEINLINE float GetFireHeight() const { return Tile->FireHeight[LocalIndex]; }
+		FORCEINLINE float GetLocationZ() const { return Tile->LocationZ[LocalIndex]; }
+		FORCEINLINE float GetBurnoutRate() const { return Tile->BurnoutRate[LocalIndex]; }
+		FORCEINLINE double GetIgnitionTime() const { return Tile->IgnitionTime[LocalIndex]; }
+		FORCEINLINE void SetIgnitionTime(double Time) const { Tile->IgnitionTime[LocalIndex] = Time; }
+		FORCEINLINE const FVector& GetLocation() const { return Tile->Location[LocalIndex]; }
+		FORCEINLINE int32 GetCombustibleIndex() const { return Tile->CombustibleIndex[LocalIndex]; }
+
+		FORCEINLINE EFireCellFlags GetFlags() const { return Tile->Flags[LocalIndex]; }
+		FORCEINLINE bool HasFlag(EFireCellFlags Flag) const { return EnumHasAnyFlags(Tile->Flags[LocalIndex], Flag); }
+		FORCEINLINE void SetFlag(EFireCellFlags Flag, bool bSet) const
+		{
+			if (bSet)
+				EnumAddFlags(Tile->Flags[LocalIndex], Flag);
+			else
+				EnumRemoveFlags(Tile->Flags[LocalIndex], Flag);
+		}
+
+		// returns true only for the first caller that claims the event for this cell
+		FORCEINLINE bool TryClaim(EFireCellClaims Claim) const
+		{
+			const uint8 ClaimBit = static_cast<uint8>(Claim);
+			return (Tile->Claims[LocalIndex].fetch_or(ClaimBit, std::memory_order_relaxed) & ClaimBit) == 0;
+		}
+
+		FORCEINLINE void ReleaseClaim(EFireCellClaims Claim) const
+		{
+			Tile->Claims[LocalIndex].fetch_and(static_cast<uint8>(~static_cast<uint8>(Claim)), std::memory_order_relaxed);
+		}
+
+		FORCEINLINE bool IsObstacle() const { return HasFlag(EFireCellFlags::Obstacle); }
+		FORCEINLINE bool HasCombustibleInterface() const { return HasFlag(EFireCellFlags::HasCombustibleInterface); }
+		FORCEINLINE EFireCellPhase GetPhase() const
+		{
+			const EFireCellPhase Phase = Tile->Phase[LocalIndex];
+			if (Phase != EFireCellPhase::Unburned)
+				return Phase;
+
+			return Tile->CombustionState[LocalIndex].load() > 0.f ? EFireCellPhase::Igniting : EFireCellPhase::Unburned;
+		}
+
+		// only Burning and Smoldering are set this way, use FFireCellGrid::SetBurntOut to burn cell out
+		FORCEINLINE void SetPhase(EFireCellPhase Phase) const { Tile->Phase[LocalIndex] = Phase; }
+
+		FORCEINLINE bool HasReachedIgnition() const { return Tile->CombustionState[LocalIndex].load() >= 1.f; }
+		FORCEINLINE bool IsIgnited() const
+		{
+			if (Tile->CombustionState[LocalIndex].load() < 1.f)
+				return false;
+
+			const EFireCellFlags CellFlags = Tile->Flags[LocalIndex];
+			return !EnumHasAnyFlags(CellFlags, EFireCellFlags::HasCombustibleInterface) || EnumHasAnyFlags(CellFlags, EFireCellFlags::CombustibleActorIgnited);
+		}
+	};
+
+	FFireCellGrid() = default;
+	FFireCellGrid(const FFireCellGrid&) = delete;
+	FFireCellGrid& operator=(const FFireCellGrid&) = delete;
+
+	FORCEINLINE static FIntVector2 GetTileCoord(const FIntVector2& Key) { return FIntVector2(Key.X >> TileSizeLog2, Key.Y >> TileSizeLog2); }
+	FORCEINLINE static int32 GetLocalIndex(const FIntVector2& Key) { return ((Key.Y & TileMask) << TileSizeLog2) | (Key.X & TileMask); }
+
+	FCellRef FindRef(const FIntVector2& Key) const
+	{
+		FTile* const* Tile = TileLookup.Find(GetTileCoord(Key));
+		return Tile ? FCellRef { *Tile, GetLocalIndex(Key) } : FCellRef();
+	}
+
+	// Direction components must be in [-1, 1]. Returned ref can point to an unoccupied cell or to no tile at all, check IsValid()
+	FORCEINLINE static FCellRef GetNeighbor(const FCellRef& Cell, const FIntVector2& Direction)
+	{
+		const int32 X = (Cell.LocalIndex & TileMask) + Direction.X;
+		const int32 Y = (Cell.LocalIndex >> TileSizeLog2) + Direction.Y;
+		const int32 TileOffsetX = (X >> TileSizeLog2) + 1; // -1 -> 0, in tile -> 1, TileSize -> 2
+		const int32 TileOffsetY = (Y >> TileSizeLog2) + 1;
+		return FCellRef { Cell.Tile->Neighbors[TileOffsetY * 3 + TileOffsetX], ((Y & TileMask) << TileSizeLog2) | (X & TileMask) };
+	}
+
+	// index of SlopeDirections that Direction or its opposite is, bStoredByNeighbor - if it's the opposite, so the factor is kept by the neighbor
+	static int32 GetSlopeIndex(const FIntVector2& Direction, bool& bOutStoredByNeighbor)
+	{
+		for (int32 i = 0; i < SlopeDirectionsCount; i++)
+		{
+			bOutStoredByNeighbor = Direction.X == -SlopeDirectionsX[i] && Direction.Y == -SlopeDirectionsY[i];
+			if (bOutStoredByNeighbor || (Direction.X == SlopeDirectionsX[i] && Direction.Y == SlopeDirectionsY[i]))
+				return i;
+		}
+
+		return INDEX_NONE;
+	}
+
+	// size of a cell that slope factors are computed for. 0 - slope doesn't matter, all factors are 1
+	void SetSlopeCellSize(float NewSlopeCellSize) { SlopeCellSize = NewSlopeCellSize; }
+
+	bool Contains(const FIntVector2& Key) const { return FindRef(Key).IsValid(); }
+
+	bool IsAsh(const FIntVector2& Key) const
+	{
+		FTile* const* Tile = TileLookup.Find(GetTileCoord(Key));
+		return Tile && *Tile == AshTile.Get();
+	}
+
+	// Adds or overwrites a cell, same semantics as TMap::Emplace. Cells of compacted tiles can't be overwritten, check IsAsh().
+	// Combustible handle of an overwritten cell is dropped, owner releases it first with RemoveCombustible
+	FCellRef Emplace(const FIntVector2& Key, const FFireCell& Cell)
+	{
+		FTile& Tile = FindOrAddTile(GetTileCoord(Key));
+		if (!ensure(&Tile != AshTile.Get()))
+			return FCellRef();
+		
+		const int32 LocalIndex = GetLocalIndex(Key);
+		if (!Tile.IsOccupied(LocalIndex))
+		{
+			Tile.Occupancy[LocalIndex >> 6] |= 1ull << (LocalIndex & 63);
+			Tile.CombustibleIndex[LocalIndex] = INDEX_NONE;
+			Tile.NumCells++;
+			NumCells++;
+		}
+		else if (EnumHasAnyFlags(Tile.Flags[LocalIndex], EFireCellFlags::Obstacle) || Tile.Phase[LocalIndex] == EFireCellPhase::BurntOut)
+		{
+			Tile.NumSettledCells--;
+		}
+
+		const FCellRef Ref { &Tile, LocalIndex };
+		Tile.CombustionState[LocalIndex].store(Cell.CombustionState);
+		Tile.CombustionRate[LocalIndex] = Cell.CombustionRate;
+		Tile.FireHeight[LocalIndex] = Cell.FireHeight;
+		Tile.LocationZ[LocalIndex] = Cell.Location.Z;
+		Tile.BurnoutRate[LocalIndex] = Cell.BurnoutRate;
+		Tile.Location[LocalIndex] = Cell.Location;
+		Tile.Flags[LocalIndex] = Cell.bObstacle ? EFireCellFlags::Obstacle : EFireCellFlags::None;
+		Tile.Phase[LocalIndex] = EFireCellPhase::Unburned;
+		Tile.Fuel[LocalIndex] = 1.f;
+		Tile.IgnitionTime[LocalIndex] = 0.0;
+		Tile.Claims[LocalIndex].store(0);
+		Tile.PendingActorCombustion[LocalIndex].store(0.f);
+		if (Cell.bObstacle)
+			Tile.NumSettledCells++;
+
+		Tile.CombustibleIndex[LocalIndex] = Cell.CombustibleIndex;
+		if (Cell.HasCombustible())
+			Tile.Flags[LocalIndex] |= EFireCellFlags::HasCombustibleInterface;
+
+		UpdateSlopeFactors(Ref);
+		return Ref;
+	}
+
+	// Allocates all tiles that cells within Radius of the key can fall into. Lets async stages reach and claim cells that don't exist yet
+	void EnsureTilesAround(const FIntVector2& Key, int32 Radius)
+	{
+		const FIntVector2 MinTile = GetTileCoord(Key - FIntVector2(Radius, Radius));
+		const FIntVector2 MaxTile = GetTileCoord(Key + FIntVector2(Radius, Radius));
+		for (int32 Y = MinTile.Y; Y <= MaxTile.Y; Y++)
+			for (int32 X = MinTile.X; X <= MaxTile.X; X++)
+				FindOrAddTile(FIntVector2(X, Y));
+	}
+
+	// Returns true if all cells of the cell's tile are settled now and the tile can be compacted
+	bool SetBurntOut(const FCellRef& Cell)
+	{
+		if (Cell.Tile->Phase[Cell.LocalIndex] == EFireCellPhase::BurntOut)
+			return false;
+
+		Cell.SetPhase(EFireCellPhase::BurntOut);
+		Cell.Tile->NumSettledCells++;
+		return Cell.Tile->NumCells == CellsPerTile && Cell.Tile->NumSettledCells == CellsPerTile;
+	}
+
+	// Releases a fully settled tile. Its cells keep existing as ash: occupied, obstacle, burnt out, no combustibles.
+	// ReleaseCombustible(int32 CombustibleIndex) is called for combustible handles the tile still had
+	template<typename TFunc>
+	void CompactTile(FTile* Tile, TFunc&& ReleaseCombustible)
+	{
+		if (!ensure(Tile != AshTile.Get() && Tile->NumSettledCells == CellsPerTile))
+			return;
+
+		for (int32 i = 0; i < CellsPerTile; i++)
+		{
+			const int32 CombustibleIndex = RemoveCombustible(FCellRef { Tile, i });
+			if (CombustibleIndex != INDEX_NONE)
+				ReleaseCombustible(CombustibleIndex);
+		}
+
+		FTile* Ash = GetOrCreateAshTile();
+		for (int32 NeighborIndex = 0; NeighborIndex < 9; NeighborIndex++)
+		{
+			FTile* Neighbor = Tile->Neighbors[NeighborIndex];
+			// neighbor at offset (X, Y) sees this tile at (-X, -Y)
+			if (NeighborIndex != 4 && Neighbor && Neighbor != Ash)
+				Neighbor->Neighbors[8 - NeighborIndex] = Ash;
+		}
+
+		TileLookup[Tile->Coord] = Ash;
+		NumCells -= Tile->NumCells;
+		NumAshTiles++;
+		Tiles.RemoveAtSwap(Tiles.IndexOfByPredicate([Tile](const TUniquePtr<FTile>& Existing) { return Existing.Get() == Tile; }));
+	}
+
+	// detaches combustible from the cell. Returns its handle for the owner to release, INDEX_NONE if there was none
+	int32 RemoveCombustible(const FCellRef& Cell)
+	{
+		if (Cell.Tile == AshTile.Get())
+			return INDEX_NONE;
+		
+		const int32 Index = Cell.Tile->CombustibleIndex[Cell.LocalIndex];
+		Cell.Tile->CombustibleIndex[Cell.LocalIndex] = INDEX_NONE;
+		Cell.SetFlag(EFireCellFlags::HasCombustibleInterface | EFireCellFlags::CombustibleActorIgnited, false);
+		return Index;
+	}
+
+	int32 Num() const { return NumCells; }
+	bool IsEmpty() const { return NumCells == 0; }
+	int32 NumTiles() const { return Tiles.Num(); }
+	int32 GetNumAshTiles() const { return NumAshTiles; }
+	SIZE_T GetAllocatedSize() const
+	{
+		return (Tiles.Num() + (AshTile.IsValid() ? 1 : 0)) * sizeof(FTile) + Tiles.GetAllocatedSize() + TileLookup.GetAllocatedSize();
+	}
+
+	void Reset()
+	{
+		Tiles.Reset();
+		TileLookup.Reset();
+		AshTile.Reset();
+		NumCells = 0;
+		NumAshTiles = 0;
+	}
+
+	// tiles that hold cells, compacted ones are not included
+	template<typename TFunc>
+	void ForEachTile(TFunc&& Func)
+	{
+		for (const TUniquePtr<FTile>& Tile : Tiles)
+			Func(*Tile);
+	}
+
+	template<typename TFunc>
+	void ForEachCell(TFunc&& Func) const
+	{
+		for (const TUniquePtr<FTile>& Tile : Tiles)
+		{
+			for (int32 i = 0; i < CellsPerTile; i++)
+			{
+				if (Tile->IsOccupied(i))
+					Func(FCellRef { Tile.Get(), i });
+			}
+		}
+	}
+
+private:
+	FTile& FindOrAddTile(const FIntVector2& TileCoord)
+	{
+		if (FTile** Existing = TileLookup.Find(TileCoord))
+			return **Existing;
+
+		FTile* NewTile = Tiles.Emplace_GetRef(MakeUnique<FTile>()).Get();
+		NewTile->Coord = TileCoord;
+		NewTile->Neighbors[4] = NewTile;
+		TileLookup.Add(TileCoord, NewTile);
+
+		// link with already existing neighbor tiles both ways
+		for (int32 OffsetY = -1; OffsetY <= 1; OffsetY++)
+		{
+			for (int32 OffsetX = -1; OffsetX <= 1; OffsetX++)
+			{
+				if (OffsetX == 0 && OffsetY == 0)
+					continue;
+
+				if (FTile** Neighbor = TileLookup.Find(TileCoord + FIntVector2(OffsetX, OffsetY)))
+				{
+					NewTile->Neighbors[(OffsetY + 1) * 3 + OffsetX + 1] = *Neighbor;
+					// ash tile is shared, nothing ever walks neighbors from it
+					if (*Neighbor != AshTile.Get())
+						(*Neighbor)->Neighbors[(1 - OffsetY) * 3 + 1 - OffsetX] = NewTile;
+				}
+			}
+		}
+
+		return *NewTile;
+	}
+
+	// factors of the pairs of a new cell with its existing neighbors, both the ones it keeps and the ones neighbors keep
+	void UpdateSlopeFactors(const FCellRef& Cell)
+	{
+		for (int32 i = 0; i < SlopeDirectionsCount; i++)
+		{
+			Cell.Tile->SlopeFactors[i][Cell.LocalIndex] = 1.f;
+			if (SlopeCellSize <= 0.f)
+				continue;
+			
+			const float HorizontalSquared = (SlopeDirectionsX[i] * SlopeDirectionsX[i] + SlopeDirectionsY[i] * SlopeDirectionsY[i]) * FMath::Square(SlopeCellSize);
+			for (const int32 Sign : { 1, -1 })
+			{
+				const FCellRef Neighbor = GetNeighbor(Cell, FIntVector2(SlopeDirectionsX[i] * Sign, SlopeDirectionsY[i] * Sign));
+				if (!Neighbor.IsValid() || Neighbor.Tile == AshTile.Get())
+					continue;
+
+				const float DeltaZ = Neighbor.GetLocationZ() - Cell.GetLocationZ();
+				const FCellRef& Owner = Sign > 0 ? Cell : Neighbor;
+				Owner.Tile->SlopeFactors[i][Owner.LocalIndex] = FMath::Sqrt(HorizontalSquared / (HorizontalSquared + DeltaZ * DeltaZ));
+			}
+		}
+	}
+
+	FTile* GetOrCreateAshTile()
+	{
+		if (!AshTile.IsValid())
+		{
+			AshTile = MakeUnique<FTile>();
+			FTile& Ash = *AshTile;
+			FMemory::Memset(Ash.Occupancy, 0xFF, sizeof(Ash.Occupancy));
+			Ash.NumCells = CellsPerTile;
+			Ash.NumSettledCells = CellsPerTile;
+			for (int32 i = 0; i < CellsPerTile; i++)
+			{
+				Ash.CombustionState[i].store(0.f);
+				Ash.CombustionRate[i] = 0.f;
+				Ash.FireHeight[i] = 0.f;
+				Ash.LocationZ[i] = 0.f;
+				Ash.Flags[i] = EFireCellFlags::Obstacle;
+				Ash.Phase[i] = EFireCellPhase::BurntOut;
+				Ash.Claims[i].store(0);
+				Ash.PendingActorCombustion[i].store(0.f);
+				Ash.BurnoutRate[i] = 0.f;
+				Ash.Fuel[i] = 0.f;
+				Ash.IgnitionTime[i] = 0.0;
+				for (int32 SlopeIndex = 0; SlopeIndex < SlopeDirectionsCount; SlopeIndex++)
+					Ash.SlopeFactors[SlopeIndex][i] = 1.f;
+				Ash.Location[i] = FVector::ZeroVector;
+				Ash.CombustibleIndex[i] = INDEX_NONE;
+			}
+		}
+
+		return AshTile.Get();
+	}
+
+	TArray<TUniquePtr<FTile>> Tiles;
+	TMap<FIntVector2, FTile*> TileLookup;
+	TUniquePtr<FTile> AshTile;
+	int32 NumCells = 0;
+	int32 NumAshTiles = 0;
+	float SlopeCellSize = 0.f;
+};
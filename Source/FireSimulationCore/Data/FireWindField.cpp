@@ -0,0 +1,59 @@
+﻿#include "FireWindField.h"
+
+void FFireWindField::SampleBatch(const float* X, const float* Y, int32 Num, FVector2f* OutWind) const
+{
+	if (Nodes.IsEmpty())
+	{
+		for (int32 i = 0; i < Num; i++)
+			OutWind[i] = Uniform;
+		
+		return;
+	}
+
+	constexpr int32 MaxBatch = 64;
+	check(Num <= MaxBatch);
+	float GridX[MaxBatch];
+	float GridY[MaxBatch];
+	const float OriginX = Origin.X;
+	const float OriginY = Origin.Y;
+	const float InvSpacing = InvNodeSpacing;
+	const float MaxX = static_cast<float>(SizeX - 1);
+	const float MaxY = static_cast<float>(SizeY - 1);
+	for (int32 i = 0; i < Num; i++)
+	{
+		GridX[i] = FMath::Clamp((X[i] - OriginX) * InvSpacing, 0.f, MaxX);
+		GridY[i] = FMath::Clamp((Y[i] - OriginY) * InvSpacing, 0.f, MaxY);
+	}
+
+	for (int32 i = 0; i < Num; i++)
+	{
+		const int32 X0 = FMath::Min(static_cast<int32>(GridX[i]), SizeX - 2);
+		const int32 Y0 = FMath::Min(static_cast<int32>(GridY[i]), SizeY - 2);
+		const float FracX = GridX[i] - X0;
+		const float FracY = GridY[i] - Y0;
+		const FVector2f* Row0 = &Nodes[Y0 * SizeX + X0];
+		const FVector2f* Row1 = Row0 + SizeX;
+		OutWind[i] = FMath::Lerp(FMath::Lerp(Row0[0], Row0[1], FracX), FMath::Lerp(Row1[0], Row1[1], FracX), FracY);
+	}
+}
+
+float FFireWindField::GetMinStrength() const
+{
+	if (Nodes.IsEmpty())
+		return Uniform.Size();
+
+	// bilinear sample is a weighted sum of 4 corners, so it's at least as long as a corner minus the farthest other corner from it
+	float MinStrength = FLT_MAX;
+	for (int32 Y = 0; Y < SizeY - 1; Y++)
+	{
+		for (int32 X = 0; X < SizeX - 1; X++)
+		{
+			const FVector2f* Row0 = &Nodes[Y * SizeX + X];
+			const FVector2f* Row1 = Row0 + SizeX;
+			const float MaxDifference = FMath::Max3((Row0[1] - Row0[0]).Size(), (Row1[0] - Row0[0]).Size(), (Row1[1] - Row0[0]).Size());
+			MinStrength = FMath::Min(MinStrength, Row0[0].Size() - MaxDifference);
+		}
+	}
+
+	return FMath::Max(MinStrength, 0.f);
+}
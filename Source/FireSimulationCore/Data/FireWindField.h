@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+// Wind over the level at the moment of a simulation step: coarse grid of 2D wind vectors (direction * strength) sampled bilinearly.
+// Without nodes wind is the same everywhere
+struct FIRESIMULATIONCORE_API FFireWindField
+{
+	// world XY of node (0, 0)
+	FVector2D Origin = FVector2D::ZeroVector;
+	double InvNodeSpacing = 0.0;
+	int32 SizeX = 0;
+	int32 SizeY = 0;
+	// row-major, SizeX * SizeY. Empty for uniform wind
+	TArray<FVector2f> Nodes;
+	FVector2f Uniform = FVector2f::ZeroVector;
+
+	bool IsUniform() const { return Nodes.IsEmpty(); }
+	
+	// locations outside of the grid get the wind of the closest border
+	FORCEINLINE FVector2f Sample(const FVector& Location) const
+	{
+		if (Nodes.IsEmpty())
+			return Uniform;
+
+		// same float math as SampleBatch, so both give bit-identical results for the same location
+		const float GridX = FMath::Clamp((static_cast<float>(Location.X) - static_cast<float>(Origin.X)) * static_cast<float>(InvNodeSpacing), 0.f, static_cast<float>(SizeX - 1));
+		const float GridY = FMath::Clamp((static_cast<float>(Location.Y) - static_cast<float>(Origin.Y)) * static_cast<float>(InvNodeSpacing), 0.f, static_cast<float>(SizeY - 1));
+		const int32 X0 = FMath::Min(static_cast<int32>(GridX), SizeX - 2);
+		const int32 Y0 = FMath::Min(static_cast<int32>(GridY), SizeY - 2);
+		const float FracX = GridX - X0;
+		const float FracY = GridY - Y0;
+		const FVector2f* Row0 = &Nodes[Y0 * SizeX + X0];
+		const FVector2f* Row1 = Row0 + SizeX;
+		return FMath::Lerp(FMath::Lerp(Row0[0], Row0[1], FracX), FMath::Lerp(Row1[0], Row1[1], FracX), FracY);
+	}
+
+	// Sample for a batch of locations. Grid coordinates are computed in a separate branch-free pass over plain float arrays so the compiler can vectorize it,
+	// only the node fetch is scalar. Num is expected to be small (a block of a worker batch)
+	void SampleBatch(const float* X, const float* Y, int32 Num, FVector2f* OutWind) const;
+
+	// strength that wind is guaranteed to have anywhere. Conservative for the grid: corners of a cell can point in different directions
+	float GetMinStrength() const;
+};
@@ -0,0 +1,21 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+// Cellular automaton of fire spread: cell grid, spread kernels, wind sampling. Depends only on Core, so it's tested and profiled
+// by FireSimulationCoreTests without the engine, and AFireSource in FireSimulation module is an adapter over it
+public class FireSimulationCore : ModuleRules
+{
+	public FireSimulationCore(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(new string[] {
+			"Core"
+		});
+
+		PublicIncludePaths.AddRange(new string[] {
+			ModuleDirectory
+		});
+	}
+}
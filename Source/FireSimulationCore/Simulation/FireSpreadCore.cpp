@@ -0,0 +1,399 @@
+﻿#include "FireSpreadCore.h"
+
+#include "Simulation/FireTerrainQuery.h"
+
+FFireSpreadCore::FFireSpreadCore(const FFireCellGrid& InCells, const IFireTerrainQuery& InTerrain)
+	: Cells(&InCells), Terrain(&InTerrain)
+{
+	RadialDirections =
+	{
+		{1, 1},
+		{ -1, -1},
+		{ 1, 0},
+		{0, 1},
+		{1, -1},
+		{-1, 1},
+		{-1, 0},
+		{0, -1}
+	};
+
+	for (int32 i = 0; i < RadialDirections.Num(); i++)
+	{
+		const FVector2f Unit = FVector2f(RadialDirections[i].X, RadialDirections[i].Y).GetSafeNormal();
+		RadialUnitX[i] = Unit.X;
+		RadialUnitY[i] = Unit.Y;
+		RadialSlopeIndex[i] = FFireCellGrid::GetSlopeIndex(RadialDirections[i], bRadialSlopeStoredByNeighbor[i]);
+	}
+}
+
+void FFireSpreadCore::BeginStep(const FFireSpreadStepParams& NewStepParams)
+{
+	StepParams = NewStepParams;
+	// wind only changes when wind component says so, so for the usual uniform wind the weights are computed once per change and not per cell
+	if (StepParams.Wind.IsUniform() && StepParams.Wind.Uniform != UniformWindWeightsWind)
+	{
+		ComputeWindWeights(StepParams.Wind.Uniform, UniformWindWeights);
+		UniformWindWeightsWind = StepParams.Wind.Uniform;
+	}
+}
+
+// Weights are continuous in wind direction, so fire front takes the shape of the wind instead of snapping to 8 directions.
+// Dot products with fixed unit directions, no trigonometry or square roots
+void FFireSpreadCore::ComputeWindWeights(const FVector2f& Wind, FWindWeights& OutWeights) const
+{
+	OutWeights.bCalm = Wind.SizeSquared() <= FMath::Square(Settings.WindEffectActivationThreshold);
+	if (OutWeights.bCalm)
+	{
+		for (int32 i = 0; i < 8; i++)
+			OutWeights.Weights[i] = MinWindEffect;
+		
+		OutWeights.Mask = AllDirectionsMask;
+		return;
+	}
+	
+	OutWeights.Mask = 0;
+	for (int32 i = 0; i < 8; i++)
+	{
+		OutWeights.Weights[i] = RadialUnitX[i] * Wind.X + RadialUnitY[i] * Wind.Y;
+		if (OutWeights.Weights[i] > 0.f)
+			OutWeights.Mask |= 1u << i;
+	}
+}
+
+bool FFireSpreadCore::IsCombustible(const FFireCellGrid::FCellRef& TargetCell, const FFireCellGrid::FCellRef& ByCell) const
+{
+	if (TargetCell.IsObstacle() || IsCellIgnited(TargetCell))
+		return false;
+
+	const float TargetZ = TargetCell.GetLocationZ();
+	const float ByZ = ByCell.GetLocationZ();
+	return TargetZ < ByZ + ByCell.GetFireHeight() && TargetZ > ByZ - Settings.FireDownwardPropagationThreshold;
+}
+
+bool FFireSpreadCore::IsCellIgnited(const FFireCellGrid::FCellRef& Cell) const
+{
+	// combustible actors are updated time-sliced on game thread, so in deterministic mode they can't decide when a cell ignites
+	return StepParams.bDeterministic ? Cell.HasReachedIgnition() : Cell.IsIgnited();
+}
+
+bool FFireSpreadCore::HasCombustibleNeighbors(const FFireCellGrid::FCellRef& Cell) const
+{
+	for (const auto& Direction : RadialDirections)
+	{
+		const FFireCellGrid::FCellRef NeighborCell = FFireCellGrid::GetNeighbor(Cell, Direction);
+		if (ensure(NeighborCell.IsValid()) && IsCombustible(NeighborCell, Cell))
+			return true;
+	}
+
+	return false;
+}
+
+void FFireSpreadCore::GatherEdgeCells(const TArray<FIntVector2>& EdgeCells, int32 Start, int32 End, FFireCellGrid::FCellRef* OutCells, FVector2f* OutWinds) const
+{
+	const int32 Num = End - Start;
+	float X[EdgeCellsBlockSize];
+	float Y[EdgeCellsBlockSize];
+	for (int32 i = 0; i < Num; i++)
+	{
+		OutCells[i] = Cells->FindRef(EdgeCells[Start + i]);
+		const FVector& Location = OutCells[i].GetLocation();
+		X[i] = Location.X;
+		Y[i] = Location.Y;
+	}
+	
+	StepParams.Wind.SampleBatch(X, Y, Num, OutWinds);
+}
+
+float FFireSpreadCore::GetWindEffect(const FFireCellGrid::FCellRef& TargetCell, const FFireCellGrid::FCellRef& ByCell, int32 Direction, const FWindWeights& WindWeights) const
+{
+	// fire that spreads sideways to wind is clamped by some small value, so that it still creeps there
+	return WindWeights.bCalm ? MinWindEffect : FMath::Max(MinWindEffect, WindWeights.Weights[Direction] * GetSlopeFactor(TargetCell, ByCell, Direction));
+}
+
+float FFireSpreadCore::GetSpreadFactor(const FFireCellGrid::FCellRef& ByCell) const
+{
+	return ByCell.GetPhase() == EFireCellPhase::Smoldering ? Settings.SmolderingSpreadFactor : 1.f;
+}
+
+// Neighbor fields are gathered from the grid in one scalar pass, then combustibility by height and wind effect of all 8 neighbors
+// are evaluated in two 4-wide vector registers. Wind weights are per direction and slope factors are cached in the grid, so it's multiplies only
+uint32 FFireSpreadCore::EvaluateNeighbors(const FFireCellGrid::FCellRef& EdgeCell, const FVector2f& Wind, FFireCellGrid::FCellRef* OutNeighbors, float* OutIncreases) const
+{
+	FWindWeights Scratch;
+	const FWindWeights& WindWeights = GetWindWeights(Wind, Scratch);
+	uint32 CandidatesMask = WindWeights.Mask;
+	alignas(16) float TargetZ[8];
+	alignas(16) float CombustionRates[8];
+	alignas(16) float SlopeFactors[8];
+	for (int32 i = 0; i < 8; i++)
+	{
+		TargetZ[i] = 0.f;
+		CombustionRates[i] = 0.f;
+		SlopeFactors[i] = 1.f;
+		if ((CandidatesMask & (1u << i)) == 0)
+			continue;
+		
+		OutNeighbors[i] = FFireCellGrid::GetNeighbor(EdgeCell, RadialDirections[i]);
+		const FFireCellGrid::FCellRef& Neighbor = OutNeighbors[i];
+		if (!ensure(Neighbor.IsValid()) || Neighbor.IsObstacle() || IsCellIgnited(Neighbor))
+		{
+			CandidatesMask &= ~(1u << i);
+			continue;
+		}
+		
+		TargetZ[i] = Neighbor.GetLocationZ();
+		CombustionRates[i] = Neighbor.GetCombustionRate();
+		SlopeFactors[i] = GetSlopeFactor(Neighbor, EdgeCell, i);
+	}
+
+	if (CandidatesMask == 0)
+		return 0;
+	
+	const float ByZ = EdgeCell.GetLocationZ();
+	const VectorRegister4Float VUpperZ = VectorSetFloat1(ByZ + EdgeCell.GetFireHeight());
+	const VectorRegister4Float VLowerZ = VectorSetFloat1(ByZ - Settings.FireDownwardPropagationThreshold);
+	const VectorRegister4Float VMinWindEffect = VectorSetFloat1(MinWindEffect);
+	const VectorRegister4Float VScale = VectorSetFloat1(GetCellDeltaTime(EdgeCell) * GetSpreadFactor(EdgeCell));
+	uint32 HeightMask = 0;
+	for (int32 Offset = 0; Offset < 8; Offset += 4)
+	{
+		const VectorRegister4Float Z = VectorLoadAligned(TargetZ + Offset);
+		HeightMask |= static_cast<uint32>(VectorMaskBits(VectorBitwiseAnd(VectorCompareLT(Z, VUpperZ), VectorCompareGT(Z, VLowerZ)))) << Offset;
+		
+		const VectorRegister4Float WindEffect = WindWeights.bCalm
+			? VMinWindEffect
+			: VectorMax(VMinWindEffect, VectorMultiply(VectorLoadAligned(WindWeights.Weights + Offset), VectorLoadAligned(SlopeFactors + Offset)));
+		
+		VectorStoreAligned(VectorMultiply(VectorMultiply(WindEffect, VScale), VectorLoadAligned(CombustionRates + Offset)), OutIncreases + Offset);
+	}
+
+	return CandidatesMask & HeightMask;
+}
+
+void FFireSpreadCore::SpreadFireBatch(const TArray<FIntVector2>& EdgeCells, int32 Start, int32 End, FFireSpreadWorkerResult& Result) const
+{
+	FFireCellGrid::FCellRef BlockCells[EdgeCellsBlockSize];
+	FVector2f BlockWinds[EdgeCellsBlockSize];
+	FFireCellGrid::FCellRef Neighbors[8];
+	alignas(16) float CombustIncreases[8];
+	for (int32 BlockStart = Start; BlockStart < End; BlockStart += EdgeCellsBlockSize)
+	{
+		const int32 BlockSize = FMath::Min(EdgeCellsBlockSize, End - BlockStart);
+		GatherEdgeCells(EdgeCells, BlockStart, BlockStart + BlockSize, BlockCells, BlockWinds);
+		for (int32 i = 0; i < BlockSize; i++)
+		{
+			const FFireCellGrid::FCellRef& EdgeCell = BlockCells[i];
+			const uint32 BurnedNeighbors = EvaluateNeighbors(EdgeCell, BlockWinds[i], Neighbors, CombustIncreases);
+			if (BurnedNeighbors == 0 && StepParams.bEdgeCellsCanSleep)
+				Result.StalledEdgeCells.Emplace(EdgeCell.GetKey());
+			
+			for (uint32 Mask = BurnedNeighbors; Mask != 0; Mask &= Mask - 1)
+			{
+				const int32 Direction = FMath::CountTrailingZeros(Mask);
+				const FFireCellGrid::FCellRef& TestCell = Neighbors[Direction];
+				const float CombustIncrease = CombustIncreases[Direction];
+				
+				// 1. spreading fire by edge cells
+				TestCell.CombustionState().fetch_add(CombustIncrease);
+				const FIntVector2 TestCellIndex = TestCell.GetKey();
+				
+				// 2.1 mark for add newly ignited cells to edge cells
+				// a cell can be ignited by several edge cells at once, it is reported only by the first worker that claims it
+				if (TestCell.IsIgnited() && TestCell.TryClaim(EFireCellClaims::Ignition))
+					Result.IgnitedCells.Emplace(TestCellIndex);
+
+				// 2.2 aggregate combustion increase for actors that have combustible interface.
+				// actor's individual combustion state != individual cell combustion state
+				// increase is accumulated in the grid and the cell is reported once, the sum is picked up after the stage
+				if (TestCell.HasCombustibleInterface())
+				{
+					TestCell.Tile->PendingActorCombustion[TestCell.LocalIndex].fetch_add(CombustIncrease);
+					if (TestCell.TryClaim(EFireCellClaims::ActorUpdate))
+						Result.CombustionActorCells.Emplace(TestCellIndex);
+				}
+			}
+		}
+	}
+}
+
+// Same step as SpreadFireBatch, but instead of edge cells adding combustion to their neighbors, every cell that can be burned
+// sums up what its burning neighbors give it in a fixed order and writes the result to the back buffer.
+// Every value then depends only on the previous step, no matter how cells are split between workers
+void FFireSpreadCore::CollectCombustionTargets(const TArray<FIntVector2>& EdgeCells, int32 Start, int32 End, FFireSpreadWorkerResult& Result) const
+{
+	FFireCellGrid::FCellRef BlockCells[EdgeCellsBlockSize];
+	FVector2f BlockWinds[EdgeCellsBlockSize];
+	for (int32 BlockStart = Start; BlockStart < End; BlockStart += EdgeCellsBlockSize)
+	{
+		const int32 BlockSize = FMath::Min(EdgeCellsBlockSize, End - BlockStart);
+		GatherEdgeCells(EdgeCells, BlockStart, BlockStart + BlockSize, BlockCells, BlockWinds);
+		for (int32 i = 0; i < BlockSize; i++)
+		{
+			const FFireCellGrid::FCellRef& EdgeCell = BlockCells[i];
+			FWindWeights Scratch;
+			bool bStalled = true;
+			for (uint32 Mask = GetWindWeights(BlockWinds[i], Scratch).Mask; Mask != 0; Mask &= Mask - 1)
+			{
+				const FFireCellGrid::FCellRef TestCell = FFireCellGrid::GetNeighbor(EdgeCell, RadialDirections[FMath::CountTrailingZeros(Mask)]);
+				if (!ensure(TestCell.IsValid()) || !IsCombustible(TestCell, EdgeCell))
+					continue;
+				
+				bStalled = false;
+				if (TestCell.TryClaim(EFireCellClaims::CombustionTarget))
+					Result.CombustionTargets.Emplace(TestCell.GetKey());
+			}
+			
+			if (bStalled && StepParams.bEdgeCellsCanSleep)
+				Result.StalledEdgeCells.Emplace(EdgeCell.GetKey());
+		}
+	}
+}
+
+void FFireSpreadCore::GatherCombustion(const TArray<FIntVector2>& CombustionTargets, int32 Start, int32 End) const
+{
+	for (int32 i = Start; i < End; i++)
+	{
+		const FFireCellGrid::FCellRef Cell = Cells->FindRef(CombustionTargets[i]);
+		const float CombustIncrease = GatherCellCombustion(Cell);
+		Cell.Tile->NextCombustionState[Cell.LocalIndex] = Cell.CombustionState().load(std::memory_order_relaxed) + CombustIncrease;
+		if (Cell.HasCombustibleInterface())
+			Cell.Tile->PendingActorCombustion[Cell.LocalIndex].store(CombustIncrease, std::memory_order_relaxed);
+	}
+}
+
+void FFireSpreadCore::CommitCombustion(const TArray<FIntVector2>& CombustionTargets, int32 Start, int32 End, FFireSpreadWorkerResult& Result) const
+{
+	for (int32 i = Start; i < End; i++)
+	{
+		const FFireCellGrid::FCellRef Cell = Cells->FindRef(CombustionTargets[i]);
+		Cell.CombustionState().store(Cell.Tile->NextCombustionState[Cell.LocalIndex], std::memory_order_relaxed);
+		Cell.ReleaseClaim(EFireCellClaims::CombustionTarget);
+		
+		if (IsCellIgnited(Cell) && Cell.TryClaim(EFireCellClaims::Ignition))
+			Result.IgnitedCells.Emplace(CombustionTargets[i]);
+
+		if (Cell.HasCombustibleInterface() && Cell.TryClaim(EFireCellClaims::ActorUpdate))
+			Result.CombustionActorCells.Emplace(CombustionTargets[i]);
+	}
+}
+
+float FFireSpreadCore::GatherCellCombustion(const FFireCellGrid::FCellRef& Cell) const
+{
+	float CombustIncrease = 0.f;
+	for (int32 Direction = 0; Direction < RadialDirections.Num(); Direction++)
+	{
+		// edge cell that spreads fire in this direction is on the opposite side
+		const FFireCellGrid::FCellRef ByCell = FFireCellGrid::GetNeighbor(Cell, FIntVector2(-RadialDirections[Direction].X, -RadialDirections[Direction].Y));
+		if (!ByCell.IsValid() || !ByCell.HasFlag(EFireCellFlags::EdgeCell) || !IsCombustible(Cell, ByCell))
+			continue;
+
+		// same wind and directions as CollectCombustionTargets used for this edge cell
+		FWindWeights Scratch;
+		const FWindWeights& WindWeights = GetWindWeights(StepParams.Wind.Sample(ByCell.GetLocation()), Scratch);
+		if (WindWeights.Mask & (1u << Direction))
+			CombustIncrease += GetCellDeltaTime(ByCell) * GetWindEffect(Cell, ByCell, Direction, WindWeights) * GetSpreadFactor(ByCell) * Cell.GetCombustionRate();
+	}
+
+	return CombustIncrease;
+}
+
+bool FFireSpreadCore::IsNewCellOwner(const FFireCellGrid::FCellRef& NewCell, const FFireCellGrid::FCellRef& IgnitedCell) const
+{
+	// all ignited neighbors of a missing cell were ignited this step, otherwise the cell would have been created before.
+	// the first of them in RadialDirections order creates it
+	for (const auto& RadialDirection : RadialDirections)
+	{
+		const FFireCellGrid::FCellRef NeighborCell = FFireCellGrid::GetNeighbor(NewCell, RadialDirection);
+		if (NeighborCell.IsValid() && IsCellIgnited(NeighborCell))
+			return NeighborCell.Tile == IgnitedCell.Tile && NeighborCell.LocalIndex == IgnitedCell.LocalIndex;
+	}
+
+	return false;
+}
+
+void FFireSpreadCore::MarkEdgeCellsForRemoval(const TArray<FIntVector2>& EdgeCells, int32 Start, int32 End, FFireSpreadWorkerResult& Result) const
+{
+	//	2.3 mark for removal those who have no more pending neighbor cells
+	for (int32 i = Start; i < End; i++)
+	{
+		const FFireCellGrid::FCellRef EdgeCell = Cells->FindRef(EdgeCells[i]);
+		bool bMustRemoveEdgeCell = true;
+		for (const auto& Direction : RadialDirections)
+		{
+			const FFireCellGrid::FCellRef TestCell = FFireCellGrid::GetNeighbor(EdgeCell, Direction);
+			if (TestCell.IsValid() && IsCombustible(TestCell, EdgeCell))
+			{
+				bMustRemoveEdgeCell = false;
+				break;
+			}
+		}
+						
+		if (bMustRemoveEdgeCell)
+			Result.NotEdgeCellAnymore.Emplace(EdgeCells[i]);
+	}
+}
+
+void FFireSpreadCore::CreateNewFireCells(const TArray<FIntVector2>& IgnitedCells, int32 Start, int32 End, FFireSpreadWorkerResult& Result) const
+{
+	TArray<TPair<FIntVector2, FFireCell>>& OutNewCells = Result.NewCells;
+	OutNewCells.Reserve(OutNewCells.Num() + (End - Start) * 4); // in general, a cell has 3 pending neighbors, but corner cells can have 5 
+	for (int32 i = Start; i < End; i++)
+	{
+		auto IgnitedCellIndex = IgnitedCells[i];
+		const FFireCellGrid::FCellRef IgnitedCell = Cells->FindRef(IgnitedCellIndex);
+		for (const auto& RadialDirection : RadialDirections)
+		{
+			const FFireCellGrid::FCellRef NeighborCell = FFireCellGrid::GetNeighbor(IgnitedCell, RadialDirection);
+			// tiles around edge cells are allocated by owner between steps, so a free slot always exists for a neighbor of an ignited cell
+			if (!ensure(NeighborCell.Tile))
+				continue;
+			
+			if (NeighborCell.IsValid())
+				continue;
+			
+			// several ignited cells can share a missing neighbor. Cell location depends on which of them creates it,
+			// so in deterministic mode the owner is picked by a fixed rule instead of whoever claims it first
+			const bool bCreatesNeighbor = StepParams.bDeterministic
+				? IsNewCellOwner(NeighborCell, IgnitedCell)
+				: NeighborCell.TryClaim(EFireCellClaims::NewCell);
+			
+			if (bCreatesNeighbor)
+			{
+				auto TestCellIndex = IgnitedCellIndex + RadialDirection;
+				
+				FFireCell NewCell;
+				FVector IgnitorLocation = IgnitedCell.GetLocation();
+				// if (Cells[IgnitedCellIndex].CombustibleActor.IsValid())
+				// 	IgnitorLocation -= FVector::UpVector * Cells[IgnitedCellIndex].GetCombustibleActorHeight();
+				
+				FVector NeighborLocation = IgnitorLocation + FVector(RadialDirection.X, RadialDirection.Y, 0) * Settings.CellSize;
+				Terrain->GetCell(TestCellIndex, NeighborLocation, NewCell);
+				OutNewCells.Emplace(TestCellIndex, NewCell);
+			}
+		}
+	}
+}
+
+void FFireSpreadCore::BurnOutCells(const TArray<FIntVector2>& BurningCells, int32 Start, int32 End, FFireSpreadWorkerResult& Result) const
+{
+	for (int32 i = Start; i < End; i++)
+	{
+		const FFireCellGrid::FCellRef Cell = Cells->FindRef(BurningCells[i]);
+		// LOD region of the cell is skipped this step
+		const float DeltaTime = GetCellDeltaTime(Cell);
+		if (DeltaTime <= 0.f)
+			continue;
+		
+		float& Fuel = Cell.Tile->Fuel[Cell.LocalIndex];
+		Fuel -= Cell.GetBurnoutRate() * DeltaTime;
+		
+		// burnt out phase is set by owner, since it's where cell is removed from fire
+		if (Fuel <= 0.f)
+			Result.BurntOutCells.Emplace(BurningCells[i]);
+		else if (Fuel <= Settings.SmolderingFuelThreshold && Cell.GetPhase() == EFireCellPhase::Burning)
+		{
+			Cell.SetPhase(EFireCellPhase::Smoldering);
+			Result.SmolderingCells.Emplace(BurningCells[i]);
+		}
+	}
+}
@@ -0,0 +1,121 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Data/FireCellGrid.h"
+#include "Simulation/FireSpreadTypes.h"
+
+class IFireTerrainQuery;
+
+// Tunables of the cellular automaton. Owner copies them from its own config
+struct FFireSpreadSettings
+{
+	// size of 1 dimension of a fire cell
+	double CellSize = 25.0;
+	// if a potential cell is lower than this value - fire won't spread there
+	double FireDownwardPropagationThreshold = 20.0;
+	float SmolderingFuelThreshold = 0.3f;
+	float SmolderingSpreadFactor = 0.25f;
+	// below this wind strength fire spreads radially
+	float WindEffectActivationThreshold = 2.f;
+};
+
+/**
+ * Cellular automaton of fire spread without any world or UObject dependencies: cells come from FFireCellGrid,
+ * new cells are described by IFireTerrainQuery. Owner keeps the grid, edge and burning cells, schedules the kernels on workers and applies their results.
+ * All kernels are const and work on [Start, End) of their input, so they can run from any amount of workers at once
+ */
+class FIRESIMULATIONCORE_API FFireSpreadCore
+{
+public:
+	FFireSpreadCore() = default;
+	FFireSpreadCore(const FFireCellGrid& InCells, const IFireTerrainQuery& InTerrain);
+
+	FFireSpreadSettings Settings;
+
+	// captured once per step, before kernels of the step are launched
+	void BeginStep(const FFireSpreadStepParams& NewStepParams);
+	const FFireSpreadStepParams& GetStepParams() const { return StepParams; }
+
+	// How much wind pushes fire towards each of 8 neighbors of a cell, in RadialDirections order
+	struct FWindWeights
+	{
+		// wind | direction to neighbor. Fire doesn't spread against wind, so directions at 90 degrees and more from wind are left out of Mask
+		alignas(16) float Weights[8];
+		uint32 Mask = 0;
+		// wind is below activation threshold: fire creeps in all directions with the same weight and slope doesn't matter
+		bool bCalm = true;
+	};
+
+	// directions to 8 neighbors of a cell
+	const TArray<FIntVector2>& GetRadialDirections() const { return RadialDirections; }
+	void ComputeWindWeights(const FVector2f& Wind, FWindWeights& OutWeights) const;
+	// weights for wind sampled for a cell. Uniform wind returns weights that were computed once when it changed, otherwise they are computed to Scratch
+	const FWindWeights& GetWindWeights(const FVector2f& Wind, FWindWeights& Scratch) const
+	{
+		if (StepParams.Wind.IsUniform())
+			return UniformWindWeights;
+		
+		ComputeWindWeights(Wind, Scratch);
+		return Scratch;
+	}
+
+	bool IsCombustible(const FFireCellGrid::FCellRef& TargetCell, const FFireCellGrid::FCellRef& ByCell) const;
+	bool IsCellIgnited(const FFireCellGrid::FCellRef& Cell) const;
+	// ignited cell spreads fire further only if there's something combustible around it
+	bool HasCombustibleNeighbors(const FFireCellGrid::FCellRef& Cell) const;
+
+	// edge cells add combustion to their neighbors. Cells are claimed atomically, so every event is reported once
+	void SpreadFireBatch(const TArray<FIntVector2>& EdgeCells, int32 Start, int32 End, FFireSpreadWorkerResult& Result) const;
+	
+	// deterministic spread, same step as SpreadFireBatch in 3 passes: collect cells burned by edge cells, gather combustion into back buffer, commit it
+	void CollectCombustionTargets(const TArray<FIntVector2>& EdgeCells, int32 Start, int32 End, FFireSpreadWorkerResult& Result) const;
+	void GatherCombustion(const TArray<FIntVector2>& CombustionTargets, int32 Start, int32 End) const;
+	void CommitCombustion(const TArray<FIntVector2>& CombustionTargets, int32 Start, int32 End, FFireSpreadWorkerResult& Result) const;
+
+	void MarkEdgeCellsForRemoval(const TArray<FIntVector2>& EdgeCells, int32 Start, int32 End, FFireSpreadWorkerResult& Result) const;
+	void CreateNewFireCells(const TArray<FIntVector2>& IgnitedCells, int32 Start, int32 End, FFireSpreadWorkerResult& Result) const;
+	void BurnOutCells(const TArray<FIntVector2>& BurningCells, int32 Start, int32 End, FFireSpreadWorkerResult& Result) const;
+
+private:
+	// edge cells are processed in blocks of this size: cells are looked up and wind is sampled for the whole block in one pass
+	static constexpr int32 EdgeCellsBlockSize = 64;
+	// lowest wind effect, so that fire still creeps against the wind
+	static constexpr float MinWindEffect = 0.1f;
+	static constexpr uint32 AllDirectionsMask = 0xFF;
+	
+	void GatherEdgeCells(const TArray<FIntVector2>& EdgeCells, int32 Start, int32 End, FFireCellGrid::FCellRef* OutCells, FVector2f* OutWinds) const;
+	// wind effect of ByCell on its neighbor in RadialDirections[Direction]
+	float GetWindEffect(const FFireCellGrid::FCellRef& TargetCell, const FFireCellGrid::FCellRef& ByCell, int32 Direction, const FWindWeights& WindWeights) const;
+	FORCEINLINE float GetSlopeFactor(const FFireCellGrid::FCellRef& TargetCell, const FFireCellGrid::FCellRef& ByCell, int32 Direction) const
+	{
+		const FFireCellGrid::FCellRef& Owner = bRadialSlopeStoredByNeighbor[Direction] ? TargetCell : ByCell;
+		return Owner.Tile->SlopeFactors[RadialSlopeIndex[Direction]][Owner.LocalIndex];
+	}
+
+	float GetSpreadFactor(const FFireCellGrid::FCellRef& ByCell) const;
+	float GatherCellCombustion(const FFireCellGrid::FCellRef& Cell) const;
+	bool IsNewCellOwner(const FFireCellGrid::FCellRef& NewCell, const FFireCellGrid::FCellRef& IgnitedCell) const;
+	// combustion an edge cell adds to each of its 8 neighbors (RadialDirections order) this step. Returns mask of neighbors it burns, other increases are garbage
+	uint32 EvaluateNeighbors(const FFireCellGrid::FCellRef& EdgeCell, const FVector2f& Wind, FFireCellGrid::FCellRef* OutNeighbors, float* OutIncreases) const;
+	// time a burning cell is stepped by: time of its LOD region, but not more than the cell has been burning
+	FORCEINLINE float GetCellDeltaTime(const FFireCellGrid::FCellRef& Cell) const
+	{
+		return FMath::Min(Cell.Tile->StepDeltaTime, static_cast<float>(StepParams.SimulationTime - Cell.GetIgnitionTime()));
+	}
+	
+	const FFireCellGrid* Cells = nullptr;
+	const IFireTerrainQuery* Terrain = nullptr;
+	FFireSpreadStepParams StepParams;
+	
+	TArray<FIntVector2> RadialDirections;
+	// RadialDirections as horizontal unit vectors
+	float RadialUnitX[8];
+	float RadialUnitY[8];
+	// where slope factor of a RadialDirections neighbor is kept, see FFireCellGrid::GetSlopeIndex
+	int32 RadialSlopeIndex[8];
+	bool bRadialSlopeStoredByNeighbor[8];
+	
+	// rebuilt by BeginStep when uniform wind changes
+	FWindWeights UniformWindWeights;
+	FVector2f UniformWindWeightsWind = FVector2f(FLT_MAX, FLT_MAX);
+};
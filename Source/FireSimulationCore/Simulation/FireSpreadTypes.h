@@ -0,0 +1,87 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Data/FireWindField.h"
+
+enum class EFireCellFlags : uint8
+{
+	None = 0,
+	Obstacle = 1 << 0,
+	// cell has a combustible of the owner, see FFireCell::CombustibleIndex. Workers read the flag instead of touching the combustible
+	HasCombustibleInterface = 1 << 1,
+	// since cell individual combustion state is not equal to actor combustion state (as it can get burnt by multiple cells)
+	// and since it's not threadsafe to access actors outside of GT, i'm using this flag which is written to in GT and read in other threads
+	CombustibleActorIgnited = 1 << 2,
+	// cell is in AFireSource edge cells set. Written on game thread between simulation steps
+	EdgeCell = 1 << 3,
+	// edge cell that had nothing to spread to under current wind. It's out of edge cells set until something around it changes
+	SleepingEdgeCell = 1 << 4,
+};
+ENUM_CLASS_FLAGS(EFireCellFlags)
+
+// Lifecycle of a cell. Unburned and Igniting are derived from combustion state, the rest is stored in the grid once the cell ignites
+enum class EFireCellPhase : uint8
+{
+	Unburned,
+	Igniting,
+	Burning,
+	// low on fuel, spreads fire weaker
+	Smoldering,
+	// no fuel left, cell doesn't burn and doesn't spread fire anymore
+	BurntOut,
+};
+
+// One-shot markers that spread workers set atomically so that every event for a cell is recorded by exactly one worker
+enum class EFireCellClaims : uint8
+{
+	None = 0,
+	Ignition = 1 << 0,
+	NewCell = 1 << 1,
+	ActorUpdate = 1 << 2,
+	// cell is already in the list of cells to gather combustion for in deterministic mode
+	CombustionTarget = 1 << 3,
+};
+ENUM_CLASS_FLAGS(EFireCellClaims)
+
+// Description of a cell at the moment it is created. Once added to FFireCellGrid it is split into hot per-tile arrays, so this struct is never touched by the spread loop
+struct FFireCell
+{
+	float CombustionState = 0.f;
+	float CombustionRate = 1.f;
+	float BurnoutRate = 0.005f;
+	float FireHeight = 100.f; // affects verticality
+
+	FVector Location = FVector::ZeroVector;
+
+	// handle of whatever burns on the cell (actor, prop instance), owned by the owner of the grid. Core only checks if there is one
+	int32 CombustibleIndex = INDEX_NONE;
+	bool bObstacle = false;
+
+	bool IsObstacle() const { return bObstacle; }
+	bool HasCombustible() const { return CombustibleIndex != INDEX_NONE; }
+};
+
+// Inputs of one simulation step. Captured on game thread when the step is launched, so workers never read values that game thread keeps changing
+struct FFireSpreadStepParams
+{
+	float DeltaTime = 0.f;
+	// simulation time at the end of the step. Cells are stepped by time of their tile, see FFireCellGrid::FTile::StepDeltaTime
+	double SimulationTime = 0.0;
+	FFireWindField Wind;
+	bool bDeterministic = false;
+	// wind is strong enough everywhere to spread fire only downwind, so an edge cell that has nothing downwind can sleep
+	bool bEdgeCellsCanSleep = false;
+};
+
+// Append-only output of one worker in a simulation stage. Events are claimed per cell (see EFireCellClaims), so there are no duplicates across workers
+struct FFireSpreadWorkerResult
+{
+	TArray<FIntVector2> CombustionActorCells;
+	TArray<FIntVector2> IgnitedCells;
+	TArray<FIntVector2> NotEdgeCellAnymore;
+	TArray<FIntVector2> StalledEdgeCells;
+	TArray<TPair<FIntVector2, FFireCell>> NewCells;
+	TArray<FIntVector2> CombustionTargets;
+	TArray<FIntVector2> BurntOutCells;
+	TArray<FIntVector2> SmolderingCells;
+};
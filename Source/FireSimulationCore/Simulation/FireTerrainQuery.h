@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+struct FFireCell;
+
+// Where FFireSpreadCore gets new cells from. The core knows nothing about the world it burns in, so anything that can describe
+// the surface at a cell (physics sweeps, baked heightfield, synthetic terrain) can drive it.
+// Called from simulation workers, implementations must be thread safe
+class IFireTerrainQuery
+{
+public:
+	virtual ~IFireTerrainQuery() = default;
+
+	// describe the surface of cell CellKey that is found around LocationBase. Returns false if fire can't burn there.
+	// Anything combustible found there is kept by the implementation and handed out as OutCell.CombustibleIndex
+	virtual bool GetCell(const FIntVector2& CellKey, const FVector& LocationBase, FFireCell& OutCell) const = 0;
+};
@@ -0,0 +1,19 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+// Standalone executable that runs FireSimulationCoreTests. Core only, so it builds and runs in seconds on CI
+[SupportedPlatforms(UnrealPlatformClass.All)]
+public class FireSimulationCoreTestsTarget : TestTargetRules
+{
+	public FireSimulationCoreTestsTarget(TargetInfo Target) : base(Target)
+	{
+		DefaultBuildSettings = BuildSettingsVersion.V5;
+		IncludeOrderVersion = EngineIncludeOrderVersion.Unreal5_6;
+		LaunchModuleName = "FireSimulationCoreTests";
+
+		bCompileAgainstEngine = false;
+		bCompileAgainstCoreUObject = false;
+		bCompileAgainstApplicationCore = false;
+	}
+}
@@ -0,0 +1,63 @@
+﻿#include "Data/FireCellGrid.h"
+#include "TestHarness.h"
+
+TEST_CASE("FireSimulationCore::CellGrid::NeighborsAcrossTiles", "[FireSimulationCore]")
+{
+	FFireCellGrid Cells;
+	const FIntVector2 Keys[] = { {FFireCellGrid::TileSize - 1, 0}, {FFireCellGrid::TileSize, 0}, {-1, -1}, {0, 0} };
+	for (const FIntVector2& Key : Keys)
+		Cells.Emplace(Key, FFireCell());
+
+	CHECK(Cells.Num() == 4);
+	CHECK(Cells.NumTiles() == 3);
+
+	const FFireCellGrid::FCellRef Neighbor = FFireCellGrid::GetNeighbor(Cells.FindRef(Keys[0]), FIntVector2(1, 0));
+	REQUIRE(Neighbor.IsValid());
+	CHECK(Neighbor.GetKey() == Keys[1]);
+
+	const FFireCellGrid::FCellRef NegativeNeighbor = FFireCellGrid::GetNeighbor(Cells.FindRef(Keys[3]), FIntVector2(-1, -1));
+	REQUIRE(NegativeNeighbor.IsValid());
+	CHECK(NegativeNeighbor.GetKey() == Keys[2]);
+
+	CHECK_FALSE(FFireCellGrid::GetNeighbor(Cells.FindRef(Keys[3]), FIntVector2(0, 1)).IsValid());
+}
+
+TEST_CASE("FireSimulationCore::CellGrid::SettledTileIsCompactedToAsh", "[FireSimulationCore]")
+{
+	FFireCellGrid Cells;
+	const FIntVector2 BurningKey(5, 5);
+	constexpr int32 CombustibleIndex = 7;
+	for (int32 Y = 0; Y < FFireCellGrid::TileSize; Y++)
+	{
+		for (int32 X = 0; X < FFireCellGrid::TileSize; X++)
+		{
+			FFireCell Cell;
+			Cell.bObstacle = FIntVector2(X, Y) != BurningKey;
+			Cell.CombustibleIndex = Cell.bObstacle ? INDEX_NONE : CombustibleIndex;
+			Cells.Emplace(FIntVector2(X, Y), Cell);
+		}
+	}
+
+	const FIntVector2 NeighborTileKey(FFireCellGrid::TileSize, 0);
+	Cells.Emplace(NeighborTileKey, FFireCell());
+	const FFireCellGrid::FCellRef BurningCell = Cells.FindRef(BurningKey);
+	CHECK(BurningCell.HasCombustibleInterface());
+	REQUIRE(Cells.SetBurntOut(BurningCell));
+
+	TArray<int32> ReleasedCombustibles;
+	Cells.CompactTile(BurningCell.Tile, [&ReleasedCombustibles](int32 Index) { ReleasedCombustibles.Add(Index); });
+
+	CHECK(ReleasedCombustibles == TArray<int32>({ CombustibleIndex }));
+	CHECK(Cells.IsAsh(BurningKey));
+	CHECK(Cells.Contains(BurningKey));
+	CHECK(Cells.FindRef(BurningKey).GetPhase() == EFireCellPhase::BurntOut);
+	CHECK(Cells.Num() == 1);
+	CHECK(Cells.NumTiles() == 1);
+	CHECK(Cells.GetNumAshTiles() == 1);
+
+	// neighbor tile sees the compacted one as ash
+	const FFireCellGrid::FCellRef AshNeighbor = FFireCellGrid::GetNeighbor(Cells.FindRef(NeighborTileKey), FIntVector2(-1, 0));
+	REQUIRE(AshNeighbor.IsValid());
+	CHECK(AshNeighbor.IsObstacle());
+	CHECK(AshNeighbor.GetCombustibleIndex() == INDEX_NONE);
+}
@@ -0,0 +1,19 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+// Low level tests of FireSimulationCore: spread kernels driven over synthetic terrain, no engine or world
+public class FireSimulationCoreTests : TestModuleRules
+{
+	public FireSimulationCoreTests(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PrivateDependencyModuleNames.AddRange(new string[] {
+			"Core",
+			"FireSimulationCore"
+		});
+
+		UpdateBuildGraphPropertiesFile(new Metadata() { TestName = "FireSimulationCore", TestShortName = "FireSimulationCore" });
+	}
+}
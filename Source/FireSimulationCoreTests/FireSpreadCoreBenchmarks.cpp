@@ -0,0 +1,67 @@
+﻿#include "SyntheticFire.h"
+#include "TestHarness.h"
+
+using namespace FireSimulationCoreTests;
+
+// Microbenchmarks of the kernels, hidden from the default run. Single threaded, so they measure the kernels and not the scheduler:
+// FireSimulationCoreTests "[perf]"
+TEST_CASE("FireSimulationCore::Benchmark::Spread", "[.][perf][FireSimulationCore]")
+{
+	FSyntheticTerrain Terrain;
+	Terrain.Size = 256;
+	Terrain.Noise = 30.f;
+
+	auto RunFire = [&Terrain](bool bDeterministic, const TCHAR* Name)
+	{
+		FSyntheticFire Fire(Terrain);
+		Fire.StepParams.bDeterministic = bDeterministic;
+		Fire.StepParams.Wind.Uniform = FVector2f(6.f, 3.f);
+		for (int32 i = 0; i < 8; i++)
+			Fire.Ignite(FIntVector2(16 + i * 4, 32 + i * 24));
+
+		constexpr int32 Steps = 300;
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Step = 0; Step < Steps; Step++)
+			Fire.Step(0.1f);
+
+		const double StepMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / Steps;
+		WARN(TCHAR_TO_UTF8(*FString::Printf(TEXT("%s: %.3f ms per step, %d cells, %d ignited"), Name, StepMs, Fire.Cells.Num(), Fire.IgnitedCellsCount)));
+		CHECK(Fire.IgnitedCellsCount > 0);
+	};
+
+	SECTION("Spread") { RunFire(false, TEXT("Spread")); }
+	SECTION("Deterministic spread") { RunFire(true, TEXT("Deterministic spread")); }
+}
+
+TEST_CASE("FireSimulationCore::Benchmark::WindField", "[.][perf][FireSimulationCore]")
+{
+	FFireWindField Wind;
+	Wind.SizeX = 16;
+	Wind.SizeY = 16;
+	Wind.InvNodeSpacing = 1.0 / 500.0;
+	for (int32 i = 0; i < Wind.SizeX * Wind.SizeY; i++)
+		Wind.Nodes.Emplace(FMath::Sin(i * 0.7f) * 8.f, FMath::Cos(i * 1.3f) * 8.f);
+
+	constexpr int32 BatchSize = 64;
+	float X[BatchSize];
+	float Y[BatchSize];
+	FVector2f Winds[BatchSize];
+	for (int32 i = 0; i < BatchSize; i++)
+	{
+		X[i] = i * 97.f;
+		Y[i] = i * 53.f;
+	}
+
+	constexpr int32 Batches = 200000;
+	FVector2f Sum = FVector2f::ZeroVector;
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Batch = 0; Batch < Batches; Batch++)
+	{
+		Wind.SampleBatch(X, Y, BatchSize, Winds);
+		Sum += Winds[Batch & (BatchSize - 1)];
+	}
+
+	const double NsPerSample = (FPlatformTime::Seconds() - StartTime) * 1e9 / (static_cast<double>(Batches) * BatchSize);
+	WARN(TCHAR_TO_UTF8(*FString::Printf(TEXT("SampleBatch: %.2f ns per sample (%s)"), NsPerSample, *Sum.ToString())));
+	CHECK(Sum.Size() > 0.f);
+}
@@ -0,0 +1,138 @@
+﻿#include "SyntheticFire.h"
+#include "TestHarness.h"
+
+using namespace FireSimulationCoreTests;
+
+TEST_CASE("FireSimulationCore::SpreadCore::WindWeights", "[FireSimulationCore]")
+{
+	const FFireCellGrid Cells;
+	const FSyntheticTerrain Terrain;
+	const FFireSpreadCore Core(Cells, Terrain);
+	FFireSpreadCore::FWindWeights Weights;
+
+	SECTION("Wind below activation threshold spreads fire all around with the same weight")
+	{
+		Core.ComputeWindWeights(FVector2f(1.f, 0.f), Weights);
+		CHECK(Weights.bCalm);
+		CHECK(Weights.Mask == 0xFF);
+		for (int32 i = 1; i < 8; i++)
+			CHECK(Weights.Weights[i] == Weights.Weights[0]);
+	}
+
+	SECTION("Fire doesn't spread against the wind and spreads along it the most")
+	{
+		Core.ComputeWindWeights(FVector2f(10.f, 0.f), Weights);
+		CHECK_FALSE(Weights.bCalm);
+		const TArray<FIntVector2>& Directions = Core.GetRadialDirections();
+		for (int32 i = 0; i < 8; i++)
+		{
+			CHECK(((Weights.Mask & (1u << i)) != 0) == (Directions[i].X > 0));
+			if (Directions[i].X > 0 && Directions[i].Y == 0)
+				CHECK(Weights.Weights[i] == 10.f);
+			else if (Directions[i].X > 0)
+				CHECK(FMath::IsNearlyEqual(Weights.Weights[i], 10.f * UE_INV_SQRT_2, 1e-4f));
+		}
+	}
+}
+
+TEST_CASE("FireSimulationCore::SpreadCore::CalmFireIsSymmetric", "[FireSimulationCore]")
+{
+	FSyntheticTerrain Terrain;
+	Terrain.Size = 65;
+	FSyntheticFire Fire(Terrain);
+	Fire.StepParams.bDeterministic = true;
+	const int32 Center = Terrain.Size / 2;
+	REQUIRE(Fire.Ignite(FIntVector2(Center, Center)));
+
+	// power of two step, so that simulation time and cell step times are exact and every neighbor gives a cell exactly the same combustion
+	for (int32 Step = 0; Step < 200; Step++)
+		Fire.Step(0.125f);
+
+	REQUIRE(Fire.IgnitedCellsCount > 8);
+	const int32 Last = Terrain.Size - 1;
+	for (int32 Y = 0; Y < Terrain.Size; Y++)
+	{
+		for (int32 X = 0; X < Terrain.Size; X++)
+		{
+			const bool bIgnited = Fire.IsIgnited(FIntVector2(X, Y));
+			CHECK(Fire.IsIgnited(FIntVector2(Last - X, Y)) == bIgnited);
+			CHECK(Fire.IsIgnited(FIntVector2(X, Last - Y)) == bIgnited);
+			CHECK(Fire.IsIgnited(FIntVector2(Y, X)) == bIgnited);
+		}
+	}
+}
+
+TEST_CASE("FireSimulationCore::SpreadCore::WindPushesFire", "[FireSimulationCore]")
+{
+	FSyntheticTerrain Terrain;
+	FSyntheticFire Fire(Terrain);
+	Fire.StepParams.Wind.Uniform = FVector2f(10.f, 0.f);
+	const FIntVector2 Origin(16, 32);
+	REQUIRE(Fire.Ignite(Origin));
+
+	for (int32 Step = 0; Step < 30; Step++)
+		Fire.Step(0.125f);
+
+	int32 MinX = Origin.X;
+	int32 MaxX = Origin.X;
+	for (const FIntVector2& BurningCell : Fire.BurningCells)
+	{
+		MinX = FMath::Min(MinX, BurningCell.X);
+		MaxX = FMath::Max(MaxX, BurningCell.X);
+	}
+
+	CHECK(MinX == Origin.X);
+	CHECK(MaxX >= Origin.X + 20);
+}
+
+TEST_CASE("FireSimulationCore::SpreadCore::ObstaclesStopFire", "[FireSimulationCore]")
+{
+	FSyntheticTerrain Terrain;
+	Terrain.WallX = 40;
+	FSyntheticFire Fire(Terrain);
+	Fire.StepParams.Wind.Uniform = FVector2f(10.f, 0.f);
+	REQUIRE(Fire.Ignite(FIntVector2(20, 32)));
+
+	for (int32 Step = 0; Step < 100; Step++)
+		Fire.Step(0.125f);
+
+	CHECK(Fire.IsIgnited(FIntVector2(Terrain.WallX - 1, 32)));
+	CHECK_FALSE(Fire.IsIgnited(FIntVector2(Terrain.WallX, 32)));
+	bool bCellsBehindWall = false;
+	Fire.Cells.ForEachCell([&](const FFireCellGrid::FCellRef& Cell) { bCellsBehindWall |= Cell.GetKey().X > Terrain.WallX; });
+	CHECK_FALSE(bCellsBehindWall);
+}
+
+TEST_CASE("FireSimulationCore::SpreadCore::DeterministicSpreadDoesntDependOnWorkers", "[FireSimulationCore]")
+{
+	FSyntheticTerrain Terrain;
+	Terrain.Noise = 30.f;
+
+	// wind that turns across the patch, so that every cell samples its own wind
+	FFireSpreadStepParams StepParams;
+	StepParams.bDeterministic = true;
+	StepParams.Wind.SizeX = 3;
+	StepParams.Wind.SizeY = 3;
+	StepParams.Wind.InvNodeSpacing = 1.0 / (Terrain.Size * Terrain.CellSize / 2.0);
+	StepParams.Wind.Nodes = { FVector2f(6.f, 0.f), FVector2f(5.f, 3.f), FVector2f(3.f, 5.f), FVector2f(6.f, -2.f), FVector2f(1.f, 1.f), FVector2f(0.f, 6.f), FVector2f(4.f, -4.f), FVector2f(2.f, -5.f), FVector2f(-3.f, 5.f) };
+
+	auto RunFire = [&](int32 WorkersCount, bool bReverseWorkers)
+	{
+		FSyntheticFire Fire(Terrain);
+		Fire.StepParams = StepParams;
+		Fire.WorkersCount = WorkersCount;
+		Fire.bReverseWorkers = bReverseWorkers;
+		Fire.Ignite(FIntVector2(10, 10));
+		Fire.Ignite(FIntVector2(40, 20));
+		for (int32 Step = 0; Step < 150; Step++)
+			Fire.Step(0.1f);
+
+		return TPair<uint32, int32>(Fire.GetStateHash(), Fire.IgnitedCellsCount);
+	};
+
+	const TPair<uint32, int32> SingleWorker = RunFire(1, false);
+	CHECK(SingleWorker.Value > 100);
+	CHECK(RunFire(1, false) == SingleWorker);
+	CHECK(RunFire(5, false) == SingleWorker);
+	CHECK(RunFire(7, true) == SingleWorker);
+}
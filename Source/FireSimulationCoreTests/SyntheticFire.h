@@ -0,0 +1,216 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Data/FireCellGrid.h"
+#include "Simulation/FireSpreadCore.h"
+#include "Simulation/FireTerrainQuery.h"
+
+namespace FireSimulationCoreTests
+{
+	// Square patch of terrain described by a function, surrounded by obstacles. Cell (X, Y) is centered at (X, Y) * CellSize like in AFireSource
+	class FSyntheticTerrain : public IFireTerrainQuery
+	{
+	public:
+		int32 Size = 64;
+		double CellSize = 25.0;
+		// hills up to this height and combustion rates that differ from cell to cell
+		float Noise = 0.f;
+		// cells with this X are incombustible, INDEX_NONE - no wall
+		int32 WallX = INDEX_NONE;
+
+		virtual bool GetCell(const FIntVector2& CellKey, const FVector& LocationBase, FFireCell& OutCell) const override
+		{
+			const float X = CellKey.X;
+			const float Y = CellKey.Y;
+			OutCell.Location = FVector(CellKey.X * CellSize, CellKey.Y * CellSize, Noise * FMath::Sin(X * 0.31f) * FMath::Cos(Y * 0.17f));
+			OutCell.CombustionRate = 1.f + 0.5f * Noise / 100.f * FMath::Sin(X * 1.7f + Y * 2.3f);
+			OutCell.bObstacle = CellKey.X < 0 || CellKey.Y < 0 || CellKey.X >= Size || CellKey.Y >= Size || CellKey.X == WallX;
+			return !OutCell.bObstacle;
+		}
+	};
+
+	// What AFireSource does around the kernels, without LOD, sleeping edge cells and combustibles.
+	// Workers are emulated by splitting every stage into batches that run one after another, in reverse when bReverseWorkers is set
+	class FSyntheticFire
+	{
+	public:
+		FFireSpreadStepParams StepParams;
+		int32 WorkersCount = 1;
+		bool bReverseWorkers = false;
+
+		explicit FSyntheticFire(const FSyntheticTerrain& InTerrain)
+			: Core(Cells, InTerrain), Terrain(InTerrain)
+		{
+			Core.Settings.CellSize = Terrain.CellSize;
+			Cells.SetSlopeCellSize(Terrain.CellSize);
+		}
+
+		bool Ignite(const FIntVector2& Key)
+		{
+			FFireCell InitialCell;
+			if (!Terrain.GetCell(Key, FVector::ZeroVector, InitialCell))
+				return false;
+
+			InitialCell.CombustionState = 1.f;
+			const FFireCellGrid::FCellRef Cell = Cells.Emplace(Key, InitialCell);
+			Cell.SetFlag(EFireCellFlags::EdgeCell, true);
+			Cell.SetPhase(EFireCellPhase::Burning);
+			Cell.SetIgnitionTime(SimulationTime);
+			Cell.TryClaim(EFireCellClaims::Ignition);
+			EdgeCells.Emplace(Key);
+			BurningCells.Emplace(Key);
+			Cells.EnsureTilesAround(Key, 2);
+			for (const FIntVector2& Direction : Core.GetRadialDirections())
+			{
+				if (Cells.Contains(Key + Direction))
+					continue;
+
+				FFireCell Neighbor;
+				Terrain.GetCell(Key + Direction, FVector::ZeroVector, Neighbor);
+				Cells.Emplace(Key + Direction, Neighbor);
+			}
+
+			return true;
+		}
+
+		void Step(float DeltaTime)
+		{
+			SimulationTime += DeltaTime;
+			StepParams.DeltaTime = DeltaTime;
+			StepParams.SimulationTime = SimulationTime;
+			Core.BeginStep(StepParams);
+			Cells.ForEachTile([DeltaTime](FFireCellGrid::FTile& Tile) { Tile.StepDeltaTime = DeltaTime; });
+
+			const TArray<FIntVector2> EdgeCellsSnapshot = EdgeCells;
+			TArray<FFireSpreadWorkerResult> SpreadResults;
+			SpreadResults.SetNum(WorkersCount);
+			if (StepParams.bDeterministic)
+			{
+				RunStage(EdgeCellsSnapshot.Num(), [&](int32 WorkerIndex, int32 Start, int32 End) { Core.CollectCombustionTargets(EdgeCellsSnapshot, Start, End, SpreadResults[WorkerIndex]); });
+				TArray<FIntVector2> CombustionTargets = Concatenate(SpreadResults, &FFireSpreadWorkerResult::CombustionTargets);
+				RunStage(CombustionTargets.Num(), [&](int32 WorkerIndex, int32 Start, int32 End) { Core.GatherCombustion(CombustionTargets, Start, End); });
+				RunStage(CombustionTargets.Num(), [&](int32 WorkerIndex, int32 Start, int32 End) { Core.CommitCombustion(CombustionTargets, Start, End, SpreadResults[WorkerIndex]); });
+			}
+			else
+			{
+				RunStage(EdgeCellsSnapshot.Num(), [&](int32 WorkerIndex, int32 Start, int32 End) { Core.SpreadFireBatch(EdgeCellsSnapshot, Start, End, SpreadResults[WorkerIndex]); });
+			}
+
+			const TArray<FIntVector2> IgnitedCells = Concatenate(SpreadResults, &FFireSpreadWorkerResult::IgnitedCells);
+
+			TArray<FFireSpreadWorkerResult> StageResults;
+			StageResults.SetNum(WorkersCount);
+			RunStage(EdgeCellsSnapshot.Num(), [&](int32 WorkerIndex, int32 Start, int32 End) { Core.MarkEdgeCellsForRemoval(EdgeCellsSnapshot, Start, End, StageResults[WorkerIndex]); });
+			RunStage(IgnitedCells.Num(), [&](int32 WorkerIndex, int32 Start, int32 End) { Core.CreateNewFireCells(IgnitedCells, Start, End, StageResults[WorkerIndex]); });
+			RunStage(BurningCells.Num(), [&](int32 WorkerIndex, int32 Start, int32 End) { Core.BurnOutCells(BurningCells, Start, End, StageResults[WorkerIndex]); });
+
+			for (const FIntVector2& NotEdgeCellAnymore : Concatenate(StageResults, &FFireSpreadWorkerResult::NotEdgeCellAnymore))
+			{
+				EdgeCells.Remove(NotEdgeCellAnymore);
+				Cells.FindRef(NotEdgeCellAnymore).SetFlag(EFireCellFlags::EdgeCell, false);
+			}
+
+			TArray<TPair<FIntVector2, FFireCell>> NewCells = Concatenate(StageResults, &FFireSpreadWorkerResult::NewCells);
+			NewCells.Sort([](const TPair<FIntVector2, FFireCell>& A, const TPair<FIntVector2, FFireCell>& B) { return KeyLess(A.Key, B.Key); });
+			for (const TPair<FIntVector2, FFireCell>& NewCell : NewCells)
+				Cells.Emplace(NewCell.Key, NewCell.Value);
+
+			for (const FIntVector2& IgnitedCellKey : IgnitedCells)
+			{
+				const FFireCellGrid::FCellRef IgnitedCell = Cells.FindRef(IgnitedCellKey);
+				IgnitedCell.SetPhase(EFireCellPhase::Burning);
+				IgnitedCell.SetIgnitionTime(SimulationTime);
+				BurningCells.Emplace(IgnitedCellKey);
+				IgnitedCellsCount++;
+				if (Core.HasCombustibleNeighbors(IgnitedCell))
+				{
+					EdgeCells.Emplace(IgnitedCellKey);
+					IgnitedCell.SetFlag(EFireCellFlags::EdgeCell, true);
+					Cells.EnsureTilesAround(IgnitedCellKey, 2);
+				}
+			}
+
+			TArray<FFireCellGrid::FTile*> SettledTiles;
+			for (const FIntVector2& BurntOutCellKey : Concatenate(StageResults, &FFireSpreadWorkerResult::BurntOutCells))
+			{
+				const FFireCellGrid::FCellRef BurntOutCell = Cells.FindRef(BurntOutCellKey);
+				EdgeCells.Remove(BurntOutCellKey);
+				BurntOutCell.SetFlag(EFireCellFlags::EdgeCell, false);
+				BurntOutCellsCount++;
+				if (Cells.SetBurntOut(BurntOutCell))
+					SettledTiles.Emplace(BurntOutCell.Tile);
+			}
+
+			BurningCells.RemoveAll([this](const FIntVector2& Key) { return Cells.FindRef(Key).GetPhase() == EFireCellPhase::BurntOut; });
+			for (FFireCellGrid::FTile* SettledTile : SettledTiles)
+				Cells.CompactTile(SettledTile, [](int32 CombustibleIndex) {});
+		}
+
+		// order-independent hash of every cell, bit exact
+		uint32 GetStateHash() const
+		{
+			uint32 Hash = GetTypeHash(Cells.Num()) ^ GetTypeHash(Cells.GetNumAshTiles());
+			Cells.ForEachCell([&Hash](const FFireCellGrid::FCellRef& Cell)
+			{
+				Hash += HashCombineFast(GetTypeHash(Cell.GetKey()), HashCombineFast(static_cast<uint32>(Cell.GetPhase()), GetTypeHash(Cell.CombustionState().load())));
+			});
+
+			return Hash;
+		}
+
+		// burning or burnt out
+		bool IsIgnited(const FIntVector2& Key) const
+		{
+			const FFireCellGrid::FCellRef Cell = Cells.FindRef(Key);
+			return Cell.IsValid() && Cell.GetPhase() >= EFireCellPhase::Burning;
+		}
+
+		FFireCellGrid Cells;
+		FFireSpreadCore Core;
+		TArray<FIntVector2> EdgeCells;
+		TArray<FIntVector2> BurningCells;
+		int32 IgnitedCellsCount = 0;
+		int32 BurntOutCellsCount = 0;
+		double SimulationTime = 0.0;
+
+	private:
+		static bool KeyLess(const FIntVector2& A, const FIntVector2& B)
+		{
+			return A.Y != B.Y ? A.Y < B.Y : A.X < B.X;
+		}
+
+		template<typename TBody>
+		void RunStage(int32 ItemsCount, TBody&& Body) const
+		{
+			const int32 BatchSize = FMath::DivideAndRoundUp(FMath::Max(ItemsCount, 1), WorkersCount);
+			for (int32 i = 0; i < WorkersCount; i++)
+			{
+				const int32 WorkerIndex = bReverseWorkers ? WorkersCount - 1 - i : i;
+				const int32 Start = FMath::Min(WorkerIndex * BatchSize, ItemsCount);
+				Body(WorkerIndex, Start, FMath::Min(Start + BatchSize, ItemsCount));
+			}
+		}
+
+		// results of workers in deterministic mode are sorted by the owner, in normal mode they are whatever workers claimed
+		template<typename TItem>
+		TArray<TItem> Concatenate(TArray<FFireSpreadWorkerResult>& Results, TArray<TItem> FFireSpreadWorkerResult::* Member) const
+		{
+			TArray<TItem> Concatenated;
+			for (FFireSpreadWorkerResult& Result : Results)
+			{
+				Concatenated.Append(MoveTemp(Result.*Member));
+				(Result.*Member).Reset();
+			}
+
+			if constexpr (std::is_same_v<TItem, FIntVector2>)
+			{
+				if (StepParams.bDeterministic)
+					Concatenated.Sort([](const FIntVector2& A, const FIntVector2& B) { return KeyLess(A, B); });
+			}
+
+			return Concatenated;
+		}
+
+		const FSyntheticTerrain& Terrain;
+	};
+}